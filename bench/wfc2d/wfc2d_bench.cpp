@@ -0,0 +1,399 @@
+#include <benchmark/benchmark.h>
+#include <wfc/wfc2d.hpp>
+#include <wfc/batch.hpp>
+#include <wfc/chunked.hpp>
+#include <wfc/overlapping.hpp>
+#include <wfc/static_wfc2d.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+    using Solver = wfc2d::WaveFunctionCollapse2D;
+    using Ruleset = Solver::Ruleset;
+
+    // Tile i accepts every tile within a cyclic distance of numTiles / 8 (at least 1) in every direction, so
+    // larger tilesets keep a comparable share of allowed neighbours and a comparable contradiction rate
+    std::vector<Solver::Tile> makeTiles(size_t numTiles) {
+        const size_t reach = std::max<size_t>(1, numTiles / 8);
+        std::vector<Solver::Tile> tiles(numTiles);
+        for (size_t tile = 0; tile < numTiles; ++tile) {
+            for (size_t offset = numTiles - reach; offset <= numTiles + reach; ++offset) {
+                for (auto& options : tiles[tile].options) {
+                    options.set((tile + offset) % numTiles);
+                }
+            }
+            tiles[tile].weight = 1.0 + static_cast<double>(tile % 3);
+        }
+        return tiles;
+    }
+
+    // The tileset of makeTiles() as a ruleset known at compile time
+    template <size_t NumTiles>
+    constexpr wfc2d::StaticRuleset<NumTiles> makeStaticRuleset() {
+        const size_t reach = NumTiles / 8 > 1 ? NumTiles / 8 : 1;
+        wfc2d::StaticRuleset<NumTiles> rules{};
+        for (size_t tile = 0; tile < NumTiles; ++tile) {
+            uint64_t options = 0;
+            for (size_t offset = NumTiles - reach; offset <= NumTiles + reach; ++offset) {
+                options |= uint64_t{ 1 } << (tile + offset) % NumTiles;
+            }
+            for (auto& direction : rules.options) {
+                direction[tile] = options;
+            }
+            rules.weights[tile] = 1.0 + static_cast<double>(tile % 3);
+        }
+        return rules;
+    }
+
+    template <size_t NumTiles>
+    constexpr wfc2d::StaticRuleset<NumTiles> STATIC_RULESET = makeStaticRuleset<NumTiles>();
+
+    template <size_t NumTiles>
+    using StaticSolver = wfc2d::StaticWaveFunctionCollapse2D<STATIC_RULESET<NumTiles>>;
+
+    // Compiled once per tileset size and shared by every benchmark, like a service would
+    const std::shared_ptr<const Ruleset>& ruleset(size_t numTiles) {
+        static std::map<size_t, std::shared_ptr<const Ruleset>> rulesets;
+        auto& loaded = rulesets[numTiles];
+        if (!loaded) {
+            loaded = Ruleset::create(makeTiles(numTiles));
+        }
+        return loaded;
+    }
+
+    // Writes the tileset in every format the loaders read, once
+    const std::string& rulesetFile(size_t numTiles, const std::string& extension) {
+        static std::map<std::string, std::string> files;
+        const std::string filepath = "wfc2d_bench_" + std::to_string(numTiles) + extension;
+        auto& written = files[filepath];
+        if (!written.empty()) {
+            return written;
+        }
+
+        const auto& tiles = ruleset(numTiles)->tiles();
+        if (extension == ".wfcr") {
+            ruleset(numTiles)->compiled()->save(filepath);
+        }
+        else if (extension == ".json") {
+            std::ofstream output(filepath);
+            output << "{ \"tiles\": [\n";
+            for (size_t tile = 0; tile < tiles.size(); ++tile) {
+                output << "{ \"id\": " << tile << ", \"weight\": " << tiles[tile].weight << ", \"options\": {";
+                const char* directions[] = { "up", "down", "left", "right" };
+                for (size_t direction = 0; direction < 4; ++direction) {
+                    output << (direction ? ", " : " ") << "\"" << directions[direction] << "\": [";
+                    bool first = true;
+                    for (size_t option = 0; option < tiles.size(); ++option) {
+                        if (tiles[tile].options[direction].test(option)) {
+                            output << (first ? "" : ", ") << option;
+                            first = false;
+                        }
+                    }
+                    output << "]";
+                }
+                output << " } }" << (tile + 1 < tiles.size() ? ",\n" : "\n");
+            }
+            output << "] }\n";
+        }
+        else {
+            std::ofstream output(filepath);
+            for (size_t tile = 0; tile < tiles.size(); ++tile) {
+                output << "[TILE_" << tile << "]\n";
+                const char* directions[] = { "up", "down", "left", "right" };
+                for (size_t direction = 0; direction < 4; ++direction) {
+                    output << directions[direction] << "=";
+                    for (size_t option = 0; option < tiles.size(); ++option) {
+                        if (tiles[tile].options[direction].test(option)) {
+                            output << option << " ";
+                        }
+                    }
+                    output << "\n";
+                }
+                output << "weight=" << tiles[tile].weight << "\n\n";
+            }
+        }
+
+        written = filepath;
+        return written;
+    }
+
+    // Arguments: side of the square grid, number of tiles. Work and memory grow with cells * tiles, so the
+    // largest grids are only run with the smaller tilesets
+    void gridSizes(benchmark::internal::Benchmark* benchmark, uint64_t maxCellsTimesTiles) {
+        for (const int64_t tiles : { 4, 64, 512 }) {
+            for (const int64_t side : { 64, 256, 1024, 4096 }) {
+                if (static_cast<uint64_t>(side * side * tiles) <= maxCellsTimesTiles) {
+                    benchmark->Args({ side, tiles });
+                }
+            }
+        }
+        benchmark->ArgNames({ "side", "tiles" })->Unit(benchmark::kMillisecond);
+    }
+
+    void setCellCounters(benchmark::State& state, size_t cells) {
+        state.counters["cells/s"] = benchmark::Counter(static_cast<double>(cells * state.iterations()), benchmark::Counter::kIsRate);
+        state.counters["maps/s"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+    }
+
+} // end of anonymous namespace
+
+// Allocating and seeding the wave
+static void BM_Initialize(benchmark::State& state) {
+    const size_t side = static_cast<size_t>(state.range(0));
+    Solver solver;
+    solver.setRuleset(ruleset(static_cast<size_t>(state.range(1))));
+
+    for (auto _ : state) {
+        solver.initialize(side, side);
+        benchmark::DoNotOptimize(solver[0]);
+    }
+
+    setCellCounters(state, side * side);
+}
+BENCHMARK(BM_Initialize)->Apply([](benchmark::internal::Benchmark* benchmark) { gridSizes(benchmark, uint64_t{ 1 } << 32); });
+
+// Loading rules in the text and JSON formats, and mapping a compiled binary ruleset
+static void BM_LoadText(benchmark::State& state) {
+    const std::string& filepath = rulesetFile(static_cast<size_t>(state.range(0)), ".txt");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Ruleset::loadText(filepath));
+    }
+}
+BENCHMARK(BM_LoadText)->ArgName("tiles")->Arg(4)->Arg(64)->Arg(512)->Unit(benchmark::kMicrosecond);
+
+static void BM_LoadJson(benchmark::State& state) {
+    const std::string& filepath = rulesetFile(static_cast<size_t>(state.range(0)), ".json");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Ruleset::loadJson(filepath));
+    }
+}
+BENCHMARK(BM_LoadJson)->ArgName("tiles")->Arg(4)->Arg(64)->Arg(512)->Unit(benchmark::kMicrosecond);
+
+static void BM_LoadBinary(benchmark::State& state) {
+    const std::string& filepath = rulesetFile(static_cast<size_t>(state.range(0)), ".wfcr");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Solver::CompiledRuleset::load(filepath));
+    }
+}
+BENCHMARK(BM_LoadBinary)->ArgName("tiles")->Arg(4)->Arg(64)->Arg(512)->Unit(benchmark::kMicrosecond);
+
+// Extracting the 3x3 patterns of a sample with all 8 symmetries; the sample is a few overlapping stripes
+// with sparse noise, which gives a few thousand distinct patterns at 512x512
+static void BM_ExtractPatterns(benchmark::State& state) {
+    const size_t side = static_cast<size_t>(state.range(0));
+    std::vector<uint32_t> sample(side * side);
+    for (size_t y = 0; y < side; ++y) {
+        for (size_t x = 0; x < side; ++x) {
+            sample[y * side + x] = static_cast<uint32_t>(((x / 5) + (y / 7) * 2 + ((x * 31 + y * 17) % 97 == 0 ? 1 : 0)) % 4);
+        }
+    }
+
+    wfc2d::OverlappingOptions options;
+    options.symmetry = 8;
+    size_t patterns = 0;
+    for (auto _ : state) {
+        const auto model = wfc2d::OverlappingModel::extract(sample, side, side, options);
+        patterns = model ? model->size() : 0;
+        benchmark::DoNotOptimize(model);
+    }
+
+    state.counters["patterns"] = static_cast<double>(patterns);
+    state.counters["pixels/s"] = benchmark::Counter(static_cast<double>(side * side * state.iterations()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ExtractPatterns)->ArgName("side")->Arg(128)->Arg(512)->Unit(benchmark::kMillisecond);
+
+// Propagating one collapse in the middle of a fresh wave, with the wave reseeding left out of the timing
+static void BM_Propagate(benchmark::State& state) {
+    const size_t side = static_cast<size_t>(state.range(0));
+    const size_t tiles = static_cast<size_t>(state.range(1));
+
+    Solver solver;
+    solver.setRuleset(ruleset(tiles));
+    solver.initialize(side, side);
+
+    const size_t center = side / 2 * side + side / 2;
+    uint64_t iteration = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        solver.reset();
+        solver.collapse(center, iteration++ % tiles);
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(solver.propagate());
+    }
+
+    state.counters["propagations/s"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Propagate)->Apply([](benchmark::internal::Benchmark* benchmark) { gridSizes(benchmark, uint64_t{ 1 } << 32); });
+
+// Propagation of a lattice of collapses every 8 rows and columns, which revises the whole grid; the lattice
+// tiles can always be joined, so every run reaches the fixpoint
+template <typename Wfc>
+static void propagateLattice(benchmark::State& state, Wfc& solver, size_t tiles) {
+    const size_t side = static_cast<size_t>(state.range(0));
+    solver.initialize(side, side);
+
+    uint64_t iteration = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        solver.reset();
+        for (size_t row = 0; row < side; row += 8) {
+            for (size_t col = 0; col < side; col += 8) {
+                solver.collapse(row * side + col, (iteration + row + col) % tiles);
+            }
+        }
+        ++iteration;
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(solver.propagate());
+    }
+
+    setCellCounters(state, side * side);
+}
+
+// The same ruleset through the generic kernels and compiled into the solver
+template <size_t NumTiles>
+static void BM_PropagateRuntimeRules(benchmark::State& state) {
+    Solver solver;
+    solver.setRuleset(StaticSolver<NumTiles>::ruleset());
+    propagateLattice(state, solver, NumTiles);
+}
+
+template <size_t NumTiles>
+static void BM_PropagateStaticRules(benchmark::State& state) {
+    StaticSolver<NumTiles> solver;
+    propagateLattice(state, solver, NumTiles);
+}
+BENCHMARK_TEMPLATE(BM_PropagateRuntimeRules, 8)->ArgName("side")->Arg(256)->Arg(1024)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_PropagateStaticRules, 8)->ArgName("side")->Arg(256)->Arg(1024)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_PropagateRuntimeRules, 64)->ArgName("side")->Arg(256)->Arg(1024)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_PropagateStaticRules, 64)->ArgName("side")->Arg(256)->Arg(1024)->Unit(benchmark::kMillisecond);
+
+// The lattice on large grids with AC-3 spread over several threads; 1 thread is the sequential propagator.
+// Wall time is what the threads save, so it is the one reported
+static void BM_PropagateThreads(benchmark::State& state) {
+    const size_t tiles = static_cast<size_t>(state.range(1));
+
+    Solver solver;
+    solver.setRuleset(ruleset(tiles));
+    solver.setPropagationThreads(static_cast<size_t>(state.range(2)));
+    propagateLattice(state, solver, tiles);
+}
+BENCHMARK(BM_PropagateThreads)->ArgNames({ "side", "tiles", "threads" })
+    ->ArgsProduct({ { 1024, 2048 }, { 4, 64 }, { 1, 2, 4, 8 } })->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Complete solves from a fresh wave; map i is drawn with seed i, so runs are repeatable
+static void BM_Solve(benchmark::State& state) {
+    const size_t side = static_cast<size_t>(state.range(0));
+
+    Solver solver;
+    solver.setRuleset(ruleset(static_cast<size_t>(state.range(1))));
+    solver.setMaxRestarts(100);
+
+    uint64_t seed = 0;
+    size_t attempts = 0;
+    size_t contradictions = 0;
+    size_t failures = 0;
+    for (auto _ : state) {
+        solver.setSeed(seed++);
+        solver.initialize(side, side);
+        const bool solved = solver.run();
+
+        attempts += solver.getAttempts();
+        contradictions += solver.getAttempts() - (solved ? 1 : 0);
+        failures += solved ? 0 : 1;
+    }
+
+    setCellCounters(state, side * side);
+    state.counters["contradiction_rate"] = attempts > 0 ? static_cast<double>(contradictions) / static_cast<double>(attempts) : 0.0;
+    state.counters["failed_maps"] = static_cast<double>(failures);
+}
+BENCHMARK(BM_Solve)->Apply([](benchmark::internal::Benchmark* benchmark) { gridSizes(benchmark, uint64_t{ 1 } << 26); });
+
+// Checkpointing a half solved wave into a reused buffer and restoring it into a second solver, which is
+// what a checkpoint and its resume cost on top of writing and mapping the file
+static void BM_SnapshotRestore(benchmark::State& state) {
+    const size_t side = static_cast<size_t>(state.range(0));
+    const size_t tiles = static_cast<size_t>(state.range(1));
+
+    // A backtracking run stopped halfway, so the trail is part of the snapshot
+    std::atomic<bool> stop{ false };
+    Solver solver;
+    solver.setRuleset(ruleset(tiles));
+    solver.setBacktracking(true);
+    solver.setStopFlag(&stop);
+    solver.setProgressCallback([&stop]() { stop.store(true); }, side * side / 2);
+    solver.initialize(side, side);
+    solver.run();
+
+    Solver restored;
+    restored.setRuleset(ruleset(tiles));
+    restored.initialize(side, side);
+
+    std::vector<unsigned char> buffer;
+    for (auto _ : state) {
+        solver.snapshot(buffer);
+        benchmark::DoNotOptimize(restored.restore(buffer));
+    }
+
+    state.counters["bytes"] = static_cast<double>(buffer.size());
+    state.counters["bytes/s"] = benchmark::Counter(static_cast<double>(buffer.size() * state.iterations()), benchmark::Counter::kIsRate, benchmark::Counter::kIs1024);
+}
+BENCHMARK(BM_SnapshotRestore)->ArgNames({ "side", "tiles" })->Args({ 256, 4 })->Args({ 256, 64 })->Args({ 1024, 4 })->Unit(benchmark::kMillisecond);
+
+// Batches of small maps on a solver pool using every hardware thread, the way a map service would run;
+// the pool and the result buffers are reused, so after the first batch nothing is allocated
+static void BM_SolveBatch(benchmark::State& state) {
+    const size_t side = static_cast<size_t>(state.range(0));
+    const size_t maps = 256;
+
+    wfc2d::BatchSolver batch;
+    batch.setCompiledRuleset(ruleset(static_cast<size_t>(state.range(1)))->compiled());
+    batch.setMaxRestarts(100);
+
+    std::vector<wfc2d::BatchRequest> requests(maps);
+    std::vector<wfc2d::BatchResult> results;
+    uint64_t seed = 0;
+    size_t failures = 0;
+    for (auto _ : state) {
+        for (auto& request : requests) {
+            request = { side, side, seed++ };
+        }
+        failures += maps - batch.solveBatch(requests, results);
+    }
+
+    setCellCounters(state, side * side * maps);
+    state.counters["maps/s"] = benchmark::Counter(static_cast<double>(maps * state.iterations()), benchmark::Counter::kIsRate);
+    state.counters["failed_maps"] = static_cast<double>(failures);
+}
+BENCHMARK(BM_SolveBatch)->ArgNames({ "side", "tiles" })->Args({ 16, 4 })->Args({ 16, 64 })->Args({ 32, 4 })->Args({ 32, 64 })->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// One large map cut into 64x64 chunks, against the thread count; a 1024 map has 16 chunks along each side,
+// so up to 16 of them can run at once
+static void BM_ChunkedGenerate(benchmark::State& state) {
+    const size_t side = static_cast<size_t>(state.range(0));
+
+    wfc2d::ChunkedGenerator generator(static_cast<size_t>(state.range(1)));
+    generator.setCompiledRuleset(ruleset(4)->compiled());
+
+    uint64_t seed = 0;
+    size_t failures = 0;
+    for (auto _ : state) {
+        generator.setSeed(seed++);
+        failures += generator.generate(side, side) ? 0 : 1;
+    }
+
+    setCellCounters(state, side * side);
+    state.counters["failed_maps"] = static_cast<double>(failures);
+}
+BENCHMARK(BM_ChunkedGenerate)->ArgNames({ "side", "threads" })->ArgsProduct({ { 512, 1024 }, { 1, 2, 4, 8 } })->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "span.hpp"
+#include "thread_pool.hpp"
+#include "wfc2d.hpp"
+
+namespace wfc2d {
+
+    /**
+     * @brief One map of a batch.
+     */
+    struct BatchRequest {
+        size_t rows{ 0 };
+        size_t cols{ 0 };
+        uint64_t seed{ 0 };
+        EBoundary boundary{ EBoundary::Fixed };
+    };
+
+    /**
+     * @brief Outcome of one map of a batch.
+     */
+    struct BatchResult {
+        EStatus status{ EStatus::Ok };
+        size_t attempts{ 0 };         /**< Attempts the solver needed, see WaveFunctionCollapse2D::getAttempts(). */
+        std::vector<TileIndex> tiles; /**< The map in row-major order, empty if it could not be solved. */
+    };
+
+    /**
+     * @brief Solves many independent maps on a pool of reusable solvers.
+     *
+     * Every worker of the thread pool owns one WaveFunctionCollapse2D, its context, and claims requests from
+     * a shared counter until the batch is done. A context is never released between jobs: initialize()
+     * resizes its wave, output, trail and propagation buffers in place, so they act as a per-thread arena
+     * that grows to the largest map the worker has seen and is then recycled. The result tiles are copied
+     * into the caller's BatchResult vectors, which keep their capacity as well; once both have warmed up,
+     * solving a batch does not allocate.
+     *
+     * Map i only depends on the ruleset, the options and requests[i], never on the worker that drew it or
+     * on the number of threads.
+     */
+    class BatchSolver {
+    public:
+        using Solver = WaveFunctionCollapse2D;
+        using Ruleset = Solver::Ruleset;
+        using CompiledRuleset = Solver::CompiledRuleset;
+        using EPropagation = Solver::EPropagation;
+
+        /**
+         * @param numThreads Number of worker threads including the calling one; 0 uses every hardware thread.
+         */
+        explicit BatchSolver(size_t numThreads = 0)
+            : m_pool(numThreads), m_solvers(m_pool.size()) {
+            // Captures nothing but this, so the task fits in the small buffer of std::function and is built once
+            this->m_task = [this](size_t task, size_t worker) { solveRequest(this->m_solvers[worker], task); };
+        }
+
+        BatchSolver(const BatchSolver&) = delete;
+        BatchSolver& operator=(const BatchSolver&) = delete;
+
+        /**
+         * @brief Loads the ruleset shared by every map from a file.
+         *
+         * @param filepath Path of the ruleset file.
+         * @return True if at least one tile was loaded.
+         */
+        bool parseRulesFromFile(const std::string& filepath) {
+            const auto ruleset = Ruleset::load(filepath, &this->m_status);
+            if (!ruleset || ruleset->empty()) {
+                if (ruleset) {
+                    this->m_status = EStatus::NoRuleset;
+                }
+                return false;
+            }
+
+            setCompiledRuleset(ruleset->compiled());
+            return true;
+        }
+
+        void setCompiledRuleset(std::shared_ptr<const CompiledRuleset> ruleset) {
+            for (auto& solver : this->m_solvers) {
+                solver.setCompiledRuleset(ruleset);
+            }
+            this->m_ruleset = std::move(ruleset);
+        }
+
+        std::shared_ptr<const CompiledRuleset> getCompiledRuleset() const {
+            return this->m_ruleset;
+        }
+
+        void setPropagation(EPropagation propagation) {
+            for (auto& solver : this->m_solvers) {
+                solver.setPropagation(propagation);
+            }
+        }
+
+        /**
+         * @brief Lets the solvers backtrack instead of only restarting on contradictions.
+         */
+        void setBacktracking(bool enabled) {
+            for (auto& solver : this->m_solvers) {
+                solver.setBacktracking(enabled);
+            }
+        }
+
+        /**
+         * @brief Sets how many times a map is restarted after a contradiction before it is given up.
+         */
+        void setMaxRestarts(size_t maxRestarts) {
+            for (auto& solver : this->m_solvers) {
+                solver.setMaxRestarts(maxRestarts);
+            }
+        }
+
+        size_t getThreadCount() const {
+            return this->m_pool.size();
+        }
+
+        /**
+         * @brief Solves every request of a batch.
+         *
+         * @param requests Maps to solve.
+         * @param results Resized to one result per request; pass the same vector again to reuse its buffers.
+         * @return Number of maps solved. getStatus() is Ok if all of them were, otherwise the status of the
+         * first map that failed.
+         */
+        size_t solveBatch(Span<const BatchRequest> requests, std::vector<BatchResult>& results) {
+            results.resize(requests.size());
+
+            if (!this->m_ruleset || this->m_ruleset->numTiles == 0) {
+                internal::log<ELogLevel::Error>("No ruleset loaded.");
+                for (auto& result : results) {
+                    result.status = EStatus::NoRuleset;
+                    result.attempts = 0;
+                    result.tiles.clear();
+                }
+                this->m_status = EStatus::NoRuleset;
+                return 0;
+            }
+
+            this->m_requests = requests;
+            this->m_results = results;
+            this->m_pool.parallelFor(requests.size(), this->m_task);
+            this->m_requests = {};
+            this->m_results = {};
+
+            size_t solved = 0;
+            this->m_status = EStatus::Ok;
+            for (const auto& result : results) {
+                if (result.status == EStatus::Ok) {
+                    ++solved;
+                }
+                else if (this->m_status == EStatus::Ok) {
+                    this->m_status = result.status;
+                }
+            }
+            return solved;
+        }
+
+        /**
+         * @brief Gets the outcome of the last solveBatch() or parseRulesFromFile().
+         */
+        EStatus getStatus() const {
+            return this->m_status;
+        }
+
+    private:
+        void solveRequest(Solver& solver, size_t task) {
+            const BatchRequest& request = this->m_requests[task];
+            BatchResult& result = this->m_results[task];
+            assert(request.rows * request.cols > 0);
+
+            solver.setNextSeed(request.seed);
+            solver.initialize(request.rows, request.cols, request.boundary);
+            const bool solved = solver.run();
+
+            result.status = solver.getStatus();
+            result.attempts = solver.getAttempts();
+            if (solved) {
+                result.tiles.assign(solver.begin(), solver.end());
+            }
+            else {
+                result.tiles.clear();
+            }
+        }
+
+        internal::ThreadPool m_pool;
+        std::vector<Solver> m_solvers; /**< One context per worker, reused across jobs and batches. */
+        std::function<void(size_t, size_t)> m_task;
+
+        std::shared_ptr<const CompiledRuleset> m_ruleset;
+
+        Span<const BatchRequest> m_requests; /**< The batch being solved, only set inside solveBatch(). */
+        Span<BatchResult> m_results;
+        EStatus m_status{ EStatus::Ok };
+    };
+
+} // end of namespace wfc2d
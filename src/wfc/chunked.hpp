@@ -0,0 +1,352 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "thread_pool.hpp"
+#include "wfc2d.hpp"
+
+namespace wfc2d {
+
+    /**
+     * @brief Generates maps too large for one solver by splitting them into chunks solved in parallel.
+     *
+     * The grid is cut into square chunks that are solved by ordinary WaveFunctionCollapse2D instances, one
+     * per worker thread. Every chunk only borders its already solved neighbours above and to the left, so it
+     * becomes ready as soon as those two are solved: the workers take ready chunks from a shared queue, and a
+     * slow chunk only holds back the chunks below and to the right of it, not a whole anti-diagonal. Since a
+     * chunk waits for everything above and to the left of it, no running chunk lies below and to the right
+     * of another: at most min(chunk rows, chunk columns) chunks run at once, fewer near the first and last
+     * corners of the map, and threads beyond that stay idle.
+     *
+     * Seams are stitched through a one-cell halo: the chunk solver is given the border cells of the already
+     * solved neighbours, collapsed to their final tiles, and propagation carries their constraints into the
+     * chunk before it is solved. Constraining two sides keeps the boundary an open path; a checkerboard order
+     * would pin later chunks on all four sides, and a closed ring of fixed tiles is far more likely to admit
+     * no solution at all. Chunks that hit a contradiction are retried with the next draws of their seed. The
+     * result only depends on the seed and the chunk size, not on the number of threads.
+     */
+    class ChunkedGenerator {
+    public:
+        using Solver = WaveFunctionCollapse2D;
+        using Ruleset = Solver::Ruleset;
+        using CompiledRuleset = Solver::CompiledRuleset;
+        using EPropagation = Solver::EPropagation;
+
+        static constexpr size_t DEFAULT_CHUNK_SIZE = 64;
+        static constexpr size_t DEFAULT_MAX_CHUNK_ATTEMPTS = 32;
+
+        /**
+         * @param numThreads Number of worker threads including the calling one; 0 uses every hardware thread.
+         */
+        explicit ChunkedGenerator(size_t numThreads = 0)
+            : m_pool(numThreads), m_solvers(m_pool.size()) {}
+
+        /**
+         * @brief Loads the ruleset shared by every chunk from a file.
+         *
+         * @param filepath Path of the ruleset file.
+         * @return True if at least one tile was loaded.
+         */
+        bool parseRulesFromFile(const std::string& filepath) {
+            const auto ruleset = Ruleset::load(filepath, &this->m_status);
+            if (!ruleset || ruleset->empty()) {
+                if (ruleset) {
+                    this->m_status = EStatus::NoRuleset;
+                }
+                return false;
+            }
+
+            setCompiledRuleset(ruleset->compiled());
+            return true;
+        }
+
+        void setCompiledRuleset(std::shared_ptr<const CompiledRuleset> ruleset) {
+            this->m_ruleset = std::move(ruleset);
+        }
+
+        std::shared_ptr<const CompiledRuleset> getCompiledRuleset() const {
+            return this->m_ruleset;
+        }
+
+        /**
+         * @brief Sets the side length of the chunks.
+         *
+         * Larger chunks give fewer seams and less halo work; smaller ones more parallelism and cheaper retries.
+         */
+        void setChunkSize(size_t chunkSize) {
+            assert(chunkSize > 0);
+            this->m_chunkSize = chunkSize;
+        }
+
+        size_t getChunkSize() const {
+            return this->m_chunkSize;
+        }
+
+        void setSeed(uint64_t seed) {
+            this->m_seed = seed;
+        }
+
+        void setPropagation(EPropagation propagation) {
+            this->m_propagation = propagation;
+        }
+
+        /**
+         * @brief Lets the chunk solvers backtrack instead of only restarting on contradictions.
+         */
+        void setBacktracking(bool enabled) {
+            this->m_backtracking = enabled;
+        }
+
+        /**
+         * @brief Sets how many times a chunk is attempted before generate() gives up.
+         */
+        void setMaxChunkAttempts(size_t maxChunkAttempts) {
+            assert(maxChunkAttempts > 0);
+            this->m_maxChunkAttempts = maxChunkAttempts;
+        }
+
+        size_t getThreadCount() const {
+            return this->m_pool.size();
+        }
+
+        /**
+         * @brief Generates a map.
+         *
+         * @param rows Number of rows in the map.
+         * @param cols Number of columns in the map.
+         * @return True if every chunk was solved, false otherwise; getStatus() tells why.
+         */
+        bool generate(size_t rows, size_t cols) {
+            assert(rows * cols > 0);
+
+            if (!this->m_ruleset || this->m_ruleset->numTiles == 0) {
+                internal::log<ELogLevel::Error>("No ruleset loaded.");
+                this->m_status = EStatus::NoRuleset;
+                return false;
+            }
+
+            this->m_rows = rows;
+            this->m_cols = cols;
+            this->m_output.assign(rows * cols, NO_TILE);
+
+            this->m_chunkRows = (rows + this->m_chunkSize - 1) / this->m_chunkSize;
+            this->m_chunkCols = (cols + this->m_chunkSize - 1) / this->m_chunkSize;
+
+            for (auto& solver : this->m_solvers) {
+                solver.setCompiledRuleset(this->m_ruleset);
+                solver.setPropagation(this->m_propagation);
+                solver.setBacktracking(this->m_backtracking);
+                // Restarts are driven by solveChunk() so that the halo is pinned again every time
+                solver.setMaxRestarts(0);
+            }
+
+            const size_t numChunks = this->m_chunkRows * this->m_chunkCols;
+            this->m_waitingOn.resize(numChunks);
+            for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+                this->m_waitingOn[chunk] = static_cast<uint8_t>((chunk >= this->m_chunkCols) + (chunk % this->m_chunkCols > 0));
+            }
+            this->m_readyChunks.clear();
+            this->m_readyChunks.reserve(numChunks);
+            this->m_readyChunks.push_back(0);
+            this->m_chunksLeft = numChunks;
+            this->m_failed = false;
+
+            // One long-running task per worker, each taking chunks until the map is done
+            this->m_pool.parallelFor(this->m_pool.size(), [this](size_t, size_t worker) { solveReadyChunks(this->m_solvers[worker]); });
+
+            if (this->m_failed) {
+                internal::log<ELogLevel::Warning>("Unable to solve a chunk.");
+                this->m_status = EStatus::Contradiction;
+                return false;
+            }
+
+            this->m_status = EStatus::Ok;
+            return true;
+        }
+
+        /**
+         * @brief Gets the outcome of the last generate() or parseRulesFromFile().
+         */
+        EStatus getStatus() const {
+            return this->m_status;
+        }
+
+        size_t getRows() const {
+            return this->m_rows;
+        }
+
+        size_t getCols() const {
+            return this->m_cols;
+        }
+
+        size_t size() const {
+            return this->m_output.size();
+        }
+
+        const TileIndex& at(size_t index) const {
+            return this->m_output.at(index);
+        }
+
+        const TileIndex& operator[](size_t index) const {
+            return this->m_output[index];
+        }
+
+        /**
+         * @brief Gets the generated map in row-major order.
+         */
+        const std::vector<TileIndex>& getOutput() const {
+            return this->m_output;
+        }
+
+        Solver::const_iterator begin() const {
+            return this->m_output.data();
+        }
+
+        Solver::const_iterator end() const {
+            return this->m_output.data() + this->m_output.size();
+        }
+
+        /**
+         * @brief Gets one row of the generated map, without copying.
+         */
+        Span<const TileIndex> getRow(size_t row) const {
+            assert(row < this->m_rows);
+            return Span<const TileIndex>(this->m_output).subspan(row * this->m_cols, this->m_cols);
+        }
+
+    private:
+        /**
+         * @brief Solves ready chunks until every chunk is solved or one of them failed.
+         */
+        void solveReadyChunks(Solver& solver) {
+            std::unique_lock<std::mutex> lock(this->m_scheduleMutex);
+            while (true) {
+                this->m_chunkReady.wait(lock, [this]() { return !this->m_readyChunks.empty() || this->m_chunksLeft == 0 || this->m_failed; });
+                if (this->m_chunksLeft == 0 || this->m_failed) {
+                    return;
+                }
+
+                const size_t chunk = this->m_readyChunks.back();
+                this->m_readyChunks.pop_back();
+
+                lock.unlock();
+                const bool solved = solveChunk(solver, chunk);
+                lock.lock();
+
+                if (!solved) {
+                    this->m_failed = true;
+                    this->m_chunkReady.notify_all();
+                    return;
+                }
+
+                // The chunks to the right and below may now have both of their neighbours
+                --this->m_chunksLeft;
+                if (chunk % this->m_chunkCols + 1 < this->m_chunkCols && --this->m_waitingOn[chunk + 1] == 0) {
+                    this->m_readyChunks.push_back(chunk + 1);
+                }
+                if (chunk + this->m_chunkCols < this->m_waitingOn.size() && --this->m_waitingOn[chunk + this->m_chunkCols] == 0) {
+                    this->m_readyChunks.push_back(chunk + this->m_chunkCols);
+                }
+                this->m_chunkReady.notify_all();
+            }
+        }
+
+        /**
+         * @brief Solves one chunk against the final tiles of its already solved neighbours.
+         */
+        bool solveChunk(Solver& solver, size_t chunk) {
+            const size_t chunkRow = chunk / this->m_chunkCols;
+            const size_t chunkCol = chunk % this->m_chunkCols;
+
+            const size_t rowBegin = chunkRow * this->m_chunkSize;
+            const size_t rowEnd = std::min(rowBegin + this->m_chunkSize, this->m_rows);
+            const size_t colBegin = chunkCol * this->m_chunkSize;
+            const size_t colEnd = std::min(colBegin + this->m_chunkSize, this->m_cols);
+
+            // Only the neighbours above and to the left are solved before this chunk
+            const size_t top = rowBegin - (chunkRow > 0);
+            const size_t left = colBegin - (chunkCol > 0);
+            const size_t height = rowEnd - top;
+            const size_t width = colEnd - left;
+
+            // Distinct, thread-count independent draws for every chunk
+            solver.setNextSeed(this->m_seed ^ (static_cast<uint64_t>(chunk) * 0x9E3779B97F4A7C15ull));
+            solver.initialize(height, width);
+
+            for (size_t attempt = 0; attempt < this->m_maxChunkAttempts; ++attempt) {
+                if (attempt > 0) {
+                    solver.reset();
+                }
+
+                bool pinned = true;
+                for (size_t row = 0; row < height && pinned; ++row) {
+                    for (size_t col = 0; col < width; ++col) {
+                        const size_t globalRow = top + row;
+                        const size_t globalCol = left + col;
+                        const bool inside = globalRow >= rowBegin && globalRow < rowEnd && globalCol >= colBegin && globalCol < colEnd;
+                        if (inside) {
+                            continue;
+                        }
+
+                        if (!solver.collapse(row * width + col, this->m_output[globalRow * this->m_cols + globalCol])) {
+                            pinned = false;
+                            break;
+                        }
+                    }
+                }
+
+                if (!pinned) {
+                    return false;
+                }
+
+                if (!solver.run()) {
+                    continue;
+                }
+
+                for (size_t row = rowBegin; row < rowEnd; ++row) {
+                    for (size_t col = colBegin; col < colEnd; ++col) {
+                        this->m_output[row * this->m_cols + col] = solver[(row - top) * width + (col - left)];
+                    }
+                }
+                return true;
+            }
+
+            return false;
+        }
+
+        internal::ThreadPool m_pool;
+        std::vector<Solver> m_solvers; /**< One solver per worker, reused across chunks. */
+
+        std::shared_ptr<const CompiledRuleset> m_ruleset;
+        EPropagation m_propagation{ EPropagation::ArcConsistency };
+        bool m_backtracking{ false };
+
+        size_t m_chunkSize{ DEFAULT_CHUNK_SIZE };
+        size_t m_maxChunkAttempts{ DEFAULT_MAX_CHUNK_ATTEMPTS };
+        uint64_t m_seed{ 0 };
+
+        size_t m_rows{ 0 };
+        size_t m_cols{ 0 };
+        size_t m_chunkRows{ 0 };
+        size_t m_chunkCols{ 0 };
+        std::vector<TileIndex> m_output;
+        EStatus m_status{ EStatus::Ok };
+
+        std::mutex m_scheduleMutex;           /**< Guards the schedule below while generate() runs. */
+        std::condition_variable m_chunkReady;
+        std::vector<uint8_t> m_waitingOn;     /**< Per chunk, neighbours above and to the left not solved yet. */
+        std::vector<size_t> m_readyChunks;    /**< Chunks whose neighbours are solved, not yet taken by a worker. */
+        size_t m_chunksLeft{ 0 };
+        bool m_failed{ false };
+    };
+
+} // end of namespace wfc2d
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace wfc2d {
+
+    namespace internal {
+
+        /**
+         * @brief Number of tile bits held by one domain word.
+         */
+        static constexpr size_t BITS_PER_WORD = 64;
+
+        /**
+         * @brief Gets the number of words needed to hold a domain of the given number of tiles.
+         */
+        constexpr size_t wordsForTiles(size_t numTiles) {
+            return (numTiles + BITS_PER_WORD - 1) / BITS_PER_WORD;
+        }
+
+        inline size_t popcount(uint64_t word) {
+#if defined(_MSC_VER)
+            return static_cast<size_t>(__popcnt64(word));
+#else
+            return static_cast<size_t>(__builtin_popcountll(word));
+#endif
+        }
+
+        /**
+         * @brief Gets the index of the lowest set bit.
+         * @warning The word must not be zero.
+         */
+        inline size_t countTrailingZeros(uint64_t word) {
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward64(&index, word);
+            return static_cast<size_t>(index);
+#else
+            return static_cast<size_t>(__builtin_ctzll(word));
+#endif
+        }
+
+        /**
+         * @brief Word count of a domain, either fixed at compile time or given at runtime.
+         *
+         * The propagation kernels are instantiated for 1, 2 and 4 words (64, 128 and 256 tiles) so that the
+         * compiler can unroll their word loops and keep small domains in registers. Words = 0 is the dynamic
+         * fallback used for every other width.
+         *
+         * @tparam Words Number of 64-bit words per domain, or 0 for a runtime-sized domain.
+         */
+        template <size_t Words>
+        struct DomainWidth {
+            static constexpr size_t words(size_t) { return Words; }
+        };
+
+        template <>
+        struct DomainWidth<0> {
+            static size_t words(size_t runtimeWords) { return runtimeWords; }
+        };
+
+        /**
+         * @brief Operations on a domain stored as a span of words.
+         *
+         * Domains are not objects of their own; they live in flat word planes (the wave, the compiled
+         * masks) and these helpers work on a pointer to their first word.
+         */
+        template <size_t Words>
+        struct DomainOps {
+            static size_t count(const uint64_t* domain, size_t runtimeWords) {
+                const size_t words = DomainWidth<Words>::words(runtimeWords);
+                size_t result = 0;
+                for (size_t w = 0; w < words; ++w) {
+                    result += popcount(domain[w]);
+                }
+                return result;
+            }
+
+            static bool none(const uint64_t* domain, size_t runtimeWords) {
+                const size_t words = DomainWidth<Words>::words(runtimeWords);
+                uint64_t any = 0;
+                for (size_t w = 0; w < words; ++w) {
+                    any |= domain[w];
+                }
+                return any == 0;
+            }
+
+            static void clear(uint64_t* domain, size_t runtimeWords) {
+                const size_t words = DomainWidth<Words>::words(runtimeWords);
+                for (size_t w = 0; w < words; ++w) {
+                    domain[w] = 0;
+                }
+            }
+
+            /**
+             * @brief ORs a mask into a domain.
+             */
+            static void unite(uint64_t* domain, const uint64_t* mask, size_t runtimeWords) {
+                const size_t words = DomainWidth<Words>::words(runtimeWords);
+                for (size_t w = 0; w < words; ++w) {
+                    domain[w] |= mask[w];
+                }
+            }
+
+            /**
+             * @brief ANDs a mask into a domain.
+             *
+             * @return True if the domain lost at least one bit.
+             */
+            static bool intersect(uint64_t* domain, const uint64_t* mask, size_t runtimeWords) {
+                const size_t words = DomainWidth<Words>::words(runtimeWords);
+                uint64_t removed = 0;
+                for (size_t w = 0; w < words; ++w) {
+                    removed |= domain[w] & ~mask[w];
+                    domain[w] &= mask[w];
+                }
+                return removed != 0;
+            }
+
+            /**
+             * @brief ANDs a mask into a domain and calls fn(bit) for every bit that was removed.
+             *
+             * @return Number of bits removed.
+             */
+            template <typename Fn>
+            static size_t intersect(uint64_t* domain, const uint64_t* mask, size_t runtimeWords, Fn&& fn) {
+                const size_t words = DomainWidth<Words>::words(runtimeWords);
+                size_t removedCount = 0;
+                for (size_t w = 0; w < words; ++w) {
+                    const uint64_t removed = domain[w] & ~mask[w];
+                    if (removed == 0) {
+                        continue;
+                    }
+
+                    domain[w] &= mask[w];
+                    removedCount += popcount(removed);
+                    for (uint64_t word = removed; word != 0; word &= word - 1) {
+                        fn(w * BITS_PER_WORD + countTrailingZeros(word));
+                    }
+                }
+                return removedCount;
+            }
+
+            /**
+             * @brief Calls fn(bit) for every set bit of the domain, in increasing order.
+             */
+            template <typename Fn>
+            static void forEach(const uint64_t* domain, size_t runtimeWords, Fn&& fn) {
+                const size_t words = DomainWidth<Words>::words(runtimeWords);
+                for (size_t w = 0; w < words; ++w) {
+                    for (uint64_t word = domain[w]; word != 0; word &= word - 1) {
+                        fn(w * BITS_PER_WORD + countTrailingZeros(word));
+                    }
+                }
+            }
+        };
+
+        inline bool testBit(const uint64_t* domain, size_t bit) {
+            return (domain[bit / BITS_PER_WORD] >> (bit % BITS_PER_WORD)) & 1u;
+        }
+
+        inline void setBit(uint64_t* domain, size_t bit) {
+            domain[bit / BITS_PER_WORD] |= uint64_t{ 1 } << (bit % BITS_PER_WORD);
+        }
+
+        inline void resetBit(uint64_t* domain, size_t bit) {
+            domain[bit / BITS_PER_WORD] &= ~(uint64_t{ 1 } << (bit % BITS_PER_WORD));
+        }
+
+        // Word access for parallel propagation, where several threads narrow the domains of one wave. The
+        // wave stays a plain uint64_t plane so that sequential code keeps using it without atomics.
+
+        inline uint64_t atomicLoad(const uint64_t* word) {
+#if defined(_MSC_VER)
+            return *reinterpret_cast<const volatile uint64_t*>(word);
+#else
+            return __atomic_load_n(word, __ATOMIC_RELAXED);
+#endif
+        }
+
+        /**
+         * @brief Atomically ANDs a mask into a word.
+         *
+         * @return The value of the word before the operation.
+         */
+        inline uint64_t atomicFetchAnd(uint64_t* word, uint64_t mask) {
+#if defined(_MSC_VER)
+            return static_cast<uint64_t>(_InterlockedAnd64(reinterpret_cast<volatile __int64*>(word), static_cast<__int64>(mask)));
+#else
+            return __atomic_fetch_and(word, mask, __ATOMIC_RELAXED);
+#endif
+        }
+
+        /**
+         * @brief Atomically replaces a flag, with acquire-release ordering.
+         *
+         * @return The previous value of the flag.
+         */
+        inline uint8_t atomicExchange(uint8_t* flag, uint8_t value) {
+#if defined(_MSC_VER)
+            return static_cast<uint8_t>(_InterlockedExchange8(reinterpret_cast<volatile char*>(flag), static_cast<char>(value)));
+#else
+            return __atomic_exchange_n(flag, value, __ATOMIC_ACQ_REL);
+#endif
+        }
+
+    } // end of namespace internal
+
+    /**
+     * @brief Bitset whose size is only known at runtime.
+     *
+     * Used for the per-tile rules of a ruleset and for copies of wave domains handed to the user; it grows
+     * when a bit beyond its current size is set, so any tile ID can be stored.
+     */
+    class Bitset {
+    public:
+        Bitset() = default;
+
+        explicit Bitset(size_t size)
+            : m_words(internal::wordsForTiles(size), 0), m_size(size) {}
+
+        Bitset(const uint64_t* words, size_t size)
+            : m_words(words, words + internal::wordsForTiles(size)), m_size(size) {}
+
+        Bitset& set(size_t bit, bool value = true) {
+            if (bit >= m_size) {
+                resize(bit + 1);
+            }
+
+            if (value) {
+                internal::setBit(m_words.data(), bit);
+            }
+            else {
+                internal::resetBit(m_words.data(), bit);
+            }
+            return *this;
+        }
+
+        Bitset& reset(size_t bit) {
+            if (bit < m_size) {
+                internal::resetBit(m_words.data(), bit);
+            }
+            return *this;
+        }
+
+        bool test(size_t bit) const {
+            return bit < m_size && internal::testBit(m_words.data(), bit);
+        }
+
+        size_t count() const {
+            return internal::DomainOps<0>::count(m_words.data(), m_words.size());
+        }
+
+        bool none() const {
+            return internal::DomainOps<0>::none(m_words.data(), m_words.size());
+        }
+
+        bool any() const {
+            return !none();
+        }
+
+        /**
+         * @brief Gets the number of bits the bitset can hold.
+         */
+        size_t size() const {
+            return m_size;
+        }
+
+        void resize(size_t size) {
+            m_words.resize(internal::wordsForTiles(size), 0);
+            m_size = size;
+
+            // Keep the bits past the end cleared so that word-wise operations stay exact
+            if (size % internal::BITS_PER_WORD != 0) {
+                m_words.back() &= (uint64_t{ 1 } << (size % internal::BITS_PER_WORD)) - 1;
+            }
+        }
+
+        /**
+         * @brief Gets the lowest 64 bits as an integer.
+         */
+        unsigned long long to_ullong() const {
+            return m_words.empty() ? 0 : m_words.front();
+        }
+
+        unsigned long to_ulong() const {
+            return static_cast<unsigned long>(to_ullong());
+        }
+
+        const uint64_t* data() const {
+            return m_words.data();
+        }
+
+        /**
+         * @brief Compares the set bits, ignoring the sizes of both bitsets.
+         */
+        bool operator==(const Bitset& other) const {
+            const size_t words = std::max(m_words.size(), other.m_words.size());
+            for (size_t w = 0; w < words; ++w) {
+                const uint64_t a = w < m_words.size() ? m_words[w] : 0;
+                const uint64_t b = w < other.m_words.size() ? other.m_words[w] : 0;
+                if (a != b) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool operator!=(const Bitset& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        std::vector<uint64_t> m_words;
+        size_t m_size{ 0 };
+    };
+
+} // end of namespace wfc2d
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "domain.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define WFC_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define WFC_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(WFC_SIMD_AVX2) && !defined(_MSC_VER)
+#define WFC_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#else
+#define WFC_TARGET_AVX2
+#endif
+
+namespace wfc2d {
+
+    namespace internal {
+
+        /**
+         * @brief Kernels for the two loops that dominate propagation over wide domains.
+         *
+         * Domains of up to 256 tiles use the unrolled DomainOps instantiations; wider ones (8 to 16 words for
+         * 512 to 1024 tiles) go through one of these sets, picked once at startup from the features of the
+         * CPU. Every set computes exactly the same result as the scalar one.
+         */
+        struct DomainKernels {
+            const char* name;
+
+            /**
+             * @brief Writes to out the union of masks[option] over the set bits of domain.
+             *
+             * masks holds one mask of the given word count per option, back to back.
+             */
+            void (*uniteMasks)(uint64_t* out, const uint64_t* domain, const uint64_t* masks, size_t words);
+
+            /**
+             * @brief ANDs mask into domain and writes the bits that were cleared to removed.
+             *
+             * @return Number of bits left in the domain; zero means the domain is empty.
+             */
+            size_t (*intersect)(uint64_t* domain, const uint64_t* mask, uint64_t* removed, size_t words);
+        };
+
+        namespace kernels {
+
+            inline void uniteMasksScalar(uint64_t* out, const uint64_t* domain, const uint64_t* masks, size_t words) {
+                DomainOps<0>::clear(out, words);
+                DomainOps<0>::forEach(domain, words, [&](size_t option) {
+                    DomainOps<0>::unite(out, masks + option * words, words);
+                });
+            }
+
+            inline size_t intersectScalar(uint64_t* domain, const uint64_t* mask, uint64_t* removed, size_t words) {
+                size_t count = 0;
+                for (size_t w = 0; w < words; ++w) {
+                    removed[w] = domain[w] & ~mask[w];
+                    domain[w] &= mask[w];
+                    count += popcount(domain[w]);
+                }
+                return count;
+            }
+
+#if defined(WFC_SIMD_AVX2)
+            // Block of words kept in registers while the masks are ORed together
+            static constexpr size_t AVX2_BLOCK_WORDS = 16;
+
+            WFC_TARGET_AVX2 inline void uniteMasksAvx2(uint64_t* out, const uint64_t* domain, const uint64_t* masks, size_t words) {
+                for (size_t base = 0; base < words; base += AVX2_BLOCK_WORDS) {
+                    const size_t blockWords = std::min(AVX2_BLOCK_WORDS, words - base);
+                    const size_t vectors = blockWords / 4;
+
+                    __m256i acc0 = _mm256_setzero_si256();
+                    __m256i acc1 = _mm256_setzero_si256();
+                    __m256i acc2 = _mm256_setzero_si256();
+                    __m256i acc3 = _mm256_setzero_si256();
+                    uint64_t tail[3] = { 0, 0, 0 };
+
+                    // A plain loop rather than forEach: a lambda would not inherit the AVX2 target
+                    for (size_t domainWord = 0; domainWord < words; ++domainWord) {
+                        for (uint64_t bits = domain[domainWord]; bits != 0; bits &= bits - 1) {
+                            const size_t option = domainWord * BITS_PER_WORD + countTrailingZeros(bits);
+                            const uint64_t* mask = masks + option * words + base;
+                            switch (vectors) {
+                                case 4: acc3 = _mm256_or_si256(acc3, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + 12))); // fallthrough
+                                case 3: acc2 = _mm256_or_si256(acc2, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + 8)));  // fallthrough
+                                case 2: acc1 = _mm256_or_si256(acc1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + 4)));  // fallthrough
+                                case 1: acc0 = _mm256_or_si256(acc0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask)));      // fallthrough
+                                default: break;
+                            }
+                            for (size_t w = vectors * 4; w < blockWords; ++w) {
+                                tail[w - vectors * 4] |= mask[w];
+                            }
+                        }
+                    }
+
+                    __m256i* target = reinterpret_cast<__m256i*>(out + base);
+                    switch (vectors) {
+                        case 4: _mm256_storeu_si256(target + 3, acc3); // fallthrough
+                        case 3: _mm256_storeu_si256(target + 2, acc2); // fallthrough
+                        case 2: _mm256_storeu_si256(target + 1, acc1); // fallthrough
+                        case 1: _mm256_storeu_si256(target, acc0);     // fallthrough
+                        default: break;
+                    }
+                    for (size_t w = vectors * 4; w < blockWords; ++w) {
+                        out[base + w] = tail[w - vectors * 4];
+                    }
+                }
+            }
+
+            WFC_TARGET_AVX2 inline size_t intersectAvx2(uint64_t* domain, const uint64_t* mask, uint64_t* removed, size_t words) {
+                size_t count = 0;
+                size_t w = 0;
+                for (; w + 4 <= words; w += 4) {
+                    const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(domain + w));
+                    const __m256i allowed = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + w));
+                    const __m256i kept = _mm256_and_si256(value, allowed);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(removed + w), _mm256_andnot_si256(allowed, value));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(domain + w), kept);
+
+                    // AVX2 has no vector popcount; four hardware popcounts beat a nibble lookup at this width
+                    count += static_cast<size_t>(_mm_popcnt_u64(static_cast<uint64_t>(_mm256_extract_epi64(kept, 0))));
+                    count += static_cast<size_t>(_mm_popcnt_u64(static_cast<uint64_t>(_mm256_extract_epi64(kept, 1))));
+                    count += static_cast<size_t>(_mm_popcnt_u64(static_cast<uint64_t>(_mm256_extract_epi64(kept, 2))));
+                    count += static_cast<size_t>(_mm_popcnt_u64(static_cast<uint64_t>(_mm256_extract_epi64(kept, 3))));
+                }
+                for (; w < words; ++w) {
+                    removed[w] = domain[w] & ~mask[w];
+                    domain[w] &= mask[w];
+                    count += static_cast<size_t>(_mm_popcnt_u64(domain[w]));
+                }
+                return count;
+            }
+
+            inline bool cpuHasAvx2() {
+#if defined(_MSC_VER)
+                int info[4];
+                __cpuid(info, 0);
+                if (info[0] < 7) {
+                    return false;
+                }
+
+                // AVX needs OS support for saving the YMM registers (OSXSAVE, then XCR0 bits 1 and 2)
+                __cpuid(info, 1);
+                const bool osxsave = (info[2] & (1 << 27)) != 0;
+                const bool popcnt = (info[2] & (1 << 23)) != 0;
+                if (!osxsave || !popcnt || (_xgetbv(0) & 6) != 6) {
+                    return false;
+                }
+
+                __cpuidex(info, 7, 0);
+                return (info[1] & (1 << 5)) != 0;
+#else
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#endif
+            }
+#endif
+
+#if defined(WFC_SIMD_NEON)
+            inline void uniteMasksNeon(uint64_t* out, const uint64_t* domain, const uint64_t* masks, size_t words) {
+                DomainOps<0>::clear(out, words);
+                DomainOps<0>::forEach(domain, words, [&](size_t option) {
+                    const uint64_t* mask = masks + option * words;
+                    size_t w = 0;
+                    for (; w + 2 <= words; w += 2) {
+                        vst1q_u64(out + w, vorrq_u64(vld1q_u64(out + w), vld1q_u64(mask + w)));
+                    }
+                    for (; w < words; ++w) {
+                        out[w] |= mask[w];
+                    }
+                });
+            }
+
+            inline size_t intersectNeon(uint64_t* domain, const uint64_t* mask, uint64_t* removed, size_t words) {
+                size_t count = 0;
+                size_t w = 0;
+                for (; w + 2 <= words; w += 2) {
+                    const uint64x2_t value = vld1q_u64(domain + w);
+                    const uint64x2_t allowed = vld1q_u64(mask + w);
+                    const uint64x2_t kept = vandq_u64(value, allowed);
+                    vst1q_u64(removed + w, vbicq_u64(value, allowed));
+                    vst1q_u64(domain + w, kept);
+                    count += vaddvq_u8(vcntq_u8(vreinterpretq_u8_u64(kept)));
+                }
+                for (; w < words; ++w) {
+                    removed[w] = domain[w] & ~mask[w];
+                    domain[w] &= mask[w];
+                    count += popcount(domain[w]);
+                }
+                return count;
+            }
+#endif
+
+        } // end of namespace kernels
+
+        inline const DomainKernels& scalarDomainKernels() {
+            static const DomainKernels scalar{ "scalar", kernels::uniteMasksScalar, kernels::intersectScalar };
+            return scalar;
+        }
+
+        /**
+         * @brief Gets the AVX2 kernels, or nullptr if they were not compiled in or the CPU lacks AVX2.
+         */
+        inline const DomainKernels* avx2DomainKernels() {
+#if defined(WFC_SIMD_AVX2)
+            static const DomainKernels avx2{ "avx2", kernels::uniteMasksAvx2, kernels::intersectAvx2 };
+            static const bool supported = kernels::cpuHasAvx2();
+            return supported ? &avx2 : nullptr;
+#else
+            return nullptr;
+#endif
+        }
+
+        /**
+         * @brief Gets the NEON kernels, or nullptr off ARM64 where NEON is always present.
+         */
+        inline const DomainKernels* neonDomainKernels() {
+#if defined(WFC_SIMD_NEON)
+            static const DomainKernels neon{ "neon", kernels::uniteMasksNeon, kernels::intersectNeon };
+            return &neon;
+#else
+            return nullptr;
+#endif
+        }
+
+        /**
+         * @brief Gets the fastest kernels the CPU supports, detected on the first call.
+         */
+        inline const DomainKernels& domainKernels() {
+            static const DomainKernels& selected = []() -> const DomainKernels& {
+                if (const DomainKernels* avx2 = avx2DomainKernels()) {
+                    return *avx2;
+                }
+                if (const DomainKernels* neon = neonDomainKernels()) {
+                    return *neon;
+                }
+                return scalarDomainKernels();
+            }();
+            return selected;
+        }
+
+    } // end of namespace internal
+
+} // end of namespace wfc2d
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "span.hpp"
+
+namespace wfc2d {
+
+    namespace internal {
+
+        /**
+         * @brief Indexed binary min-heap of cells keyed on entropy.
+         *
+         * Every cell knows its position in the heap, so its key can be changed in place in O(log n) when
+         * propagation shrinks its domain, and taking the cell with the lowest entropy is O(log n) instead of
+         * a scan over the whole wave. Ties are the caller's business: it is expected to add a small,
+         * deterministic noise term to the keys.
+         */
+        class EntropyHeap {
+        public:
+            static constexpr uint32_t NOT_IN_HEAP = std::numeric_limits<uint32_t>::max();
+
+            /**
+             * @brief Fills the heap with the cells [0, numCells) and heapifies it in O(n).
+             *
+             * @param numCells Number of cells.
+             * @param keyOf Callable returning the key of a cell.
+             */
+            template <typename KeyFn>
+            void build(size_t numCells, KeyFn&& keyOf) {
+                assert(numCells < NOT_IN_HEAP);
+
+                m_heap.resize(numCells);
+                m_position.resize(numCells);
+                m_keys.resize(numCells);
+
+                for (size_t cell = 0; cell < numCells; ++cell) {
+                    m_heap[cell] = static_cast<uint32_t>(cell);
+                    m_position[cell] = static_cast<uint32_t>(cell);
+                    m_keys[cell] = keyOf(cell);
+                }
+
+                for (size_t i = numCells / 2; i-- > 0;) {
+                    siftDown(i);
+                }
+            }
+
+            /**
+             * @brief Replaces the heap with one saved from cells(), positions() and keys().
+             *
+             * The layout is taken over as is rather than rebuilt, so ties come out in the same order as in the
+             * heap it was saved from.
+             *
+             * @return False, leaving the heap unchanged, if the arrays do not describe a heap of positions.size() cells.
+             */
+            bool assign(Span<const uint32_t> heap, Span<const uint32_t> positions, Span<const float> keys) {
+                const size_t numCells = positions.size();
+                if (keys.size() != numCells || heap.size() > numCells) {
+                    return false;
+                }
+
+                size_t inHeap = 0;
+                for (size_t cell = 0; cell < numCells; ++cell) {
+                    const uint32_t position = positions[cell];
+                    if (position == NOT_IN_HEAP) {
+                        continue;
+                    }
+                    if (position >= heap.size() || heap[position] != cell) {
+                        return false;
+                    }
+                    ++inHeap;
+                }
+                if (inHeap != heap.size()) {
+                    return false;
+                }
+
+                for (size_t position = 1; position < heap.size(); ++position) {
+                    if (keys[heap[position]] < keys[heap[(position - 1) / 2]]) {
+                        return false;
+                    }
+                }
+
+                m_heap.assign(heap.begin(), heap.end());
+                m_position.assign(positions.begin(), positions.end());
+                m_keys.assign(keys.begin(), keys.end());
+                return true;
+            }
+
+            /**
+             * @brief Gets the cells in heap order.
+             */
+            const std::vector<uint32_t>& cells() const {
+                return m_heap;
+            }
+
+            /**
+             * @brief Gets the position of every cell in cells(), NOT_IN_HEAP for removed ones.
+             */
+            const std::vector<uint32_t>& positions() const {
+                return m_position;
+            }
+
+            const std::vector<float>& keys() const {
+                return m_keys;
+            }
+
+            bool empty() const {
+                return m_heap.empty();
+            }
+
+            size_t size() const {
+                return m_heap.size();
+            }
+
+            bool contains(size_t cell) const {
+                return m_position[cell] != NOT_IN_HEAP;
+            }
+
+            /**
+             * @brief Gets the cell with the lowest key.
+             * @warning The heap must not be empty.
+             */
+            size_t top() const {
+                return m_heap.front();
+            }
+
+            float key(size_t cell) const {
+                return m_keys[cell];
+            }
+
+            /**
+             * @brief Changes the key of a cell and restores the heap order around it.
+             *
+             * Cells that were removed only get their key stored.
+             */
+            void update(size_t cell, float key) {
+                const float previous = m_keys[cell];
+                m_keys[cell] = key;
+
+                const uint32_t position = m_position[cell];
+                if (position == NOT_IN_HEAP) {
+                    return;
+                }
+
+                if (key < previous) {
+                    siftUp(position);
+                }
+                else {
+                    siftDown(position);
+                }
+            }
+
+            /**
+             * @brief Takes a cell out of the heap.
+             */
+            void remove(size_t cell) {
+                const uint32_t position = m_position[cell];
+                if (position == NOT_IN_HEAP) {
+                    return;
+                }
+
+                const uint32_t last = m_heap.back();
+                m_heap.pop_back();
+                m_position[cell] = NOT_IN_HEAP;
+
+                if (position == m_heap.size()) {
+                    return;
+                }
+
+                m_heap[position] = last;
+                m_position[last] = position;
+                siftUp(position);
+                siftDown(m_position[last]);
+            }
+
+            /**
+             * @brief Puts a removed cell back into the heap with its last key.
+             */
+            void insert(size_t cell) {
+                if (m_position[cell] != NOT_IN_HEAP) {
+                    return;
+                }
+
+                m_position[cell] = static_cast<uint32_t>(m_heap.size());
+                m_heap.push_back(static_cast<uint32_t>(cell));
+                siftUp(m_heap.size() - 1);
+            }
+
+        private:
+            void place(size_t position, uint32_t cell) {
+                m_heap[position] = cell;
+                m_position[cell] = static_cast<uint32_t>(position);
+            }
+
+            void siftUp(size_t position) {
+                const uint32_t cell = m_heap[position];
+                const float key = m_keys[cell];
+
+                while (position > 0) {
+                    const size_t parent = (position - 1) / 2;
+                    if (!(key < m_keys[m_heap[parent]])) {
+                        break;
+                    }
+
+                    place(position, m_heap[parent]);
+                    position = parent;
+                }
+
+                place(position, cell);
+            }
+
+            void siftDown(size_t position) {
+                const uint32_t cell = m_heap[position];
+                const float key = m_keys[cell];
+                const size_t count = m_heap.size();
+
+                while (true) {
+                    size_t child = 2 * position + 1;
+                    if (child >= count) {
+                        break;
+                    }
+
+                    if (child + 1 < count && m_keys[m_heap[child + 1]] < m_keys[m_heap[child]]) {
+                        ++child;
+                    }
+
+                    if (!(m_keys[m_heap[child]] < key)) {
+                        break;
+                    }
+
+                    place(position, m_heap[child]);
+                    position = child;
+                }
+
+                place(position, cell);
+            }
+
+            std::vector<uint32_t> m_heap;     /**< Cells in heap order. */
+            std::vector<uint32_t> m_position; /**< Position of every cell in m_heap, or NOT_IN_HEAP. */
+            std::vector<float> m_keys;        /**< Key of every cell. */
+        };
+
+    } // end of namespace internal
+
+} // end of namespace wfc2d
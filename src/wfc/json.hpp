@@ -0,0 +1,310 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace wfc2d {
+
+    namespace internal {
+
+        /**
+         * @brief Parsed JSON document.
+         *
+         * Only meant for reading small configuration files such as rulesets: values are plain trees, and
+         * object members keep their order and are looked up linearly.
+         */
+        class JsonValue {
+        public:
+            enum class EType { Null, Bool, Number, String, Array, Object };
+
+            EType type() const {
+                return m_type;
+            }
+
+            bool isNumber() const {
+                return m_type == EType::Number;
+            }
+
+            bool isArray() const {
+                return m_type == EType::Array;
+            }
+
+            bool isObject() const {
+                return m_type == EType::Object;
+            }
+
+            double number() const {
+                return m_number;
+            }
+
+            bool boolean() const {
+                return m_boolean;
+            }
+
+            const std::string& string() const {
+                return m_string;
+            }
+
+            const std::vector<JsonValue>& array() const {
+                return m_array;
+            }
+
+            const std::vector<std::pair<std::string, JsonValue>>& object() const {
+                return m_object;
+            }
+
+            /**
+             * @brief Gets the member of an object with the given key.
+             *
+             * @return The member, or nullptr if the value is not an object or has no such member.
+             */
+            const JsonValue* find(const std::string& key) const {
+                for (const auto& member : m_object) {
+                    if (member.first == key) {
+                        return &member.second;
+                    }
+                }
+                return nullptr;
+            }
+
+            /**
+             * @brief Parses a JSON document.
+             *
+             * @param text Text of the document.
+             * @param value Receives the root value.
+             * @param error Receives a description of the first syntax error.
+             * @return True if the whole text is a valid JSON value.
+             */
+            static bool parse(const std::string& text, JsonValue& value, std::string& error) {
+                Parser parser{ text, 0, error };
+                parser.skipWhitespace();
+                if (!parser.parseValue(value, 0)) {
+                    return false;
+                }
+
+                parser.skipWhitespace();
+                if (parser.position != text.size()) {
+                    return parser.fail("Unexpected characters after the document");
+                }
+                return true;
+            }
+
+        private:
+            struct Parser {
+                static constexpr size_t MAX_DEPTH = 256;
+
+                const std::string& text;
+                size_t position;
+                std::string& error;
+
+                bool fail(const char* message) {
+                    error = std::string(message) + " at offset " + std::to_string(position);
+                    return false;
+                }
+
+                void skipWhitespace() {
+                    while (position < text.size() && (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r')) {
+                        ++position;
+                    }
+                }
+
+                bool consume(char c) {
+                    if (position < text.size() && text[position] == c) {
+                        ++position;
+                        return true;
+                    }
+                    return false;
+                }
+
+                bool consumeWord(const char* word) {
+                    const size_t length = std::char_traits<char>::length(word);
+                    if (text.compare(position, length, word) != 0) {
+                        return false;
+                    }
+                    position += length;
+                    return true;
+                }
+
+                bool parseValue(JsonValue& value, size_t depth) {
+                    if (depth > MAX_DEPTH) {
+                        return fail("Nesting too deep");
+                    }
+
+                    if (position >= text.size()) {
+                        return fail("Unexpected end of document");
+                    }
+
+                    switch (text[position]) {
+                        case '{': return parseObject(value, depth);
+                        case '[': return parseArray(value, depth);
+                        case '"':
+                            value.m_type = EType::String;
+                            return parseString(value.m_string);
+                        case 't':
+                        case 'f':
+                            value.m_type = EType::Bool;
+                            value.m_boolean = text[position] == 't';
+                            return consumeWord(value.m_boolean ? "true" : "false") || fail("Invalid literal");
+                        case 'n':
+                            value.m_type = EType::Null;
+                            return consumeWord("null") || fail("Invalid literal");
+                        default:
+                            return parseNumber(value);
+                    }
+                }
+
+                bool parseNumber(JsonValue& value) {
+                    const char* begin = text.c_str() + position;
+                    char* end = nullptr;
+                    value.m_number = std::strtod(begin, &end);
+                    if (end == begin) {
+                        return fail("Invalid value");
+                    }
+
+                    value.m_type = EType::Number;
+                    position += static_cast<size_t>(end - begin);
+                    return true;
+                }
+
+                bool parseString(std::string& result) {
+                    ++position; // Opening quote
+                    result.clear();
+
+                    while (position < text.size()) {
+                        const char c = text[position++];
+                        if (c == '"') {
+                            return true;
+                        }
+
+                        if (c != '\\') {
+                            result.push_back(c);
+                            continue;
+                        }
+
+                        if (position >= text.size()) {
+                            break;
+                        }
+
+                        const char escape = text[position++];
+                        switch (escape) {
+                            case '"':  result.push_back('"'); break;
+                            case '\\': result.push_back('\\'); break;
+                            case '/':  result.push_back('/'); break;
+                            case 'b':  result.push_back('\b'); break;
+                            case 'f':  result.push_back('\f'); break;
+                            case 'n':  result.push_back('\n'); break;
+                            case 'r':  result.push_back('\r'); break;
+                            case 't':  result.push_back('\t'); break;
+                            case 'u': {
+                                if (position + 4 > text.size()) {
+                                    return fail("Truncated escape");
+                                }
+
+                                const uint32_t code = static_cast<uint32_t>(std::strtoul(text.substr(position, 4).c_str(), nullptr, 16));
+                                position += 4;
+
+                                // Basic multilingual plane only, encoded as UTF-8
+                                if (code < 0x80) {
+                                    result.push_back(static_cast<char>(code));
+                                }
+                                else if (code < 0x800) {
+                                    result.push_back(static_cast<char>(0xC0 | (code >> 6)));
+                                    result.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                                }
+                                else {
+                                    result.push_back(static_cast<char>(0xE0 | (code >> 12)));
+                                    result.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                                    result.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                                }
+                                break;
+                            }
+                            default:
+                                return fail("Invalid escape");
+                        }
+                    }
+
+                    return fail("Unterminated string");
+                }
+
+                bool parseArray(JsonValue& value, size_t depth) {
+                    ++position; // [
+                    value.m_type = EType::Array;
+
+                    skipWhitespace();
+                    if (consume(']')) {
+                        return true;
+                    }
+
+                    while (true) {
+                        value.m_array.emplace_back();
+                        skipWhitespace();
+                        if (!parseValue(value.m_array.back(), depth + 1)) {
+                            return false;
+                        }
+
+                        skipWhitespace();
+                        if (consume(']')) {
+                            return true;
+                        }
+                        if (!consume(',')) {
+                            return fail("Expected ',' or ']'");
+                        }
+                    }
+                }
+
+                bool parseObject(JsonValue& value, size_t depth) {
+                    ++position; // {
+                    value.m_type = EType::Object;
+
+                    skipWhitespace();
+                    if (consume('}')) {
+                        return true;
+                    }
+
+                    while (true) {
+                        skipWhitespace();
+                        if (position >= text.size() || text[position] != '"') {
+                            return fail("Expected a key");
+                        }
+
+                        value.m_object.emplace_back();
+                        if (!parseString(value.m_object.back().first)) {
+                            return false;
+                        }
+
+                        skipWhitespace();
+                        if (!consume(':')) {
+                            return fail("Expected ':'");
+                        }
+
+                        skipWhitespace();
+                        if (!parseValue(value.m_object.back().second, depth + 1)) {
+                            return false;
+                        }
+
+                        skipWhitespace();
+                        if (consume('}')) {
+                            return true;
+                        }
+                        if (!consume(',')) {
+                            return fail("Expected ',' or '}'");
+                        }
+                    }
+                }
+            };
+
+            EType m_type{ EType::Null };
+            double m_number{ 0.0 };
+            bool m_boolean{ false };
+            std::string m_string;
+            std::vector<JsonValue> m_array;
+            std::vector<std::pair<std::string, JsonValue>> m_object;
+        };
+
+    } // end of namespace internal
+
+} // end of namespace wfc2d
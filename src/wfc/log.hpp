@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+
+/**
+ * Messages below this level are compiled out: 0 trace, 1 debug, 2 info, 3 warning, 4 error, 5 none.
+ * Release builds keep warnings and errors only.
+ */
+#ifndef WFC_MIN_LOG_LEVEL
+#ifdef NDEBUG
+#define WFC_MIN_LOG_LEVEL 3
+#else
+#define WFC_MIN_LOG_LEVEL 0
+#endif
+#endif
+
+namespace wfc2d {
+
+    enum class ELogLevel { Trace, Debug, Info, Warning, Error, Off };
+
+    /**
+     * @brief Receives the messages of the library that pass the level filter.
+     *
+     * Calls are serialized, so a sink does not have to be thread-safe itself.
+     */
+    using LogSinkFn = std::function<void(ELogLevel level, const std::string& message)>;
+
+    inline const char* toString(ELogLevel level) {
+        switch (level) {
+            case ELogLevel::Trace:   return "trace";
+            case ELogLevel::Debug:   return "debug";
+            case ELogLevel::Info:    return "info";
+            case ELogLevel::Warning: return "warning";
+            case ELogLevel::Error:   return "error";
+            case ELogLevel::Off:     return "off";
+        }
+        return "unknown";
+    }
+
+    namespace internal {
+
+        struct LogState {
+            std::mutex mutex;
+            LogSinkFn sink;
+            std::atomic<int> level{ static_cast<int>(ELogLevel::Off) };
+        };
+
+        inline LogState& logState() {
+            static LogState state;
+            return state;
+        }
+
+        /**
+         * @brief Sends a message made of the given parts to the sink.
+         *
+         * Below WFC_MIN_LOG_LEVEL the call compiles to nothing; otherwise a disabled level costs one relaxed
+         * load, and the message is only formatted once it is known to be wanted.
+         */
+        template <ELogLevel Level, typename... Parts>
+        void log(const Parts&... parts) {
+            if constexpr (static_cast<int>(Level) >= WFC_MIN_LOG_LEVEL) {
+                LogState& state = logState();
+                if (static_cast<int>(Level) < state.level.load(std::memory_order_relaxed)) {
+                    return;
+                }
+
+                std::ostringstream message;
+                (message << ... << parts);
+
+                std::lock_guard<std::mutex> lock(state.mutex);
+                if (state.sink) {
+                    state.sink(Level, message.str());
+                }
+            }
+            else {
+                ((void)parts, ...);
+            }
+        }
+
+    } // end of namespace internal
+
+    /**
+     * @brief Installs the sink that receives the messages of the library, process-wide.
+     *
+     * Logging is off until a sink is installed. Messages below WFC_MIN_LOG_LEVEL never reach the sink,
+     * whatever the level given here.
+     *
+     * @param sink Function receiving the messages; an empty function turns logging off.
+     * @param level Lowest level passed to the sink.
+     */
+    inline void setLogSink(LogSinkFn sink, ELogLevel level = ELogLevel::Warning) {
+        internal::LogState& state = internal::logState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.level.store(static_cast<int>(sink ? level : ELogLevel::Off), std::memory_order_relaxed);
+        state.sink = std::move(sink);
+    }
+
+    /**
+     * @brief Gets a sink writing every message as one line to std::cerr.
+     */
+    inline LogSinkFn stderrLogSink() {
+        return [](ELogLevel level, const std::string& message) {
+            std::cerr << "[wfc2d " << toString(level) << "] " << message << '\n';
+        };
+    }
+
+} // end of namespace wfc2d
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace wfc2d {
+
+    namespace internal {
+
+        /**
+         * @brief Natural logarithm of positive floats from a lookup table.
+         *
+         * A float is 2^e * (1 + m); log(x) = e * ln(2) + log(1 + m), where log(1 + m) is interpolated from a
+         * table indexed by the top mantissa bits. This keeps transcendental calls out of the entropy updates
+         * in the hot path; the absolute error is below 1e-6.
+         */
+        class LogTable {
+        public:
+            static constexpr int INDEX_BITS = 12;
+            static constexpr size_t SIZE = (size_t{ 1 } << INDEX_BITS) + 1; /**< Entries of the table, one past the last index. */
+
+            /**
+             * @brief Uses the table shared by the whole process, built on first use.
+             */
+            LogTable()
+                : m_table(defaultTable().data()) {}
+
+            /**
+             * @brief Uses a table of SIZE entries owned by somebody else, e.g. a mapped compiled ruleset.
+             */
+            explicit LogTable(const float* table)
+                : m_table(table) {}
+
+            /**
+             * @brief Gets log(x).
+             * @warning x must be a positive, normal float.
+             */
+            float log(float x) const {
+                constexpr int fractionBits = 23 - INDEX_BITS;
+                constexpr float ln2 = 0.693147180559945309f;
+
+                uint32_t bits;
+                std::memcpy(&bits, &x, sizeof(bits));
+
+                const int exponent = static_cast<int>((bits >> 23) & 0xFF) - 127;
+                const uint32_t mantissa = bits & 0x7FFFFF;
+                const uint32_t index = mantissa >> fractionBits;
+                const float fraction = static_cast<float>(mantissa & ((1u << fractionBits) - 1)) * (1.0f / static_cast<float>(1u << fractionBits));
+
+                const float low = m_table[index];
+                return static_cast<float>(exponent) * ln2 + low + fraction * (m_table[index + 1] - low);
+            }
+
+            const float* data() const {
+                return m_table;
+            }
+
+            /**
+             * @brief Gets the entries log(1 + i / 2^INDEX_BITS), computed once per process.
+             */
+            static const std::vector<float>& defaultTable() {
+                static const std::vector<float> table = []() {
+                    constexpr size_t steps = size_t{ 1 } << INDEX_BITS;
+                    std::vector<float> entries(SIZE);
+                    for (size_t i = 0; i < SIZE; ++i) {
+                        entries[i] = static_cast<float>(std::log1p(static_cast<double>(i) / static_cast<double>(steps)));
+                    }
+                    return entries;
+                }();
+                return table;
+            }
+
+        private:
+            const float* m_table;
+        };
+
+    } // end of namespace internal
+
+} // end of namespace wfc2d
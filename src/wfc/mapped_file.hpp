@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define WFC_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace wfc2d {
+
+    namespace internal {
+
+        /**
+         * @brief Read-only view of a whole file.
+         *
+         * The file is memory-mapped where the platform supports it, so opening a large file costs no more
+         * than the pages that are actually touched; elsewhere it is read into memory in one go. The data is at
+         * least 8-byte aligned either way.
+         */
+        class MappedFile {
+        public:
+            /**
+             * @brief Opens a file.
+             *
+             * @return The mapped file, or nullptr if it could not be opened.
+             */
+            static std::shared_ptr<const MappedFile> open(const std::string& filepath) {
+                std::shared_ptr<MappedFile> file(new MappedFile());
+
+#if defined(WFC_HAS_MMAP)
+                const int descriptor = ::open(filepath.c_str(), O_RDONLY);
+                if (descriptor < 0) {
+                    return nullptr;
+                }
+
+                struct stat status;
+                if (::fstat(descriptor, &status) != 0) {
+                    ::close(descriptor);
+                    return nullptr;
+                }
+
+                file->m_size = static_cast<size_t>(status.st_size);
+                if (file->m_size > 0) {
+                    void* mapping = ::mmap(nullptr, file->m_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+                    if (mapping == MAP_FAILED) {
+                        ::close(descriptor);
+                        return nullptr;
+                    }
+                    file->m_mapping = mapping;
+                    file->m_data = static_cast<const unsigned char*>(mapping);
+                }
+
+                // The mapping stays valid after the descriptor is closed
+                ::close(descriptor);
+#else
+                std::ifstream input(filepath, std::ios::binary | std::ios::ate);
+                if (!input.is_open()) {
+                    return nullptr;
+                }
+
+                file->m_size = static_cast<size_t>(input.tellg());
+                file->m_buffer.resize((file->m_size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+                input.seekg(0);
+                if (!input.read(reinterpret_cast<char*>(file->m_buffer.data()), static_cast<std::streamsize>(file->m_size))) {
+                    return nullptr;
+                }
+                file->m_data = reinterpret_cast<const unsigned char*>(file->m_buffer.data());
+#endif
+
+                return file;
+            }
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            ~MappedFile() {
+#if defined(WFC_HAS_MMAP)
+                if (m_mapping) {
+                    ::munmap(m_mapping, m_size);
+                }
+#endif
+            }
+
+            const unsigned char* data() const {
+                return m_data;
+            }
+
+            size_t size() const {
+                return m_size;
+            }
+
+        private:
+            MappedFile() = default;
+
+            const unsigned char* m_data{ nullptr };
+            size_t m_size{ 0 };
+#if defined(WFC_HAS_MMAP)
+            void* m_mapping{ nullptr };
+#else
+            std::vector<uint64_t> m_buffer;
+#endif
+        };
+
+    } // end of namespace internal
+
+} // end of namespace wfc2d
@@ -0,0 +1,328 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "log.hpp"
+#include "span.hpp"
+#include "status.hpp"
+
+/**
+ * Width of the tile indices of the output grid, 8 or 16 bits. 8 bits halves the output of tilesets of at
+ * most 255 tiles; larger ones need 16.
+ */
+#ifndef WFC_TILE_INDEX_BITS
+#define WFC_TILE_INDEX_BITS 16
+#endif
+
+static_assert(WFC_TILE_INDEX_BITS == 8 || WFC_TILE_INDEX_BITS == 16, "WFC_TILE_INDEX_BITS must be 8 or 16");
+
+namespace wfc2d {
+
+    /**
+     * @brief Tile of an output cell.
+     */
+    using TileIndex = std::conditional_t<WFC_TILE_INDEX_BITS == 8, uint8_t, uint16_t>;
+
+    /**
+     * @brief Value of the output cells that are not collapsed yet.
+     */
+    static constexpr TileIndex NO_TILE = std::numeric_limits<TileIndex>::max();
+
+    /**
+     * @brief Largest number of tiles an output grid can hold, NO_TILE excluded.
+     */
+    static constexpr size_t MAX_OUTPUT_TILES = NO_TILE;
+
+    /**
+     * @brief Image holding one picture per tile, for writePng().
+     *
+     * Pictures are tileWidth x tileHeight pixels, laid out left to right and top to bottom in tile order.
+     * An atlas of 1x1 pictures is a palette that draws one pixel per cell.
+     */
+    struct TileAtlas {
+        Span<const uint8_t> pixels; /**< RGBA, 8 bits per channel, rows top to bottom. */
+        size_t width{ 0 };          /**< Width of the atlas in pixels. */
+        size_t height{ 0 };         /**< Height of the atlas in pixels. */
+        size_t tileWidth{ 1 };
+        size_t tileHeight{ 1 };
+
+        size_t tilesPerRow() const {
+            return tileWidth > 0 ? width / tileWidth : 0;
+        }
+
+        size_t numTiles() const {
+            return tileHeight > 0 ? tilesPerRow() * (height / tileHeight) : 0;
+        }
+    };
+
+    /**
+     * @brief Writes an output grid as raw tile indices.
+     *
+     * The cells are written row-major as TileIndex values in the byte order of the machine, in a single
+     * write straight from the grid; cells that are not collapsed hold NO_TILE.
+     *
+     * @param filepath Path of the file to write.
+     * @param tiles Cells of the grid, e.g. WaveFunctionCollapse2D::getOutput().
+     * @param status Receives the outcome, if not null.
+     * @return True if the file was written.
+     */
+    inline bool writeRaw(const std::string& filepath, Span<const TileIndex> tiles, EStatus* status = nullptr) {
+        std::ofstream outputFile(filepath, std::ios::binary | std::ios::trunc);
+        if (!outputFile.is_open()) {
+            internal::log<ELogLevel::Error>("Unable to open file: ", filepath);
+            internal::setStatus(status, EStatus::FileNotFound);
+            return false;
+        }
+
+        outputFile.write(reinterpret_cast<const char*>(tiles.data()), static_cast<std::streamsize>(tiles.size() * sizeof(TileIndex)));
+        if (!outputFile) {
+            internal::log<ELogLevel::Error>("Failed to write file: ", filepath);
+            internal::setStatus(status, EStatus::WriteFailed);
+            return false;
+        }
+
+        internal::setStatus(status, EStatus::Ok);
+        return true;
+    }
+
+    namespace internal {
+
+        /**
+         * @brief Writes a PNG file one scanline at a time.
+         *
+         * The image data is stored uncompressed (deflate stored blocks), so no compression library is
+         * needed and memory stays at one block whatever the size of the image. Every block goes out as its
+         * own IDAT chunk.
+         */
+        class PngWriter {
+        public:
+            PngWriter(std::ofstream& output, size_t width, size_t height)
+                : m_output(output), m_remaining(static_cast<uint64_t>(height) * (1 + 4 * static_cast<uint64_t>(width))) {
+                static const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+                m_output.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+                unsigned char header[13] = {};
+                storeBigEndian(header, static_cast<uint32_t>(width));
+                storeBigEndian(header + 4, static_cast<uint32_t>(height));
+                header[8] = 8;  // Bits per channel
+                header[9] = 6;  // RGBA
+                writeChunk("IHDR", header, sizeof(header));
+
+                // zlib header: deflate with a 32K window, no dictionary, fastest level
+                m_block.push_back(0x78);
+                m_block.push_back(0x01);
+                m_block.reserve(2 + BLOCK_HEADER + MAX_BLOCK + 4);
+            }
+
+            /**
+             * @brief Appends one scanline of width RGBA pixels.
+             */
+            void writeRow(const uint8_t* pixels, size_t bytes) {
+                const uint8_t filter = 0; // None
+                append(&filter, 1);
+                append(pixels, bytes);
+            }
+
+            /**
+             * @brief Writes the checksum and the end of the file once every scanline was written.
+             */
+            bool finish() {
+                flushBlock();
+
+                unsigned char adler[4];
+                storeBigEndian(adler, (m_adlerHigh << 16) | m_adlerLow);
+                writeChunk("IDAT", adler, sizeof(adler));
+                writeChunk("IEND", nullptr, 0);
+                return static_cast<bool>(m_output);
+            }
+
+        private:
+            static constexpr size_t MAX_BLOCK = 65535;
+            static constexpr size_t BLOCK_HEADER = 5;
+
+            void append(const uint8_t* data, size_t bytes) {
+                while (bytes > 0) {
+                    if (m_blockBytes == 0) {
+                        // Room for the header of a stored block, filled in by flushBlock()
+                        m_block.resize(m_block.size() + BLOCK_HEADER);
+                    }
+
+                    const size_t take = std::min(bytes, MAX_BLOCK - m_blockBytes);
+                    m_block.insert(m_block.end(), data, data + take);
+                    updateAdler(data, take);
+                    m_blockBytes += take;
+                    m_remaining -= take;
+                    data += take;
+                    bytes -= take;
+
+                    if (m_blockBytes == MAX_BLOCK) {
+                        flushBlock();
+                    }
+                }
+            }
+
+            void flushBlock() {
+                // A full last block was already written as the final one
+                if (m_wroteFinal) {
+                    return;
+                }
+
+                unsigned char* header = m_block.data() + m_block.size() - m_blockBytes - BLOCK_HEADER;
+                const uint16_t length = static_cast<uint16_t>(m_blockBytes);
+                m_wroteFinal = m_remaining == 0;
+                header[0] = m_wroteFinal ? 1 : 0;
+                header[1] = static_cast<unsigned char>(length);
+                header[2] = static_cast<unsigned char>(length >> 8);
+                header[3] = static_cast<unsigned char>(~length);
+                header[4] = static_cast<unsigned char>(~length >> 8);
+
+                writeChunk("IDAT", m_block.data(), m_block.size());
+                m_block.clear();
+                m_blockBytes = 0;
+            }
+
+            void updateAdler(const uint8_t* data, size_t bytes) {
+                // 5552 bytes is the longest run whose sums cannot overflow 32 bits before the reduction
+                while (bytes > 0) {
+                    const size_t run = std::min<size_t>(bytes, 5552);
+                    for (size_t i = 0; i < run; ++i) {
+                        m_adlerLow += data[i];
+                        m_adlerHigh += m_adlerLow;
+                    }
+                    m_adlerLow %= 65521;
+                    m_adlerHigh %= 65521;
+                    data += run;
+                    bytes -= run;
+                }
+            }
+
+            void writeChunk(const char* type, const unsigned char* data, size_t bytes) {
+                unsigned char length[4];
+                storeBigEndian(length, static_cast<uint32_t>(bytes));
+                m_output.write(reinterpret_cast<const char*>(length), sizeof(length));
+                m_output.write(type, 4);
+                if (bytes > 0) {
+                    m_output.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+                }
+
+                uint32_t crc = updateCrc(0xFFFFFFFFu, reinterpret_cast<const unsigned char*>(type), 4);
+                crc = updateCrc(crc, data, bytes) ^ 0xFFFFFFFFu;
+                unsigned char checksum[4];
+                storeBigEndian(checksum, crc);
+                m_output.write(reinterpret_cast<const char*>(checksum), sizeof(checksum));
+            }
+
+            static uint32_t updateCrc(uint32_t crc, const unsigned char* data, size_t bytes) {
+                static const std::array<uint32_t, 256> table = [] {
+                    std::array<uint32_t, 256> entries{};
+                    for (uint32_t n = 0; n < 256; ++n) {
+                        uint32_t c = n;
+                        for (int k = 0; k < 8; ++k) {
+                            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                        }
+                        entries[n] = c;
+                    }
+                    return entries;
+                }();
+
+                for (size_t i = 0; i < bytes; ++i) {
+                    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+                }
+                return crc;
+            }
+
+            static void storeBigEndian(unsigned char* destination, uint32_t value) {
+                destination[0] = static_cast<unsigned char>(value >> 24);
+                destination[1] = static_cast<unsigned char>(value >> 16);
+                destination[2] = static_cast<unsigned char>(value >> 8);
+                destination[3] = static_cast<unsigned char>(value);
+            }
+
+            std::ofstream& m_output;
+            std::vector<unsigned char> m_block; /**< zlib bytes of the IDAT chunk being filled. */
+            size_t m_blockBytes{ 0 };           /**< Image bytes in the current stored block. */
+            uint64_t m_remaining;               /**< Image bytes still to come. */
+            bool m_wroteFinal{ false };
+            uint32_t m_adlerLow{ 1 };
+            uint32_t m_adlerHigh{ 0 };
+        };
+
+    } // end of namespace internal
+
+    /**
+     * @brief Renders an output grid as a PNG image, blitting the atlas picture of every cell.
+     *
+     * The image is cols * atlas.tileWidth pixels wide and is built and written one scanline at a time, by
+     * copying whole picture rows out of the atlas. Cells that are not collapsed, or whose tile has no
+     * picture in the atlas, are left transparent.
+     *
+     * @param filepath Path of the file to write.
+     * @param tiles Cells of the grid, row-major, e.g. WaveFunctionCollapse2D::getOutput().
+     * @param cols Number of columns of the grid.
+     * @param atlas Pictures of the tiles.
+     * @param status Receives the outcome, if not null.
+     * @return True if the file was written.
+     */
+    inline bool writePng(const std::string& filepath, Span<const TileIndex> tiles, size_t cols, const TileAtlas& atlas, EStatus* status = nullptr) {
+        const size_t rows = cols > 0 ? tiles.size() / cols : 0;
+        const size_t width = cols * atlas.tileWidth;
+        const size_t height = rows * atlas.tileHeight;
+        if (width == 0 || height == 0 || width > std::numeric_limits<int32_t>::max() || height > std::numeric_limits<int32_t>::max()
+            || atlas.pixels.size() < atlas.width * atlas.height * 4) {
+            internal::log<ELogLevel::Error>("Invalid image or atlas size for ", filepath);
+            internal::setStatus(status, EStatus::InvalidFormat);
+            return false;
+        }
+
+        std::ofstream outputFile(filepath, std::ios::binary | std::ios::trunc);
+        if (!outputFile.is_open()) {
+            internal::log<ELogLevel::Error>("Unable to open file: ", filepath);
+            internal::setStatus(status, EStatus::FileNotFound);
+            return false;
+        }
+
+        const size_t atlasTiles = atlas.numTiles();
+        const size_t tilesPerRow = atlas.tilesPerRow();
+        const size_t stripBytes = atlas.tileWidth * 4;
+
+        internal::PngWriter png(outputFile, width, height);
+        std::vector<uint8_t> scanline(width * 4);
+        for (size_t row = 0; row < rows; ++row) {
+            const TileIndex* cells = tiles.data() + row * cols;
+            for (size_t y = 0; y < atlas.tileHeight; ++y) {
+                for (size_t col = 0; col < cols; ++col) {
+                    uint8_t* destination = scanline.data() + col * stripBytes;
+                    const size_t tile = cells[col];
+                    if (tile >= atlasTiles) {
+                        std::fill(destination, destination + stripBytes, uint8_t{ 0 });
+                        continue;
+                    }
+
+                    const size_t pixelRow = (tile / tilesPerRow) * atlas.tileHeight + y;
+                    const size_t pixelCol = (tile % tilesPerRow) * atlas.tileWidth;
+                    const uint8_t* source = atlas.pixels.data() + (pixelRow * atlas.width + pixelCol) * 4;
+                    std::copy(source, source + stripBytes, destination);
+                }
+                png.writeRow(scanline.data(), scanline.size());
+            }
+        }
+
+        if (!png.finish()) {
+            internal::log<ELogLevel::Error>("Failed to write file: ", filepath);
+            internal::setStatus(status, EStatus::WriteFailed);
+            return false;
+        }
+
+        internal::setStatus(status, EStatus::Ok);
+        return true;
+    }
+
+} // end of namespace wfc2d
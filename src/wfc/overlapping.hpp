@@ -0,0 +1,394 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "log.hpp"
+#include "output.hpp"
+#include "span.hpp"
+#include "status.hpp"
+#include "thread_pool.hpp"
+#include "wfc2d.hpp"
+
+namespace wfc2d {
+
+    /**
+     * @brief Settings of OverlappingModel::extract().
+     */
+    struct OverlappingOptions {
+        size_t patternSize{ 3 };   /**< Side N of the NxN patterns. */
+        size_t symmetry{ 1 };      /**< Variants of every window, 1 to 8: 2 adds its mirror image, 4 and 8 the quarter and all turns of both. */
+        bool periodicInput{ true };/**< Patterns wrap around the edges of the sample. */
+        size_t numThreads{ 0 };    /**< Threads extracting the patterns, including the calling one; 0 uses every hardware thread. */
+    };
+
+    /**
+     * @brief Ruleset of the overlapping model, learned from a sample image.
+     *
+     * Every NxN window of the sample, in each of the requested rotations and reflections, is a pattern.
+     * Identical patterns are merged, and the number of windows showing a pattern becomes its weight. Two
+     * patterns may be neighbours in a direction if they agree on the N x (N-1) pixels where they overlap
+     * once shifted by one cell. The result is a regular Ruleset, so solving it runs on the same compiled
+     * masks and propagators as a hand-written tileset; every output cell then stands for the top-left pixel
+     * of its pattern.
+     *
+     * Extraction is hash-based and runs on a thread pool: windows are hashed in parallel, merged in shards
+     * owned by one thread each, and the overlaps are matched through hashed strips instead of comparing
+     * every pair of patterns. Patterns are numbered in the order of their first window, so the ruleset does
+     * not depend on the number of threads.
+     */
+    class OverlappingModel {
+    public:
+        using Solver = WaveFunctionCollapse2D;
+        using Ruleset = Solver::Ruleset;
+        using CompiledRuleset = Solver::CompiledRuleset;
+        using Tile = Solver::Tile;
+
+        static constexpr size_t MAX_SYMMETRY = 8;
+
+        /**
+         * @brief Extracts the patterns of a sample and builds their ruleset.
+         *
+         * @param sample Pixels of the sample, row-major. Any 32-bit value works as a colour; atlas() reads
+         * each one as RGBA bytes in memory order.
+         * @param width Width of the sample in pixels.
+         * @param height Height of the sample in pixels.
+         * @param options Pattern size, symmetry, wrapping and threads.
+         * @param status Receives the outcome, if not null.
+         * @return The model, or nullptr if the settings don't fit the sample or there are more distinct
+         * patterns than an output grid can hold.
+         */
+        static std::shared_ptr<const OverlappingModel> extract(Span<const uint32_t> sample, size_t width, size_t height,
+            const OverlappingOptions& options, EStatus* status = nullptr) {
+            const size_t n = options.patternSize;
+            if (n == 0 || n > width || n > height || sample.size() != width * height || options.symmetry == 0 || options.symmetry > MAX_SYMMETRY) {
+                internal::log<ELogLevel::Error>("Invalid pattern size, symmetry or sample size.");
+                internal::setStatus(status, EStatus::InvalidFormat);
+                return nullptr;
+            }
+
+            std::shared_ptr<OverlappingModel> model(new OverlappingModel());
+            model->m_patternSize = n;
+
+            const Windows windows(sample.data(), width, height, n, options.symmetry, options.periodicInput);
+
+            internal::ThreadPool pool(options.numThreads);
+            const std::vector<Unique> patterns = findPatterns(windows, pool);
+
+            const size_t maxPatterns = std::min<size_t>(std::numeric_limits<uint16_t>::max(), MAX_OUTPUT_TILES);
+            if (patterns.size() > maxPatterns) {
+                internal::log<ELogLevel::Error>("The sample has ", patterns.size(), " distinct patterns, at most ", maxPatterns, " are supported.");
+                internal::setStatus(status, EStatus::TooManyTiles);
+                return nullptr;
+            }
+
+            const size_t cells = n * n;
+            std::vector<Tile> tiles(patterns.size());
+            model->m_patterns.resize(patterns.size() * cells);
+            model->m_colors.resize(patterns.size());
+            for (size_t pattern = 0; pattern < patterns.size(); ++pattern) {
+                windows.read(patterns[pattern].window, &model->m_patterns[pattern * cells]);
+                model->m_colors[pattern] = model->m_patterns[pattern * cells];
+                tiles[pattern].weight = static_cast<double>(patterns[pattern].count);
+            }
+
+            model->matchOverlaps(tiles, pool);
+            model->m_ruleset = Ruleset::create(std::move(tiles));
+
+            internal::setStatus(status, EStatus::Ok);
+            return model;
+        }
+
+        /**
+         * @brief Gets the number of distinct patterns.
+         */
+        size_t size() const {
+            return this->m_colors.size();
+        }
+
+        size_t getPatternSize() const {
+            return this->m_patternSize;
+        }
+
+        /**
+         * @brief Gets the pixels of a pattern, row-major.
+         */
+        Span<const uint32_t> getPattern(size_t pattern) const {
+            const size_t cells = this->m_patternSize * this->m_patternSize;
+            return Span<const uint32_t>(this->m_patterns).subspan(pattern * cells, cells);
+        }
+
+        /**
+         * @brief Gets the colour an output cell holding a pattern stands for: its top-left pixel.
+         */
+        uint32_t getColor(size_t pattern) const {
+            return this->m_colors[pattern];
+        }
+
+        /**
+         * @brief Gets the ruleset of the patterns, to attach to a solver with setRuleset().
+         *
+         * Tile i is pattern i, weighted by the number of windows of the sample that show it.
+         */
+        const std::shared_ptr<const Ruleset>& ruleset() const {
+            return this->m_ruleset;
+        }
+
+        const std::shared_ptr<const CompiledRuleset>& compiled() const {
+            return this->m_ruleset->compiled();
+        }
+
+        /**
+         * @brief Gets a palette of one pixel per pattern, to render an output with writePng().
+         */
+        TileAtlas atlas() const {
+            TileAtlas atlas;
+            atlas.pixels = Span<const uint8_t>(reinterpret_cast<const uint8_t*>(this->m_colors.data()), this->m_colors.size() * sizeof(uint32_t));
+            atlas.width = this->m_colors.size();
+            atlas.height = 1;
+            return atlas;
+        }
+
+        /**
+         * @brief Turns an output grid into pixels, 0 for the cells that are not collapsed.
+         */
+        std::vector<uint32_t> render(Span<const TileIndex> output) const {
+            std::vector<uint32_t> pixels(output.size());
+            for (size_t index = 0; index < output.size(); ++index) {
+                pixels[index] = output[index] < this->m_colors.size() ? this->m_colors[output[index]] : 0;
+            }
+            return pixels;
+        }
+
+    private:
+        static constexpr size_t PATTERNS_PER_TASK = 64;
+
+        OverlappingModel() = default;
+
+        /**
+         * @brief The NxN windows of a sample, every origin in every variant.
+         *
+         * Window k has origin k / symmetry, in row-major order, and variant k % symmetry. Variant v is the
+         * window mirrored if v is odd, then turned a quarter clockwise v / 2 times.
+         */
+        struct Windows {
+            Windows(const uint32_t* sample, size_t width, size_t height, size_t n, size_t symmetry, bool periodic)
+                : sample(sample), width(width), height(height), n(n), symmetry(symmetry),
+                originsX(periodic ? width : width - n + 1), originsY(periodic ? height : height - n + 1) {
+                // Where every cell of every variant is read from, relative to the origin of the window
+                offsets.resize(symmetry * n * n);
+                for (size_t variant = 0; variant < symmetry; ++variant) {
+                    for (size_t y = 0; y < n; ++y) {
+                        for (size_t x = 0; x < n; ++x) {
+                            size_t sx = (variant & 1) ? n - 1 - x : x;
+                            size_t sy = y;
+                            for (size_t turn = 0; turn < variant / 2; ++turn) {
+                                const size_t previous = sx;
+                                sx = sy;
+                                sy = n - 1 - previous;
+                            }
+                            offsets[(variant * n + y) * n + x] = { sx, sy };
+                        }
+                    }
+                }
+            }
+
+            size_t count() const {
+                return originsX * originsY * symmetry;
+            }
+
+            /**
+             * @brief Copies the pixels of window k into destination, row-major.
+             */
+            void read(size_t k, uint32_t* destination) const {
+                const size_t origin = k / symmetry;
+                const size_t left = origin % originsX;
+                const size_t top = origin / originsX;
+                const Offset* offset = &offsets[(k % symmetry) * n * n];
+
+                for (size_t cell = 0; cell < n * n; ++cell) {
+                    // Origins stay inside the sample, so wrapping is a single subtraction
+                    size_t px = left + offset[cell].x;
+                    size_t py = top + offset[cell].y;
+                    px -= px >= width ? width : 0;
+                    py -= py >= height ? height : 0;
+                    destination[cell] = sample[py * width + px];
+                }
+            }
+
+            struct Offset {
+                size_t x;
+                size_t y;
+            };
+
+            const uint32_t* sample;
+            size_t width;
+            size_t height;
+            size_t n;
+            size_t symmetry;
+            size_t originsX;
+            size_t originsY;
+            std::vector<Offset> offsets; /**< offsets[(variant * n + y) * n + x] */
+        };
+
+        /**
+         * @brief A distinct pattern: its first window and the number of windows showing it.
+         */
+        struct Unique {
+            size_t window;
+            size_t count;
+        };
+
+        static uint64_t hashPixels(const uint32_t* pixels, size_t count) {
+            uint64_t hash = 0xCBF29CE484222325ull;
+            for (size_t i = 0; i < count; ++i) {
+                hash = (hash ^ pixels[i]) * 0x100000001B3ull;
+            }
+
+            // Final avalanche, so the shard bits are well mixed too
+            hash ^= hash >> 33;
+            hash *= 0xFF51AFD7ED558CCDull;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        /**
+         * @brief Finds the distinct patterns among the windows, ordered by first window.
+         */
+        static std::vector<Unique> findPatterns(const Windows& windows, internal::ThreadPool& pool) {
+            const size_t cells = windows.n * windows.n;
+            const size_t rowWindows = windows.originsX * windows.symmetry;
+
+            // Hash every window, one row of origins per task
+            std::vector<uint64_t> hashes(windows.count());
+            pool.parallelFor(windows.originsY, [&](size_t row, size_t) {
+                std::vector<uint32_t> pixels(cells);
+                for (size_t k = row * rowWindows; k < (row + 1) * rowWindows; ++k) {
+                    windows.read(k, pixels.data());
+                    hashes[k] = hashPixels(pixels.data(), cells);
+                }
+            });
+
+            // Merge identical windows; every shard of hash values is owned by one task, which scans the
+            // windows in order so that first occurrences come out right
+            const size_t shards = pool.size();
+            std::vector<std::vector<Unique>> found(shards);
+            pool.parallelFor(shards, [&](size_t shard, size_t) {
+                static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+                std::unordered_map<uint64_t, uint32_t> heads; // First pattern of the shard with a hash
+                std::vector<uint32_t> next;                   // Next pattern with the same hash
+                std::vector<uint32_t> pixels;                 // Pixels of the patterns of the shard
+                std::vector<uint32_t> window(cells);
+                std::vector<Unique>& unique = found[shard];
+
+                for (size_t k = 0; k < hashes.size(); ++k) {
+                    if ((hashes[k] >> 32) % shards != shard) {
+                        continue;
+                    }
+
+                    windows.read(k, window.data());
+                    const auto head = heads.emplace(hashes[k], NONE).first;
+
+                    uint32_t pattern = head->second;
+                    while (pattern != NONE && std::memcmp(window.data(), &pixels[pattern * cells], cells * sizeof(uint32_t)) != 0) {
+                        pattern = next[pattern];
+                    }
+
+                    if (pattern != NONE) {
+                        ++unique[pattern].count;
+                        continue;
+                    }
+
+                    next.push_back(head->second);
+                    head->second = static_cast<uint32_t>(unique.size());
+                    pixels.insert(pixels.end(), window.begin(), window.end());
+                    unique.push_back({ k, 1 });
+                }
+            });
+
+            std::vector<Unique> patterns;
+            for (const auto& shard : found) {
+                patterns.insert(patterns.end(), shard.begin(), shard.end());
+            }
+            std::sort(patterns.begin(), patterns.end(), [](const Unique& a, const Unique& b) { return a.window < b.window; });
+            return patterns;
+        }
+
+        /**
+         * @brief Copies the pixels of a pattern that overlap its neighbour in a direction.
+         */
+        void readStrip(size_t pattern, size_t direction, std::vector<uint32_t>& strip) const {
+            // Offsets of the neighbour in the order UP, DOWN, LEFT, RIGHT
+            static constexpr int DX[Solver::NUM_OPTION_DIRECTIONS] = { 0, 0, -1, 1 };
+            static constexpr int DY[Solver::NUM_OPTION_DIRECTIONS] = { -1, 1, 0, 0 };
+
+            const size_t n = this->m_patternSize;
+            const size_t left = DX[direction] > 0 ? 1 : 0;
+            const size_t right = DX[direction] < 0 ? n - 1 : n;
+            const size_t top = DY[direction] > 0 ? 1 : 0;
+            const size_t bottom = DY[direction] < 0 ? n - 1 : n;
+
+            const uint32_t* pixels = &this->m_patterns[pattern * n * n];
+            strip.clear();
+            for (size_t y = top; y < bottom; ++y) {
+                strip.insert(strip.end(), pixels + y * n + left, pixels + y * n + right);
+            }
+        }
+
+        /**
+         * @brief Allows b in direction d of a whenever the pixels of a facing d equal those of b facing back.
+         */
+        void matchOverlaps(std::vector<Tile>& tiles, internal::ThreadPool& pool) const {
+            const size_t numPatterns = tiles.size();
+            for (Tile& tile : tiles) {
+                for (auto& options : tile.options) {
+                    options = Bitset(numPatterns);
+                }
+            }
+
+            // Patterns by the hash of the strip they show towards every direction
+            std::vector<std::unordered_multimap<uint64_t, size_t>> facing(Solver::NUM_OPTION_DIRECTIONS);
+            std::vector<uint32_t> strip;
+            for (size_t direction = 0; direction < Solver::NUM_OPTION_DIRECTIONS; ++direction) {
+                facing[direction].reserve(numPatterns);
+                for (size_t pattern = 0; pattern < numPatterns; ++pattern) {
+                    readStrip(pattern, direction, strip);
+                    facing[direction].emplace(hashPixels(strip.data(), strip.size()), pattern);
+                }
+            }
+
+            // Every task only writes the options of its own block of patterns
+            const size_t blocks = (numPatterns + PATTERNS_PER_TASK - 1) / PATTERNS_PER_TASK;
+            pool.parallelFor(blocks, [&](size_t block, size_t) {
+                std::vector<uint32_t> stripA;
+                std::vector<uint32_t> stripB;
+                for (size_t a = block * PATTERNS_PER_TASK; a < std::min(numPatterns, (block + 1) * PATTERNS_PER_TASK); ++a) {
+                    for (size_t direction = 0; direction < Solver::NUM_OPTION_DIRECTIONS; ++direction) {
+                        const size_t back = direction ^ 1;
+                        readStrip(a, direction, stripA);
+                        const auto range = facing[back].equal_range(hashPixels(stripA.data(), stripA.size()));
+                        for (auto it = range.first; it != range.second; ++it) {
+                            readStrip(it->second, back, stripB);
+                            if (stripA == stripB) {
+                                tiles[a].options[direction].set(it->second);
+                            }
+                        }
+                    }
+                }
+            });
+        }
+
+        size_t m_patternSize{ 0 };
+        std::vector<uint32_t> m_patterns; /**< Pixels of every pattern, pattern after pattern. */
+        std::vector<uint32_t> m_colors;   /**< Top-left pixel of every pattern. */
+        std::shared_ptr<const Ruleset> m_ruleset;
+    };
+
+} // end of namespace wfc2d
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace wfc2d {
+
+    /**
+     * @brief Small, fast and seedable pseudo random number generator (xoshiro256**).
+     *
+     * Every solver owns one, so draws cost a few instructions instead of a syscall and a run can be
+     * reproduced from its seed. Generators for parallel workers should come from forStream(), which jumps
+     * 2^128 draws ahead per stream so the sequences never overlap.
+     */
+    class Random {
+    public:
+        explicit Random(uint64_t seed = 0) {
+            this->seed(seed);
+        }
+
+        /**
+         * @brief Gets a generator for one of several independent streams sharing the same seed.
+         *
+         * @param seed Seed shared by all streams.
+         * @param stream Index of the stream, e.g. the worker thread.
+         */
+        static Random forStream(uint64_t seed, uint64_t stream) {
+            Random random(seed);
+            for (uint64_t i = 0; i < stream; ++i) {
+                random.jump();
+            }
+            return random;
+        }
+
+        /**
+         * @brief Restarts the sequence from a seed.
+         *
+         * The state is expanded from the seed with splitmix64, so similar seeds give unrelated sequences.
+         */
+        void seed(uint64_t seed) {
+            for (auto& word : m_state) {
+                seed += 0x9E3779B97F4A7C15ull;
+                uint64_t z = seed;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                word = z ^ (z >> 31);
+            }
+        }
+
+        /**
+         * @brief Gets the next 64 random bits.
+         */
+        uint64_t next() {
+            const uint64_t result = rotl(m_state[1] * 5, 7) * 9;
+            const uint64_t t = m_state[1] << 17;
+
+            m_state[2] ^= m_state[0];
+            m_state[3] ^= m_state[1];
+            m_state[1] ^= m_state[2];
+            m_state[0] ^= m_state[3];
+            m_state[2] ^= t;
+            m_state[3] = rotl(m_state[3], 45);
+
+            return result;
+        }
+
+        /**
+         * @brief Gets a uniformly distributed integer in [0, bound).
+         *
+         * Uses Lemire's multiply-and-reject method, which needs no division in the common case.
+         */
+        uint64_t uniform(uint64_t bound) {
+            uint64_t low;
+            uint64_t high = multiplyHigh(next(), bound, low);
+
+            if (low < bound) {
+                const uint64_t threshold = (0 - bound) % bound;
+                while (low < threshold) {
+                    high = multiplyHigh(next(), bound, low);
+                }
+            }
+
+            return high;
+        }
+
+        /**
+         * @brief Gets a uniformly distributed float in [0, 1).
+         */
+        float uniformFloat() {
+            return static_cast<float>(next() >> 40) * (1.0f / static_cast<float>(1u << 24));
+        }
+
+        /**
+         * @brief Advances the state by 2^128 draws.
+         */
+        void jump() {
+            static constexpr uint64_t JUMP[] = { 0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull, 0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull };
+
+            uint64_t state[4] = { 0, 0, 0, 0 };
+            for (uint64_t jump : JUMP) {
+                for (int bit = 0; bit < 64; ++bit) {
+                    if (jump & (uint64_t{ 1 } << bit)) {
+                        for (int i = 0; i < 4; ++i) {
+                            state[i] ^= m_state[i];
+                        }
+                    }
+                    next();
+                }
+            }
+
+            for (int i = 0; i < 4; ++i) {
+                m_state[i] = state[i];
+            }
+        }
+
+        const uint64_t* state() const {
+            return m_state;
+        }
+
+        /**
+         * @brief Continues the sequence of a generator whose state() was saved.
+         */
+        void setState(const uint64_t* state) {
+            for (int i = 0; i < 4; ++i) {
+                m_state[i] = state[i];
+            }
+        }
+
+    private:
+        static uint64_t rotl(uint64_t x, int k) {
+            return (x << k) | (x >> (64 - k));
+        }
+
+        /**
+         * @brief Computes the 128-bit product a * b, returning the high and storing the low half.
+         */
+        static uint64_t multiplyHigh(uint64_t a, uint64_t b, uint64_t& low) {
+#if defined(__SIZEOF_INT128__)
+            const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+            low = static_cast<uint64_t>(product);
+            return static_cast<uint64_t>(product >> 64);
+#else
+            const uint64_t aLow = a & 0xFFFFFFFF, aHigh = a >> 32;
+            const uint64_t bLow = b & 0xFFFFFFFF, bHigh = b >> 32;
+
+            const uint64_t lowLow = aLow * bLow;
+            const uint64_t highLow = aHigh * bLow;
+            const uint64_t lowHigh = aLow * bHigh;
+            const uint64_t highHigh = aHigh * bHigh;
+
+            const uint64_t cross = (lowLow >> 32) + (highLow & 0xFFFFFFFF) + lowHigh;
+            low = (cross << 32) | (lowLow & 0xFFFFFFFF);
+            return highHigh + (highLow >> 32) + (cross >> 32);
+#endif
+        }
+
+        uint64_t m_state[4];
+    };
+
+} // end of namespace wfc2d
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace wfc2d {
+
+    /**
+     * @brief Non-owning view of a contiguous array.
+     *
+     * Plays the role of std::span (C++20) for the C++17 code base: it is how read-only planes that may live
+     * in a mapped file, or in storage owned by somebody else, are handed around without copying.
+     */
+    template <typename T>
+    class Span {
+    public:
+        using value_type = T;
+        using iterator = T*;
+
+        Span() = default;
+
+        Span(T* data, size_t size)
+            : m_data(data), m_size(size) {}
+
+        template <typename U, typename = decltype(static_cast<T*>(std::declval<std::vector<U>&>().data()))>
+        Span(std::vector<U>& vector)
+            : m_data(vector.data()), m_size(vector.size()) {}
+
+        template <typename U, typename = decltype(static_cast<T*>(std::declval<const std::vector<U>&>().data()))>
+        Span(const std::vector<U>& vector)
+            : m_data(vector.data()), m_size(vector.size()) {}
+
+        T* data() const {
+            return m_data;
+        }
+
+        size_t size() const {
+            return m_size;
+        }
+
+        bool empty() const {
+            return m_size == 0;
+        }
+
+        T& operator[](size_t index) const {
+            assert(index < m_size);
+            return m_data[index];
+        }
+
+        T* begin() const {
+            return m_data;
+        }
+
+        T* end() const {
+            return m_data + m_size;
+        }
+
+        /**
+         * @brief Gets the view of count elements starting at offset.
+         */
+        Span subspan(size_t offset, size_t count) const {
+            assert(offset + count <= m_size);
+            return Span(m_data + offset, count);
+        }
+
+    private:
+        T* m_data{ nullptr };
+        size_t m_size{ 0 };
+    };
+
+} // end of namespace wfc2d
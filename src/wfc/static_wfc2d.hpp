@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "wfc2d.hpp"
+
+namespace wfc2d {
+
+    /**
+     * @brief Ruleset written in the source, for StaticWaveFunctionCollapse2D.
+     *
+     * options[direction][tile] has bit b set if tile b may be placed next to tile in that direction, in the
+     * order UP, DOWN, LEFT, RIGHT; this is what the lines of a rules file list. As for rules files, a pair is
+     * only allowed if both tiles list each other.
+     *
+     * @tparam NumTiles Number of tiles, at most 64.
+     */
+    template <size_t NumTiles>
+    struct StaticRuleset {
+        static_assert(NumTiles > 0 && NumTiles <= 64, "Static rulesets hold between 1 and 64 tiles");
+
+        static constexpr size_t numTiles = NumTiles;
+
+        uint64_t options[4][NumTiles];
+        double weights[NumTiles];
+    };
+
+    /**
+     * @brief Solver for a ruleset that is fixed at compile time.
+     *
+     * Same API as WaveFunctionCollapse2D, with the ruleset loaded on construction. AC-3 propagation runs on
+     * the compiled adjacency masks as compile-time constants, held in the narrowest unsigned type that fits
+     * the tiles: the union of the masks over a domain becomes an unrolled sequence of immediate operations
+     * with no table lookups. The wave itself keeps the 64-bit layout of the runtime solver, which the generic
+     * kernels, the backtracking trail and snapshots share; the narrow type only shrinks the mask table.
+     *
+     * Loading another ruleset at runtime is allowed and falls back to the generic kernels. The solvers that
+     * solveParallel() runs are copies of the base class, but they keep the compiled kernel.
+     *
+     * @code
+     * constexpr wfc2d::StaticRuleset<2> checkers = { { { 2, 3 }, { 2, 3 }, { 2, 3 }, { 2, 3 } }, { 1.0, 1.0 } };
+     * wfc2d::StaticWaveFunctionCollapse2D<checkers> solver;
+     * @endcode
+     *
+     * @tparam Rules A constexpr StaticRuleset with static storage duration.
+     */
+    template <const auto& Rules>
+    class StaticWaveFunctionCollapse2D : public internal::WaveFunctionCollapse2DImpl {
+
+        friend internal::WaveFunctionCollapse2DImpl;
+
+    public:
+        static constexpr size_t NUM_TILES = std::decay_t<decltype(Rules)>::numTiles;
+
+        /**
+         * @brief Narrowest unsigned type holding a domain of the ruleset.
+         */
+        using Domain = std::conditional_t<NUM_TILES <= 8, uint8_t,
+                       std::conditional_t<NUM_TILES <= 16, uint16_t,
+                       std::conditional_t<NUM_TILES <= 32, uint32_t, uint64_t>>>;
+
+        StaticWaveFunctionCollapse2D() {
+            this->setRuleset(ruleset());
+            this->setFixedKernel(&StaticWaveFunctionCollapse2D::template propagateFixed<StaticWaveFunctionCollapse2D>, compiledRuleset());
+        }
+
+        /**
+         * @brief Gets the runtime form of the ruleset, shared by every solver of this type.
+         */
+        static const std::shared_ptr<const Ruleset>& ruleset() {
+            static const std::shared_ptr<const Ruleset> loaded = Ruleset::create(tiles());
+            return loaded;
+        }
+
+        static const std::shared_ptr<const CompiledRuleset>& compiledRuleset() {
+            return ruleset()->compiled();
+        }
+
+        /**
+         * @brief Gets the ruleset as tiles, as parseRulesFromFile() would return them.
+         */
+        static std::vector<Tile> tiles() {
+            std::vector<Tile> result(NUM_TILES);
+            for (size_t tile = 0; tile < NUM_TILES; ++tile) {
+                for (size_t direction = 0; direction < NUM_OPTION_DIRECTIONS; ++direction) {
+                    for (size_t option = 0; option < NUM_TILES; ++option) {
+                        if ((Rules.options[direction][tile] >> option) & 1u) {
+                            result[tile].options[direction].set(option);
+                        }
+                    }
+                }
+                result[tile].weight = Rules.weights[tile];
+            }
+            return result;
+        }
+
+    private:
+        using Masks = Domain[NUM_OPTION_DIRECTIONS][NUM_TILES];
+
+        struct CompiledMasks {
+            Masks masks;
+        };
+
+        /**
+         * @brief Keeps the pairs listed by both tiles, as CompiledRuleset::compile() does.
+         */
+        static constexpr CompiledMasks compileMasks() {
+            CompiledMasks compiled{};
+            for (size_t direction = 0; direction < NUM_OPTION_DIRECTIONS; ++direction) {
+                // Up <-> Down, Left <-> Right
+                const size_t opposite = direction ^ 1;
+                for (size_t tile = 0; tile < NUM_TILES; ++tile) {
+                    for (size_t option = 0; option < NUM_TILES; ++option) {
+                        if (((Rules.options[direction][tile] >> option) & 1u) && ((Rules.options[opposite][option] >> tile) & 1u)) {
+                            compiled.masks[direction][tile] = static_cast<Domain>(compiled.masks[direction][tile] | (Domain{ 1 } << option));
+                        }
+                    }
+                }
+            }
+            return compiled;
+        }
+
+        static constexpr CompiledMasks MASKS = compileMasks();
+
+        template <size_t Direction, size_t... Options>
+        static Domain unite(Domain source, std::index_sequence<Options...>) {
+            // Every option contributes its mask if its bit is set: an AND with an all-ones or zero word
+            return static_cast<Domain>((... | (static_cast<Domain>(0 - ((source >> Options) & 1u)) & MASKS.masks[Direction][Options])));
+        }
+
+        /**
+         * @brief Gets the options allowed in a direction by any of the options in source.
+         */
+        static uint64_t supportedBy(uint64_t source, size_t direction) {
+            using Options = std::make_index_sequence<NUM_TILES>;
+            const Domain domain = static_cast<Domain>(source);
+            switch (direction) {
+                case 0:  return unite<0>(domain, Options{});
+                case 1:  return unite<1>(domain, Options{});
+                case 2:  return unite<2>(domain, Options{});
+                default: return unite<3>(domain, Options{});
+            }
+        }
+    };
+
+} // end of namespace wfc2d
@@ -0,0 +1,50 @@
+#pragma once
+
+namespace wfc2d {
+
+    /**
+     * @brief Outcome of an operation that can fail, as reported by getStatus() and the loaders.
+     */
+    enum class EStatus {
+        Ok,
+        NotInitialized,      /**< initialize() was not called. */
+        NoRuleset,           /**< No ruleset is attached, or it has no tiles. */
+        Contradiction,       /**< Every attempt ran into an empty domain. */
+        TimeBudgetExhausted, /**< The time budget ran out before a solution was found. */
+        Cancelled,           /**< The stop flag was raised. */
+        FileNotFound,        /**< A file could not be opened. */
+        InvalidFormat,       /**< A file is not a valid ruleset of the expected format or version. */
+        WriteFailed,         /**< A file could not be written. */
+        TooManyTiles,        /**< The ruleset has more tiles than the output type can hold. */
+    };
+
+    inline const char* toString(EStatus status) {
+        switch (status) {
+            case EStatus::Ok:                  return "ok";
+            case EStatus::NotInitialized:      return "not initialized";
+            case EStatus::NoRuleset:           return "no ruleset loaded";
+            case EStatus::Contradiction:       return "contradiction in every attempt";
+            case EStatus::TimeBudgetExhausted: return "time budget exhausted";
+            case EStatus::Cancelled:           return "cancelled";
+            case EStatus::FileNotFound:        return "file not found";
+            case EStatus::InvalidFormat:       return "invalid format";
+            case EStatus::WriteFailed:         return "write failed";
+            case EStatus::TooManyTiles:        return "too many tiles for the output type";
+        }
+        return "unknown";
+    }
+
+    namespace internal {
+
+        /**
+         * @brief Stores an outcome through an optional status out-parameter.
+         */
+        inline void setStatus(EStatus* status, EStatus value) {
+            if (status) {
+                *status = value;
+            }
+        }
+
+    } // end of namespace internal
+
+} // end of namespace wfc2d
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "span.hpp"
+#include "wfc2d.hpp"
+
+namespace wfc2d {
+
+    /**
+     * @brief Generates an endless strip of rows, keeping only a fixed window of them in memory.
+     *
+     * Rows are solved a window at a time by one WaveFunctionCollapse2D sized to the window, whose wave and
+     * output are reused for every window. A window starts with the last emitted row pinned to its final
+     * tiles, so the new rows connect to it, and ends with a few lookahead rows. Only the rows between the two
+     * are committed: the lookahead shows that the committed frontier can still be extended, and is solved
+     * again as part of the next window. Committed rows are handed to the consumer and kept in a ring buffer
+     * of one window of rows, whose slots are recycled for the rows at the frontier; memory therefore depends
+     * on the window size and the width, never on how many rows were generated.
+     *
+     * At most one row of context is pinned, so rows far above the frontier don't constrain it, and windows
+     * that run into a contradiction are retried with the next draws of their seed.
+     */
+    class StreamingGenerator {
+    public:
+        using Solver = WaveFunctionCollapse2D;
+        using Ruleset = Solver::Ruleset;
+        using CompiledRuleset = Solver::CompiledRuleset;
+        using EPropagation = Solver::EPropagation;
+
+        /**
+         * @brief Receives every committed row in order.
+         *
+         * The tiles stay valid until the ring slot of the row is recycled, one window of rows later.
+         * Returning false stops generate().
+         */
+        using RowCallbackFn = std::function<bool(size_t row, Span<const TileIndex> tiles)>;
+
+        static constexpr size_t DEFAULT_WINDOW_ROWS = 32;
+        static constexpr size_t DEFAULT_LOOKAHEAD_ROWS = 8;
+        static constexpr size_t DEFAULT_MAX_WINDOW_ATTEMPTS = 32;
+
+        /**
+         * @brief Loads the ruleset from a file.
+         *
+         * @param filepath Path of the ruleset file.
+         * @return True if at least one tile was loaded.
+         */
+        bool parseRulesFromFile(const std::string& filepath) {
+            const auto ruleset = Ruleset::load(filepath, &this->m_status);
+            if (!ruleset || ruleset->empty()) {
+                if (ruleset) {
+                    this->m_status = EStatus::NoRuleset;
+                }
+                return false;
+            }
+
+            setCompiledRuleset(ruleset->compiled());
+            return true;
+        }
+
+        void setCompiledRuleset(std::shared_ptr<const CompiledRuleset> ruleset) {
+            this->m_solver.setCompiledRuleset(std::move(ruleset));
+        }
+
+        std::shared_ptr<const CompiledRuleset> getCompiledRuleset() const {
+            return this->m_solver.getCompiledRuleset();
+        }
+
+        /**
+         * @brief Sets the rows solved per window, which is also the number of rows kept in the ring buffer.
+         */
+        void setWindowRows(size_t windowRows) {
+            assert(windowRows >= 2);
+            this->m_windowRows = windowRows;
+        }
+
+        size_t getWindowRows() const {
+            return this->m_windowRows;
+        }
+
+        /**
+         * @brief Sets the rows solved past the committed ones in every window and then discarded.
+         *
+         * More lookahead makes dead ends at the frontier rarer, at the cost of solving more rows per emitted one.
+         * At least one row of every window is committed.
+         */
+        void setLookaheadRows(size_t lookaheadRows) {
+            this->m_lookaheadRows = lookaheadRows;
+        }
+
+        size_t getLookaheadRows() const {
+            return this->m_lookaheadRows;
+        }
+
+        void setSeed(uint64_t seed) {
+            this->m_seed = seed;
+        }
+
+        void setPropagation(EPropagation propagation) {
+            this->m_solver.setPropagation(propagation);
+        }
+
+        /**
+         * @brief Lets the window solver backtrack instead of only restarting on contradictions.
+         */
+        void setBacktracking(bool enabled) {
+            this->m_solver.setBacktracking(enabled);
+        }
+
+        /**
+         * @brief Sets how many times a window is attempted before generate() gives up.
+         */
+        void setMaxWindowAttempts(size_t maxWindowAttempts) {
+            assert(maxWindowAttempts > 0);
+            this->m_maxWindowAttempts = maxWindowAttempts;
+        }
+
+        /**
+         * @brief Generates rows and streams them to a consumer.
+         *
+         * Every call starts a new strip from row 0.
+         *
+         * @param cols Number of columns of every row.
+         * @param consumer Receives the rows in order; generation stops when it returns false.
+         * @param maxRows Number of rows to generate; 0 generates until the consumer stops.
+         * @return True if generation ended because of the consumer or maxRows, false if a window could not
+         * be solved; getStatus() tells why.
+         */
+        bool generate(size_t cols, const RowCallbackFn& consumer, size_t maxRows = 0) {
+            assert(cols > 0);
+
+            if (!this->m_solver.getCompiledRuleset() || this->m_solver.getCompiledRuleset()->numTiles == 0) {
+                internal::log<ELogLevel::Error>("No ruleset loaded.");
+                this->m_status = EStatus::NoRuleset;
+                return false;
+            }
+
+            this->m_cols = cols;
+            this->m_rowsEmitted = 0;
+            this->m_ring.assign(this->m_windowRows * cols, NO_TILE);
+
+            // Restarts are driven by solveWindow() so that the context row is pinned again every time
+            this->m_solver.setMaxRestarts(0);
+
+            for (size_t window = 0; ; ++window) {
+                const size_t context = this->m_rowsEmitted > 0 ? 1 : 0;
+                const size_t lookahead = std::min(this->m_lookaheadRows, this->m_windowRows - context - 1);
+                size_t commit = this->m_windowRows - context - lookahead;
+                size_t height = this->m_windowRows;
+
+                // The last window of a bounded strip has nothing left to look ahead for
+                if (maxRows > 0 && maxRows - this->m_rowsEmitted <= commit) {
+                    commit = maxRows - this->m_rowsEmitted;
+                    height = context + commit;
+                }
+
+                if (!solveWindow(window, height, context)) {
+                    internal::log<ELogLevel::Warning>("Unable to solve window ", window, ".");
+                    this->m_status = EStatus::Contradiction;
+                    return false;
+                }
+
+                for (size_t row = 0; row < commit; ++row) {
+                    TileIndex* slot = &this->m_ring[(this->m_rowsEmitted % this->m_windowRows) * cols];
+                    for (size_t col = 0; col < cols; ++col) {
+                        slot[col] = this->m_solver[(context + row) * cols + col];
+                    }
+
+                    const size_t emitted = this->m_rowsEmitted++;
+                    if (!consumer(emitted, Span<const TileIndex>(slot, cols))) {
+                        this->m_status = EStatus::Ok;
+                        return true;
+                    }
+                }
+
+                if (maxRows > 0 && this->m_rowsEmitted == maxRows) {
+                    this->m_status = EStatus::Ok;
+                    return true;
+                }
+            }
+        }
+
+        /**
+         * @brief Gets the number of rows emitted by the last generate() call.
+         */
+        size_t getRowsEmitted() const {
+            return this->m_rowsEmitted;
+        }
+
+        /**
+         * @brief Gets the outcome of the last generate() or parseRulesFromFile().
+         */
+        EStatus getStatus() const {
+            return this->m_status;
+        }
+
+        size_t getCols() const {
+            return this->m_cols;
+        }
+
+        /**
+         * @brief Gets an emitted row that is still in the ring buffer.
+         *
+         * @return The tiles of the row, or an empty span if it was not emitted yet or was already recycled.
+         */
+        Span<const TileIndex> getRow(size_t row) const {
+            if (row >= this->m_rowsEmitted || this->m_rowsEmitted - row > this->m_windowRows) {
+                return {};
+            }
+            return Span<const TileIndex>(&this->m_ring[(row % this->m_windowRows) * this->m_cols], this->m_cols);
+        }
+
+    private:
+        /**
+         * @brief Solves one window below the last emitted row.
+         */
+        bool solveWindow(size_t window, size_t height, size_t context) {
+            // Distinct draws for every window
+            this->m_solver.setNextSeed(this->m_seed ^ (static_cast<uint64_t>(window) * 0x9E3779B97F4A7C15ull));
+            this->m_solver.initialize(height, this->m_cols);
+
+            const Span<const TileIndex> last = context > 0 ? getRow(this->m_rowsEmitted - 1) : Span<const TileIndex>{};
+
+            for (size_t attempt = 0; attempt < this->m_maxWindowAttempts; ++attempt) {
+                if (attempt > 0) {
+                    this->m_solver.reset();
+                }
+
+                for (size_t col = 0; col < last.size(); ++col) {
+                    if (!this->m_solver.collapse(col, last[col])) {
+                        return false;
+                    }
+                }
+
+                if (this->m_solver.run()) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        Solver m_solver; /**< Sized to one window, reused for all of them. */
+
+        size_t m_windowRows{ DEFAULT_WINDOW_ROWS };
+        size_t m_lookaheadRows{ DEFAULT_LOOKAHEAD_ROWS };
+        size_t m_maxWindowAttempts{ DEFAULT_MAX_WINDOW_ATTEMPTS };
+        uint64_t m_seed{ 0 };
+
+        size_t m_cols{ 0 };
+        size_t m_rowsEmitted{ 0 };
+        std::vector<TileIndex> m_ring; /**< The last m_windowRows emitted rows; row r lives in slot r % m_windowRows. */
+        EStatus m_status{ EStatus::Ok };
+    };
+
+} // end of namespace wfc2d
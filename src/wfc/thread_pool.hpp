@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wfc2d {
+
+    namespace internal {
+
+        /**
+         * @brief Fixed set of worker threads running one parallel loop at a time.
+         *
+         * parallelFor() hands out task indices from a shared atomic counter, so a worker that finishes early
+         * simply claims the next task instead of waiting for a static share; the calling thread takes part as
+         * worker 0. The threads are started once and sleep between loops.
+         */
+        class ThreadPool {
+        public:
+            /**
+             * @param numThreads Number of workers including the calling thread; 0 uses every hardware thread.
+             */
+            explicit ThreadPool(size_t numThreads = 0) {
+                if (numThreads == 0) {
+                    numThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+                }
+
+                m_threads.reserve(numThreads - 1);
+                for (size_t worker = 1; worker < numThreads; ++worker) {
+                    m_threads.emplace_back([this, worker]() { workerLoop(worker); });
+                }
+            }
+
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            ~ThreadPool() {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stopping = true;
+                }
+                m_wake.notify_all();
+
+                for (auto& thread : m_threads) {
+                    thread.join();
+                }
+            }
+
+            /**
+             * @brief Gets the number of workers, including the calling thread.
+             */
+            size_t size() const {
+                return m_threads.size() + 1;
+            }
+
+            /**
+             * @brief Calls fn(task, worker) for every task in [0, count) and returns once all of them ran.
+             *
+             * @param count Number of tasks.
+             * @param fn Callable invoked with the task index and the index of the worker running it, in [0, size()).
+             */
+            void parallelFor(size_t count, const std::function<void(size_t, size_t)>& fn) {
+                if (count == 0) {
+                    return;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_task = &fn;
+                    m_count = count;
+                    m_next.store(0, std::memory_order_relaxed);
+                    m_busy = m_threads.size();
+                    ++m_generation;
+                }
+                m_wake.notify_all();
+
+                runTasks(0);
+
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_done.wait(lock, [this]() { return m_busy == 0; });
+                m_task = nullptr;
+            }
+
+        private:
+            void workerLoop(size_t worker) {
+                size_t generation = 0;
+                while (true) {
+                    {
+                        std::unique_lock<std::mutex> lock(m_mutex);
+                        m_wake.wait(lock, [this, generation]() { return m_stopping || m_generation != generation; });
+                        if (m_stopping) {
+                            return;
+                        }
+                        generation = m_generation;
+                    }
+
+                    runTasks(worker);
+
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (--m_busy == 0) {
+                        m_done.notify_one();
+                    }
+                }
+            }
+
+            void runTasks(size_t worker) {
+                for (size_t task = m_next.fetch_add(1, std::memory_order_relaxed); task < m_count; task = m_next.fetch_add(1, std::memory_order_relaxed)) {
+                    (*m_task)(task, worker);
+                }
+            }
+
+            std::vector<std::thread> m_threads;
+            std::mutex m_mutex;
+            std::condition_variable m_wake;
+            std::condition_variable m_done;
+
+            const std::function<void(size_t, size_t)>* m_task{ nullptr };
+            size_t m_count{ 0 };
+            std::atomic<size_t> m_next{ 0 };
+            size_t m_busy{ 0 };            /**< Background workers still running the current loop. */
+            size_t m_generation{ 0 };      /**< Incremented for every loop, wakes the workers. */
+            bool m_stopping{ false };
+        };
+
+    } // end of namespace internal
+
+} // end of namespace wfc2d
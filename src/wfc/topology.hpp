@@ -0,0 +1,522 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace wfc2d {
+
+    /**
+     * @brief Behaviour of the edges of a grid.
+     *
+     * Fixed grids have edges: border cells have fewer neighbours, and tiles that need a neighbour in some
+     * direction are ruled out on that edge. Periodic grids wrap around in every axis, like a torus, so the
+     * output tiles seamlessly with copies of itself.
+     */
+    enum class EBoundary { Fixed, Periodic };
+
+    /*
+     * Topologies tell the solver which cells there are and how they are connected. The solver is a template
+     * on its topology, so the neighbour walk of propagation is inlined for each of them. A topology provides:
+     *
+     *   NUM_DIRECTIONS                  Number of directions, which is also the number of rule lists per tile.
+     *   opposite(direction)             The direction pointing back from a neighbour.
+     *   findDirection(name)             The direction a rules file calls name, or NUM_DIRECTIONS if none.
+     *   directionName(direction)        The name of a direction in rules files.
+     *   size()                          Number of cells.
+     *   forEachNeighbor(index, fn)      Calls fn(direction, neighborIndex) for every neighbour of a cell,
+     *                                   in increasing direction order.
+     *
+     * Directions always come in pairs 2k and 2k + 1 that point in opposite ways. Topologies built from sizes
+     * also have assign(sizes...), which takes the arguments of their constructor and reshapes them in place.
+     */
+
+    namespace internal {
+
+        /**
+         * @brief Offsets to the neighbours of the cells of one slice of a grid along one axis.
+         */
+        struct AxisSteps {
+            size_t before{ 0 };   /**< Added to the index, modulo 2^64, for the neighbour before the slice. */
+            size_t after{ 0 };    /**< Added to the index for the neighbour after the slice. */
+            unsigned exists{ 0 }; /**< Bit 0 if the neighbour before exists, bit 1 if the one after does. */
+        };
+
+        /**
+         * @brief Builds the steps of every slice of an axis.
+         *
+         * Steps are added in unsigned arithmetic, so a step back is stored as its two's complement and the
+         * wrap-around of a periodic axis is just another step. The table is rebuilt in place, so reshaping a
+         * topology to a size it had before does not allocate.
+         *
+         * @param steps Table to fill, one entry per slice.
+         * @param count Number of slices along the axis.
+         * @param stride Distance between the indices of two neighbouring slices.
+         * @param periodic True if the axis wraps around.
+         */
+        inline void buildAxisSteps(std::vector<AxisSteps>& steps, size_t count, size_t stride, bool periodic) {
+            const size_t span = count * stride;
+            steps.assign(count, AxisSteps{});
+            for (size_t slice = 0; slice < count; ++slice) {
+                if (slice > 0 || periodic) {
+                    steps[slice].before = slice > 0 ? 0 - stride : span - stride;
+                    steps[slice].exists |= 1u;
+                }
+                if (slice + 1 < count || periodic) {
+                    steps[slice].after = slice + 1 < count ? stride : 0 - (span - stride);
+                    steps[slice].exists |= 2u;
+                }
+            }
+        }
+
+        /**
+         * @brief Looks a direction name up in a table of names.
+         */
+        template <size_t Count>
+        size_t findName(const char* const (&names)[Count], const std::string& name) {
+            for (size_t direction = 0; direction < Count; ++direction) {
+                if (name == names[direction]) {
+                    return direction;
+                }
+            }
+            return Count;
+        }
+
+    } // end of namespace internal
+
+    /**
+     * @brief Rectangular grid of square cells with four neighbours, in row-major order.
+     */
+    class QuadTopology {
+    public:
+        enum class EDirections { Up, Down, Left, Right };
+
+        static constexpr size_t NUM_DIRECTIONS = 4;
+
+        static constexpr size_t opposite(size_t direction) {
+            return direction ^ 1;
+        }
+
+        static size_t findDirection(const std::string& name) {
+            return internal::findName(DIRECTION_NAMES, name);
+        }
+
+        static std::string directionName(size_t direction) {
+            return DIRECTION_NAMES[direction];
+        }
+
+        QuadTopology() = default;
+
+        /**
+         * @param rows Number of rows in the grid.
+         * @param cols Number of columns in the grid.
+         * @param boundary Whether the grid has edges or wraps around.
+         */
+        QuadTopology(size_t rows, size_t cols, EBoundary boundary = EBoundary::Fixed) {
+            assign(rows, cols, boundary);
+        }
+
+        /**
+         * @brief Reshapes the grid, reusing the storage of the neighbour tables.
+         */
+        void assign(size_t rows, size_t cols, EBoundary boundary = EBoundary::Fixed) {
+            this->m_rows = rows;
+            this->m_cols = cols;
+            this->m_boundary = boundary;
+            internal::buildAxisSteps(this->m_rowSteps, rows, cols, boundary == EBoundary::Periodic);
+            internal::buildAxisSteps(this->m_colSteps, cols, 1, boundary == EBoundary::Periodic);
+        }
+
+        size_t size() const {
+            return this->m_rows * this->m_cols;
+        }
+
+        size_t rows() const {
+            return this->m_rows;
+        }
+
+        size_t cols() const {
+            return this->m_cols;
+        }
+
+        EBoundary boundary() const {
+            return this->m_boundary;
+        }
+
+        /**
+         * @brief Calls fn(direction, neighborIndex) for every neighbour of a cell, in the order UP, DOWN, LEFT, RIGHT.
+         *
+         * The row is recovered with a single division, and the offsets come from per-row and per-column
+         * tables, which already hold the wrap-around of a periodic grid. Every cell of a periodic grid and
+         * the interior cells of a fixed one, by far the most common, take the same path without
+         * per-direction checks. Only the edges of a fixed grid test which neighbours exist.
+         */
+        template <typename Fn>
+        void forEachNeighbor(size_t index, Fn&& fn) const {
+            const size_t row = index / this->m_cols;
+            const size_t col = index - row * this->m_cols;
+            const internal::AxisSteps& vertical = this->m_rowSteps[row];
+            const internal::AxisSteps& horizontal = this->m_colSteps[col];
+            const unsigned exists = vertical.exists | horizontal.exists << 2;
+
+            if (exists == 0xF) {
+                fn(static_cast<size_t>(EDirections::Up), index + vertical.before);
+                fn(static_cast<size_t>(EDirections::Down), index + vertical.after);
+                fn(static_cast<size_t>(EDirections::Left), index + horizontal.before);
+                fn(static_cast<size_t>(EDirections::Right), index + horizontal.after);
+                return;
+            }
+
+            if (exists & 1u) {
+                fn(static_cast<size_t>(EDirections::Up), index + vertical.before);
+            }
+
+            if (exists & 2u) {
+                fn(static_cast<size_t>(EDirections::Down), index + vertical.after);
+            }
+
+            if (exists & 4u) {
+                fn(static_cast<size_t>(EDirections::Left), index + horizontal.before);
+            }
+
+            if (exists & 8u) {
+                fn(static_cast<size_t>(EDirections::Right), index + horizontal.after);
+            }
+        }
+
+    private:
+        static constexpr const char* DIRECTION_NAMES[NUM_DIRECTIONS] = { "up", "down", "left", "right" };
+
+        size_t m_rows{ 0 };
+        size_t m_cols{ 0 };
+        EBoundary m_boundary{ EBoundary::Fixed };
+        std::vector<internal::AxisSteps> m_rowSteps; /**< Vertical neighbour offsets of every row. */
+        std::vector<internal::AxisSteps> m_colSteps; /**< Horizontal neighbour offsets of every column. */
+    };
+
+    /**
+     * @brief Box of cubic cells with six neighbours, stored layer by layer, each layer in row-major order.
+     *
+     * Within a layer the directions are those of QuadTopology; BELOW and ABOVE lead to the previous and the
+     * next layer.
+     */
+    class CubeTopology {
+    public:
+        enum class EDirections { Up, Down, Left, Right, Below, Above };
+
+        static constexpr size_t NUM_DIRECTIONS = 6;
+
+        static constexpr size_t opposite(size_t direction) {
+            return direction ^ 1;
+        }
+
+        static size_t findDirection(const std::string& name) {
+            return internal::findName(DIRECTION_NAMES, name);
+        }
+
+        static std::string directionName(size_t direction) {
+            return DIRECTION_NAMES[direction];
+        }
+
+        CubeTopology() = default;
+
+        /**
+         * @param layers Number of layers in the box.
+         * @param rows Number of rows in every layer.
+         * @param cols Number of columns in every layer.
+         * @param boundary Whether the box has faces or wraps around in all three axes.
+         */
+        CubeTopology(size_t layers, size_t rows, size_t cols, EBoundary boundary = EBoundary::Fixed) {
+            assign(layers, rows, cols, boundary);
+        }
+
+        /**
+         * @brief Reshapes the box, reusing the storage of the neighbour tables.
+         */
+        void assign(size_t layers, size_t rows, size_t cols, EBoundary boundary = EBoundary::Fixed) {
+            this->m_layers = layers;
+            this->m_rows = rows;
+            this->m_cols = cols;
+            this->m_boundary = boundary;
+            internal::buildAxisSteps(this->m_layerSteps, layers, rows * cols, boundary == EBoundary::Periodic);
+            internal::buildAxisSteps(this->m_rowSteps, rows, cols, boundary == EBoundary::Periodic);
+            internal::buildAxisSteps(this->m_colSteps, cols, 1, boundary == EBoundary::Periodic);
+        }
+
+        size_t size() const {
+            return this->m_layers * this->m_rows * this->m_cols;
+        }
+
+        size_t layers() const {
+            return this->m_layers;
+        }
+
+        size_t rows() const {
+            return this->m_rows;
+        }
+
+        size_t cols() const {
+            return this->m_cols;
+        }
+
+        EBoundary boundary() const {
+            return this->m_boundary;
+        }
+
+        /**
+         * @brief Calls fn(direction, neighborIndex) for every neighbour of a cell, in the order UP, DOWN,
+         * LEFT, RIGHT, BELOW, ABOVE, with the same tables as QuadTopology plus one per layer.
+         */
+        template <typename Fn>
+        void forEachNeighbor(size_t index, Fn&& fn) const {
+            const size_t layerSize = this->m_rows * this->m_cols;
+            const size_t layer = index / layerSize;
+            const size_t inLayer = index - layer * layerSize;
+            const size_t row = inLayer / this->m_cols;
+            const size_t col = inLayer - row * this->m_cols;
+            const internal::AxisSteps& vertical = this->m_rowSteps[row];
+            const internal::AxisSteps& horizontal = this->m_colSteps[col];
+            const internal::AxisSteps& depth = this->m_layerSteps[layer];
+            const unsigned exists = vertical.exists | horizontal.exists << 2 | depth.exists << 4;
+
+            if (exists == 0x3F) {
+                fn(static_cast<size_t>(EDirections::Up), index + vertical.before);
+                fn(static_cast<size_t>(EDirections::Down), index + vertical.after);
+                fn(static_cast<size_t>(EDirections::Left), index + horizontal.before);
+                fn(static_cast<size_t>(EDirections::Right), index + horizontal.after);
+                fn(static_cast<size_t>(EDirections::Below), index + depth.before);
+                fn(static_cast<size_t>(EDirections::Above), index + depth.after);
+                return;
+            }
+
+            const size_t steps[NUM_DIRECTIONS] = { vertical.before, vertical.after, horizontal.before, horizontal.after, depth.before, depth.after };
+            for (size_t direction = 0; direction < NUM_DIRECTIONS; ++direction) {
+                if (exists & (1u << direction)) {
+                    fn(direction, index + steps[direction]);
+                }
+            }
+        }
+
+    private:
+        static constexpr const char* DIRECTION_NAMES[NUM_DIRECTIONS] = { "up", "down", "left", "right", "below", "above" };
+
+        size_t m_layers{ 0 };
+        size_t m_rows{ 0 };
+        size_t m_cols{ 0 };
+        EBoundary m_boundary{ EBoundary::Fixed };
+        std::vector<internal::AxisSteps> m_layerSteps; /**< Neighbour offsets of every layer. */
+        std::vector<internal::AxisSteps> m_rowSteps;
+        std::vector<internal::AxisSteps> m_colSteps;
+    };
+
+    /**
+     * @brief Rectangular map of pointy-top hexagons with six neighbours, in row-major order.
+     *
+     * Odd rows are shifted half a cell to the right ("odd-r" offset layout), so the upper neighbours of a
+     * cell in row r are in row r - 1 at columns c - 1 and c for an even row, c and c + 1 for an odd one.
+     * A periodic map needs an even number of rows for the shift to line up across the wrap-around.
+     */
+    class HexTopology {
+    public:
+        enum class EDirections { UpLeft, DownRight, Left, Right, UpRight, DownLeft };
+
+        static constexpr size_t NUM_DIRECTIONS = 6;
+
+        static constexpr size_t opposite(size_t direction) {
+            return direction ^ 1;
+        }
+
+        static size_t findDirection(const std::string& name) {
+            return internal::findName(DIRECTION_NAMES, name);
+        }
+
+        static std::string directionName(size_t direction) {
+            return DIRECTION_NAMES[direction];
+        }
+
+        HexTopology() = default;
+
+        /**
+         * @param rows Number of rows in the map.
+         * @param cols Number of cells in every row.
+         * @param boundary Whether the map has edges or wraps around.
+         */
+        HexTopology(size_t rows, size_t cols, EBoundary boundary = EBoundary::Fixed) {
+            assign(rows, cols, boundary);
+        }
+
+        /**
+         * @brief Reshapes the map, reusing the storage of the neighbour tables.
+         */
+        void assign(size_t rows, size_t cols, EBoundary boundary = EBoundary::Fixed) {
+            assert(boundary == EBoundary::Fixed || rows % 2 == 0);
+            this->m_rows = rows;
+            this->m_cols = cols;
+            this->m_boundary = boundary;
+            internal::buildAxisSteps(this->m_rowSteps, rows, cols, boundary == EBoundary::Periodic);
+            internal::buildAxisSteps(this->m_colSteps, cols, 1, boundary == EBoundary::Periodic);
+        }
+
+        size_t size() const {
+            return this->m_rows * this->m_cols;
+        }
+
+        size_t rows() const {
+            return this->m_rows;
+        }
+
+        size_t cols() const {
+            return this->m_cols;
+        }
+
+        EBoundary boundary() const {
+            return this->m_boundary;
+        }
+
+        /**
+         * @brief Calls fn(direction, neighborIndex) for every neighbour of a cell, in the order UP_LEFT,
+         * DOWN_RIGHT, LEFT, RIGHT, UP_RIGHT, DOWN_LEFT.
+         *
+         * The diagonal neighbours are a row step plus, on one side depending on the parity of the row, a
+         * column step, both taken from the same tables as QuadTopology.
+         */
+        template <typename Fn>
+        void forEachNeighbor(size_t index, Fn&& fn) const {
+            const size_t row = index / this->m_cols;
+            const size_t col = index - row * this->m_cols;
+            const internal::AxisSteps& vertical = this->m_rowSteps[row];
+            const internal::AxisSteps& horizontal = this->m_colSteps[col];
+            const bool odd = (row & 1) != 0;
+
+            // Even rows lean left, odd rows right
+            const size_t upLeft = vertical.before + (odd ? 0 : horizontal.before);
+            const size_t upRight = vertical.before + (odd ? horizontal.after : 0);
+            const size_t downLeft = vertical.after + (odd ? 0 : horizontal.before);
+            const size_t downRight = vertical.after + (odd ? horizontal.after : 0);
+
+            if ((vertical.exists & horizontal.exists) == 3u) {
+                fn(static_cast<size_t>(EDirections::UpLeft), index + upLeft);
+                fn(static_cast<size_t>(EDirections::DownRight), index + downRight);
+                fn(static_cast<size_t>(EDirections::Left), index + horizontal.before);
+                fn(static_cast<size_t>(EDirections::Right), index + horizontal.after);
+                fn(static_cast<size_t>(EDirections::UpRight), index + upRight);
+                fn(static_cast<size_t>(EDirections::DownLeft), index + downLeft);
+                return;
+            }
+
+            const bool up = (vertical.exists & 1u) != 0;
+            const bool down = (vertical.exists & 2u) != 0;
+            const bool left = (horizontal.exists & 1u) != 0;
+            const bool right = (horizontal.exists & 2u) != 0;
+
+            if (up && (odd || left)) {
+                fn(static_cast<size_t>(EDirections::UpLeft), index + upLeft);
+            }
+
+            if (down && (!odd || right)) {
+                fn(static_cast<size_t>(EDirections::DownRight), index + downRight);
+            }
+
+            if (left) {
+                fn(static_cast<size_t>(EDirections::Left), index + horizontal.before);
+            }
+
+            if (right) {
+                fn(static_cast<size_t>(EDirections::Right), index + horizontal.after);
+            }
+
+            if (up && (!odd || right)) {
+                fn(static_cast<size_t>(EDirections::UpRight), index + upRight);
+            }
+
+            if (down && (odd || left)) {
+                fn(static_cast<size_t>(EDirections::DownLeft), index + downLeft);
+            }
+        }
+
+    private:
+        static constexpr const char* DIRECTION_NAMES[NUM_DIRECTIONS] = { "up_left", "down_right", "left", "right", "up_right", "down_left" };
+
+        size_t m_rows{ 0 };
+        size_t m_cols{ 0 };
+        EBoundary m_boundary{ EBoundary::Fixed };
+        std::vector<internal::AxisSteps> m_rowSteps;
+        std::vector<internal::AxisSteps> m_colSteps;
+    };
+
+    /**
+     * @brief Arbitrary graph of cells given as a CSR adjacency list.
+     *
+     * The edges of cell i are edges[offsets[i]] to edges[offsets[i + 1] - 1], sorted by direction, at most one
+     * per direction. Every edge needs its reverse: an edge from a to b in direction d requires an edge from b
+     * to a in direction opposite(d) = d ^ 1. Directions are named "0" to "Directions - 1" in rules files.
+     *
+     * @tparam Directions Number of edge directions, an even number.
+     */
+    template <size_t Directions>
+    class GraphTopology {
+        static_assert(Directions > 0 && Directions % 2 == 0, "Graph directions come in opposite pairs");
+
+    public:
+        static constexpr size_t NUM_DIRECTIONS = Directions;
+
+        struct Edge {
+            uint32_t target;    /**< Index of the neighbouring cell. */
+            uint32_t direction; /**< Direction of the neighbour, below Directions. */
+        };
+
+        static constexpr size_t opposite(size_t direction) {
+            return direction ^ 1;
+        }
+
+        static size_t findDirection(const std::string& name) {
+            size_t direction = 0;
+            for (const char digit : name) {
+                if (digit < '0' || digit > '9' || direction >= Directions) {
+                    return Directions;
+                }
+                direction = direction * 10 + static_cast<size_t>(digit - '0');
+            }
+            return name.empty() || direction >= Directions ? Directions : direction;
+        }
+
+        static std::string directionName(size_t direction) {
+            return std::to_string(direction);
+        }
+
+        GraphTopology() = default;
+
+        /**
+         * @param offsets First edge of every cell, followed by the total number of edges.
+         * @param edges Edges of all cells, cell by cell.
+         */
+        GraphTopology(std::vector<uint32_t> offsets, std::vector<Edge> edges)
+            : m_offsets(std::move(offsets)), m_edges(std::move(edges)) {
+            assert(!this->m_offsets.empty() && this->m_offsets.back() == this->m_edges.size());
+        }
+
+        size_t size() const {
+            return this->m_offsets.empty() ? 0 : this->m_offsets.size() - 1;
+        }
+
+        /**
+         * @brief Calls fn(direction, neighborIndex) for every edge of a cell, in the order of the list.
+         */
+        template <typename Fn>
+        void forEachNeighbor(size_t index, Fn&& fn) const {
+            const Edge* edge = this->m_edges.data() + this->m_offsets[index];
+            const Edge* end = this->m_edges.data() + this->m_offsets[index + 1];
+            for (; edge != end; ++edge) {
+                fn(static_cast<size_t>(edge->direction), static_cast<size_t>(edge->target));
+            }
+        }
+
+    private:
+        std::vector<uint32_t> m_offsets;
+        std::vector<Edge> m_edges;
+    };
+
+} // end of namespace wfc2d
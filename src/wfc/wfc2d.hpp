@@ -1,382 +1,3479 @@
+#pragma once
+
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <cassert>
 #include <algorithm>
 #include <functional>
 #include <vector>
-#include <bitset>
 #include <array>
-#include <random>
 #include <limits>
+#include <memory>
+#include <cstdint>
 #include <queue>
 #include <stack>
+#include <type_traits>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cmath>
+#include <iterator>
+#include <charconv>
+
+#include "domain.hpp"
+#include "domain_simd.hpp"
+#include "entropy_heap.hpp"
+#include "json.hpp"
+#include "log.hpp"
+#include "log_table.hpp"
+#include "mapped_file.hpp"
+#include "output.hpp"
+#include "random.hpp"
+#include "span.hpp"
+#include "status.hpp"
+#include "thread_pool.hpp"
+#include "topology.hpp"
+
+// Set to 1 to fill SolverStats during run(); the default build keeps no statistics
+#ifndef WFC_SOLVER_STATS
+#define WFC_SOLVER_STATS 0
+#endif
 
 namespace wfc2d {
 
     namespace internal {
 
         /**
-         * @brief Implementation of Wave Function Collapse algorithm in 2D.
+         * @brief Implementation of the Wave Function Collapse algorithm on a topology.
+         * 
+         * The propagators, the entropy heap and backtracking only see cells and the neighbours the topology
+         * walks them through, so the same code runs on 2D grids, voxel boxes, hex maps and general graphs;
+         * the topology is a template parameter so that its neighbour walk is inlined into propagation. See
+         * topology.hpp for what a topology provides.
          * 
+         * @tparam Topology Cells and neighbourhoods, e.g. QuadTopology.
          */
-        class WaveFunctionCollapse2DImpl {  
+        template <typename Topology>
+        class WaveFunctionCollapseImpl {
 
-            friend class WaveFunctionCollapse2D;
-
-            enum class EDirections { Up, Down, Left, Right };
+            /**
+             * @brief Returns the direction pointing back from a neighbour (e.g. Up <-> Down, Left <-> Right).
+             */
+            static constexpr size_t opposite(size_t direction) {
+                return Topology::opposite(direction);
+            }
 
         public:
-            static constexpr size_t NUM_OPTION_DIRECTIONS = 4; // up, down, left, right
+            static constexpr size_t NUM_OPTION_DIRECTIONS = Topology::NUM_DIRECTIONS; // up, down, left, right on 2D grids
 
-            static constexpr size_t BITSET_SIZE = 8; // Example size for options bitset
-            
             using CallbackFn = std::function<void()>;
             
+            /**
+             * @brief Adjacency rules of one tile of the ruleset.
+             */
             struct Tile {
-                std::bitset<BITSET_SIZE> options[NUM_OPTION_DIRECTIONS];
-                size_t entropy;
-                bool collapsed{false};
+                Bitset options[NUM_OPTION_DIRECTIONS];
+                double weight{ 1.0 }; /**< Relative frequency of the tile in the output. */
             };
 
             /**
-             * @brief Custom iterator for OutputGrid.
+             * @brief Ruleset compiled for propagation.
+             * 
+             * For every direction and every tile it holds the set of tiles that may be placed next to it in
+             * that direction, with the rules of both tiles already combined. The options allowed next to a
+             * whole domain are then just the union of the masks of the tiles it still contains.
+             * A compiled ruleset is never modified, so one instance can be shared by many solvers.
              */
-            class iterator {
-            public:
-                using iterator_category = std::forward_iterator_tag;
-                using value_type = size_t;
-                using difference_type = std::ptrdiff_t;
-                using pointer = size_t*;
-                using reference = size_t&;
+            struct CompiledRuleset {
+                static constexpr uint32_t BINARY_VERSION = 2; /**< Version of the format written by save(). */
+
+                size_t numTiles{ 0 };
+                size_t words{ 0 };                      /**< Number of 64-bit words per domain. */
+                Span<const uint64_t> allowed;           /**< Masks laid out as [direction][tile][word]. */
+                Span<const uint16_t> supportCounts;     /**< Initial support counters, supportCounts[tile * NUM_OPTION_DIRECTIONS + direction] */
+                Span<const float> weights;              /**< Weight w of every tile. */
+                Span<const float> weightLogWeights;     /**< w * log(w) of every tile. */
+                float sumWeights{ 0.0f };               /**< Sums over all tiles, the values of a full domain */
+                float sumWeightLogWeights{ 0.0f };
+                bool hasUnsupported{ false };           /**< True if some tile can never have a neighbour in some direction. */
+                internal::LogTable logTable;            /**< Logarithms of the weight sums of partial domains. */
+                std::shared_ptr<const void> storage;    /**< Owner of the memory the views point into: vectors or a mapped file. */
 
                 /**
-                 * @brief Constructs an iterator.
-                 * 
-                 * @param grid Reference to the output grid.
-                 * @param index Index of the iterator.
+                 * @brief Gets the mask of tiles allowed in the given direction of a tile.
                  */
-                iterator(std::vector<size_t>& grid, size_t index) 
-                    : grid(grid), index(index) {}
+                const uint64_t* mask(size_t direction, size_t tile) const {
+                    return &allowed[(direction * numTiles + tile) * words];
+                }
 
-                reference operator*() const {
-                    return grid[index];
+                /**
+                 * @brief Gets a hash of the masks and weights, which tells rulesets apart in solver snapshots.
+                 *
+                 * FNV-1a over 64-bit words rather than bytes, so hashing the masks of large rulesets stays cheap.
+                 */
+                uint64_t fingerprint() const {
+                    uint64_t hash = 0xCBF29CE484222325ull;
+                    const auto mix = [&hash](uint64_t word) {
+                        hash = (hash ^ word) * 0x100000001B3ull;
+                    };
+
+                    mix(numTiles);
+                    mix(NUM_OPTION_DIRECTIONS);
+                    for (const uint64_t word : allowed) {
+                        mix(word);
+                    }
+                    for (const float weight : weights) {
+                        uint32_t bits;
+                        std::memcpy(&bits, &weight, sizeof(bits));
+                        mix(bits);
+                    }
+                    return hash;
                 }
 
-                iterator& operator++() {
-                    ++index;
-                    return *this;
+                /**
+                 * @brief Builds the per-direction masks from a parsed ruleset.
+                 * 
+                 * Option b is allowed in direction d of option a only when a lists b in direction d and
+                 * b lists a in the opposite direction. Rules naming tiles that are not part of the ruleset are
+                 * ignored.
+                 */
+                static std::shared_ptr<const CompiledRuleset> compile(const std::vector<Tile>& ruleset) {
+                    // The support counters are 16 bits wide
+                    assert(ruleset.size() <= std::numeric_limits<uint16_t>::max());
+
+                    struct Storage {
+                        std::vector<uint64_t> allowed;
+                        std::vector<uint16_t> supportCounts;
+                        std::vector<float> weights;
+                        std::vector<float> weightLogWeights;
+                    };
+
+                    auto storage = std::make_shared<Storage>();
+                    auto compiled = std::make_shared<CompiledRuleset>();
+                    compiled->numTiles = ruleset.size();
+                    compiled->words = internal::wordsForTiles(ruleset.size());
+                    storage->allowed.assign(NUM_OPTION_DIRECTIONS * ruleset.size() * compiled->words, 0);
+                    compiled->allowed = storage->allowed;
+
+                    for (size_t direction = 0; direction < NUM_OPTION_DIRECTIONS; ++direction) {
+                        for (size_t a = 0; a < ruleset.size(); ++a) {
+                            const Bitset& options = ruleset[a].options[direction];
+                            uint64_t* mask = &storage->allowed[(direction * ruleset.size() + a) * compiled->words];
+
+                            for (size_t b = 0; b < std::min(options.size(), ruleset.size()); ++b) {
+                                if (options.test(b) && ruleset[b].options[opposite(direction)].test(a)) {
+                                    internal::setBit(mask, b);
+                                }
+                            }
+                        }
+                    }
+
+                    // Tile t in a cell is supported from direction d by every tile that allows t when seen from
+                    // the neighbour lying opposite to d, which by symmetry is the size of its mask towards it
+                    storage->supportCounts.resize(ruleset.size() * NUM_OPTION_DIRECTIONS);
+                    for (size_t tile = 0; tile < ruleset.size(); ++tile) {
+                        for (size_t direction = 0; direction < NUM_OPTION_DIRECTIONS; ++direction) {
+                            storage->supportCounts[tile * NUM_OPTION_DIRECTIONS + direction] = static_cast<uint16_t>(
+                                internal::DomainOps<0>::count(compiled->mask(opposite(direction), tile), compiled->words));
+                            compiled->hasUnsupported |= storage->supportCounts[tile * NUM_OPTION_DIRECTIONS + direction] == 0;
+                        }
+                    }
+
+                    double sumWeights = 0.0;
+                    double sumWeightLogWeights = 0.0;
+                    storage->weights.resize(ruleset.size());
+                    storage->weightLogWeights.resize(ruleset.size());
+                    for (size_t tile = 0; tile < ruleset.size(); ++tile) {
+                        const double weight = ruleset[tile].weight;
+                        storage->weights[tile] = static_cast<float>(weight);
+                        storage->weightLogWeights[tile] = static_cast<float>(weight * std::log(weight));
+                        sumWeights += weight;
+                        sumWeightLogWeights += weight * std::log(weight);
+                    }
+                    compiled->sumWeights = static_cast<float>(sumWeights);
+                    compiled->sumWeightLogWeights = static_cast<float>(sumWeightLogWeights);
+
+                    compiled->supportCounts = storage->supportCounts;
+                    compiled->weights = storage->weights;
+                    compiled->weightLogWeights = storage->weightLogWeights;
+                    compiled->storage = std::move(storage);
+
+                    return compiled;
                 }
 
-                bool operator==(const iterator& other) const {
-                    return index == other.index;
+                /**
+                 * @brief Writes the compiled ruleset in the binary format read by load().
+                 * 
+                 * The file holds a fixed header followed by the masks, support counters, weights and log table
+                 * as raw arrays, each aligned to 64 bytes, in the byte order of the machine that wrote it.
+                 * 
+                 * @param filepath Path of the file to write.
+                 * @param status Receives the outcome, if not null.
+                 * @return True if the file was written.
+                 */
+                bool save(const std::string& filepath, EStatus* status = nullptr) const {
+                    BinaryHeader header = {};
+                    std::memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+                    header.version = BINARY_VERSION;
+                    header.byteOrder = BINARY_BYTE_ORDER;
+                    header.headerSize = sizeof(BinaryHeader);
+                    header.numTiles = numTiles;
+                    header.words = words;
+                    header.directions = NUM_OPTION_DIRECTIONS;
+                    header.logTableSize = internal::LogTable::SIZE;
+                    header.flags = hasUnsupported ? BINARY_FLAG_HAS_UNSUPPORTED : 0;
+                    header.sumWeights = sumWeights;
+                    header.sumWeightLogWeights = sumWeightLogWeights;
+
+                    const BinarySection sections[] = {
+                        { allowed.data(), allowed.size() * sizeof(uint64_t) },
+                        { supportCounts.data(), supportCounts.size() * sizeof(uint16_t) },
+                        { weights.data(), weights.size() * sizeof(float) },
+                        { weightLogWeights.data(), weightLogWeights.size() * sizeof(float) },
+                        { logTable.data(), internal::LogTable::SIZE * sizeof(float) },
+                    };
+
+                    uint64_t offset = alignSection(sizeof(BinaryHeader));
+                    for (size_t section = 0; section < NUM_BINARY_SECTIONS; ++section) {
+                        header.offsets[section] = offset;
+                        offset = alignSection(offset + sections[section].bytes);
+                    }
+                    header.fileSize = offset;
+
+                    std::ofstream outputFile(filepath, std::ios::binary | std::ios::trunc);
+                    if (!outputFile.is_open()) {
+                        internal::log<ELogLevel::Error>("Unable to open file: ", filepath);
+                        internal::setStatus(status, EStatus::FileNotFound);
+                        return false;
+                    }
+
+                    const char padding[BINARY_ALIGNMENT] = {};
+                    outputFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                    uint64_t written = sizeof(header);
+                    for (size_t section = 0; section < NUM_BINARY_SECTIONS; ++section) {
+                        outputFile.write(padding, static_cast<std::streamsize>(header.offsets[section] - written));
+                        outputFile.write(static_cast<const char*>(sections[section].data), static_cast<std::streamsize>(sections[section].bytes));
+                        written = header.offsets[section] + sections[section].bytes;
+                    }
+                    outputFile.write(padding, static_cast<std::streamsize>(header.fileSize - written));
+
+                    if (!outputFile) {
+                        internal::log<ELogLevel::Error>("Failed to write file: ", filepath);
+                        internal::setStatus(status, EStatus::WriteFailed);
+                        return false;
+                    }
+
+                    internal::setStatus(status, EStatus::Ok);
+                    return true;
                 }
 
-                bool operator!=(const iterator& other) const {
-                    return !(*this == other);
+                /**
+                 * @brief Loads a ruleset written by save().
+                 * 
+                 * The file is memory-mapped and used in place: nothing is parsed or copied, and the pages are
+                 * shared with every other process that maps the same file. The mapping lives as long as the
+                 * returned ruleset.
+                 * 
+                 * Before the ruleset is handed out, its sections are checked once: every mask is free of bits
+                 * past the last tile, every weight is finite and positive with a matching w log w, the support
+                 * counters are the sizes of the masks, and the sums and log table agree with what compile()
+                 * would have written. A wrong section would otherwise let an option past the last tile into the
+                 * wave, or NaN entropies into the heap.
+                 * 
+                 * @param filepath Path of the file to load.
+                 * @param status Receives the outcome, if not null.
+                 * @return The ruleset, or nullptr if the file is missing, truncated, corrupt, was written by
+                 * another version or on a machine of another byte order, or is for a topology with another
+                 * number of directions.
+                 */
+                static std::shared_ptr<const CompiledRuleset> load(const std::string& filepath, EStatus* status = nullptr) {
+                    const auto file = internal::MappedFile::open(filepath);
+                    if (!file) {
+                        internal::log<ELogLevel::Error>("Unable to open file: ", filepath);
+                        internal::setStatus(status, EStatus::FileNotFound);
+                        return nullptr;
+                    }
+
+                    BinaryHeader header;
+                    if (file->size() < sizeof(header)) {
+                        internal::log<ELogLevel::Error>("Not a compiled ruleset: ", filepath);
+                        internal::setStatus(status, EStatus::InvalidFormat);
+                        return nullptr;
+                    }
+                    std::memcpy(&header, file->data(), sizeof(header));
+
+                    if (std::memcmp(header.magic, BINARY_MAGIC, sizeof(header.magic)) != 0) {
+                        internal::log<ELogLevel::Error>("Not a compiled ruleset: ", filepath);
+                        internal::setStatus(status, EStatus::InvalidFormat);
+                        return nullptr;
+                    }
+
+                    if (header.version != BINARY_VERSION || header.byteOrder != BINARY_BYTE_ORDER || header.headerSize != sizeof(BinaryHeader)) {
+                        internal::log<ELogLevel::Error>("Unsupported compiled ruleset version or byte order: ", filepath);
+                        internal::setStatus(status, EStatus::InvalidFormat);
+                        return nullptr;
+                    }
+
+                    const bool validSizes = header.numTiles <= std::numeric_limits<uint16_t>::max()
+                        && header.words == internal::wordsForTiles(static_cast<size_t>(header.numTiles))
+                        && header.directions == NUM_OPTION_DIRECTIONS
+                        && header.logTableSize == internal::LogTable::SIZE
+                        && header.fileSize == file->size();
+
+                    const uint64_t sectionBytes[] = {
+                        NUM_OPTION_DIRECTIONS * header.numTiles * header.words * sizeof(uint64_t),
+                        NUM_OPTION_DIRECTIONS * header.numTiles * sizeof(uint16_t),
+                        header.numTiles * sizeof(float),
+                        header.numTiles * sizeof(float),
+                        header.logTableSize * sizeof(float),
+                    };
+
+                    bool validSections = validSizes;
+                    for (size_t section = 0; validSections && section < NUM_BINARY_SECTIONS; ++section) {
+                        validSections = header.offsets[section] % BINARY_ALIGNMENT == 0
+                            && header.offsets[section] >= sizeof(BinaryHeader)
+                            && header.offsets[section] <= header.fileSize
+                            && sectionBytes[section] <= header.fileSize - header.offsets[section];
+                    }
+
+                    if (!validSections) {
+                        internal::log<ELogLevel::Error>("Corrupt compiled ruleset: ", filepath);
+                        internal::setStatus(status, EStatus::InvalidFormat);
+                        return nullptr;
+                    }
+
+                    const unsigned char* data = file->data();
+                    const auto tiles = static_cast<size_t>(header.numTiles);
+
+                    auto compiled = std::make_shared<CompiledRuleset>();
+                    compiled->numTiles = tiles;
+                    compiled->words = static_cast<size_t>(header.words);
+                    compiled->allowed = { reinterpret_cast<const uint64_t*>(data + header.offsets[0]), NUM_OPTION_DIRECTIONS * tiles * compiled->words };
+                    compiled->supportCounts = { reinterpret_cast<const uint16_t*>(data + header.offsets[1]), NUM_OPTION_DIRECTIONS * tiles };
+                    compiled->weights = { reinterpret_cast<const float*>(data + header.offsets[2]), tiles };
+                    compiled->weightLogWeights = { reinterpret_cast<const float*>(data + header.offsets[3]), tiles };
+                    compiled->logTable = internal::LogTable(reinterpret_cast<const float*>(data + header.offsets[4]));
+                    compiled->sumWeights = header.sumWeights;
+                    compiled->sumWeightLogWeights = header.sumWeightLogWeights;
+                    compiled->hasUnsupported = (header.flags & BINARY_FLAG_HAS_UNSUPPORTED) != 0;
+                    compiled->storage = file;
+
+                    if (!compiled->validContents()) {
+                        internal::log<ELogLevel::Error>("Corrupt compiled ruleset: ", filepath);
+                        internal::setStatus(status, EStatus::InvalidFormat);
+                        return nullptr;
+                    }
+
+                    internal::setStatus(status, EStatus::Ok);
+                    return compiled;
                 }
 
             private:
-                std::vector<size_t>& grid;
-                size_t index;
-            };
+                static constexpr double BINARY_FLOAT_TOLERANCE = 1e-4; /**< Relative slack of the stored floats. */
 
-            // Public methods for user interaction
-            WaveFunctionCollapse2DImpl() = default;
-            virtual ~WaveFunctionCollapse2DImpl() = default;
-            WaveFunctionCollapse2DImpl(const WaveFunctionCollapse2DImpl&) = delete;
-            WaveFunctionCollapse2DImpl(WaveFunctionCollapse2DImpl&&) = delete;
-            WaveFunctionCollapse2DImpl& operator=(const WaveFunctionCollapse2DImpl&) = delete;
-            WaveFunctionCollapse2DImpl& operator=(WaveFunctionCollapse2DImpl&&) = delete;
+                static bool closeTo(double value, double expected, double scale) {
+                    // Written so that NaNs fail as well
+                    return std::abs(value - expected) <= BINARY_FLOAT_TOLERANCE * (1.0 + std::abs(scale));
+                }
 
-        public:
-            /**
-            * @brief Enum class for heuristic type.
-            */
-            enum class EHeuristic { Entropy };
+                /**
+                 * @brief Checks the sections of a loaded ruleset against each other, see load().
+                 */
+                bool validContents() const {
+                    for (size_t direction = 0; direction < NUM_OPTION_DIRECTIONS; ++direction) {
+                        for (size_t tile = 0; tile < numTiles; ++tile) {
+                            const uint64_t* tileMask = mask(direction, tile);
+                            for (size_t word = numTiles / 64; word < words; ++word) {
+                                const uint64_t padding = word == numTiles / 64 ? ~uint64_t{ 0 } << (numTiles % 64) : ~uint64_t{ 0 };
+                                if ((tileMask[word] & padding) != 0) {
+                                    return false;
+                                }
+                            }
+                        }
+                    }
 
-            /**
-             * @brief Initializes the Wave Function Collapse algorithm.
-             * 
-             * @param rows Number of rows in the grid.
-             * @param cols Number of columns in the grid.
-             */
-            void initialize(size_t rows, size_t cols) {
-                assert(rows * cols > 0);
+                    bool unsupported = false;
+                    for (size_t tile = 0; tile < numTiles; ++tile) {
+                        for (size_t direction = 0; direction < NUM_OPTION_DIRECTIONS; ++direction) {
+                            const uint16_t count = supportCounts[tile * NUM_OPTION_DIRECTIONS + direction];
+                            if (count != internal::DomainOps<0>::count(mask(opposite(direction), tile), words)) {
+                                return false;
+                            }
+                            unsupported |= count == 0;
+                        }
+                    }
+                    if (unsupported != hasUnsupported) {
+                        return false;
+                    }
+
+                    double sum = 0.0;
+                    double sumLog = 0.0;
+                    double sumAbsLog = 0.0;
+                    for (size_t tile = 0; tile < numTiles; ++tile) {
+                        const double weight = weights[tile];
+                        if (!std::isfinite(weight) || !(weight > 0.0)) {
+                            return false;
+                        }
 
-                this->m_wave.resize(rows * cols);
+                        const double weightLogWeight = weight * std::log(weight);
+                        if (!closeTo(weightLogWeights[tile], weightLogWeight, weightLogWeight)) {
+                            return false;
+                        }
+                        sum += weight;
+                        sumLog += weightLogWeight;
+                        sumAbsLog += std::abs(weightLogWeight);
+                    }
+                    if (!closeTo(sumWeights, sum, sum) || !closeTo(sumWeightLogWeights, sumLog, sumAbsLog)) {
+                        return false;
+                    }
 
-                // Initialize wave grid with maximum entropy
-                for (auto& tile : this->m_wave) {
-                    for (auto& option : tile.options) {
-                        option.set();
+                    // The table is the one every process builds; it is stored so the file can be mapped as it is
+                    const std::vector<float>& defaultTable = internal::LogTable::defaultTable();
+                    for (size_t i = 0; i < internal::LogTable::SIZE; ++i) {
+                        if (!closeTo(logTable.data()[i], defaultTable[i], 0.0)) {
+                            return false;
+                        }
                     }
 
-                    tile.entropy = m_ruleset.size();
-                    tile.collapsed = false;
+                    return true;
                 }
 
-                this->m_output.resize(rows * cols);
-                std::fill(this->m_output.begin(), this->m_output.end(), std::numeric_limits<std::size_t>::max());
+                static constexpr char BINARY_MAGIC[8] = { 'W', 'F', 'C', 'R', 'U', 'L', 'E', '\0' };
+                static constexpr uint32_t BINARY_BYTE_ORDER = 0x01020304;
+                static constexpr uint32_t BINARY_FLAG_HAS_UNSUPPORTED = 1;
+                static constexpr uint64_t BINARY_ALIGNMENT = 64;
+                static constexpr size_t NUM_BINARY_SECTIONS = 5; // allowed, supportCounts, weights, weightLogWeights, logTable
+
+                /**
+                 * @brief Start of a binary compiled ruleset; offsets are counted from the start of the file.
+                 */
+                struct BinaryHeader {
+                    char magic[8];
+                    uint32_t version;
+                    uint32_t byteOrder;  /**< Reads back as another value on a machine of the other byte order. */
+                    uint32_t headerSize;
+                    uint32_t flags;
+                    uint64_t numTiles;
+                    uint64_t words;
+                    uint64_t directions; /**< Rule lists per tile, NUM_OPTION_DIRECTIONS of the topology. */
+                    uint64_t logTableSize;
+                    float sumWeights;
+                    float sumWeightLogWeights;
+                    uint64_t offsets[NUM_BINARY_SECTIONS];
+                    uint64_t fileSize;
+                };
+
+                struct BinarySection {
+                    const void* data;
+                    uint64_t bytes;
+                };
+
+                static constexpr uint64_t alignSection(uint64_t offset) {
+                    return (offset + BINARY_ALIGNMENT - 1) / BINARY_ALIGNMENT * BINARY_ALIGNMENT;
+                }
+            };
 
-                this->m_gridWidth = cols;
-                this->m_gridHeight = rows;
+            /**
+             * @brief Tiles of a loaded ruleset together with their compiled form.
+             * 
+             * A ruleset is immutable once loaded and is handed around as a shared_ptr, so it is parsed and
+             * compiled once and can then be attached to any number of solvers without being copied.
+             */
+            class Ruleset {
+            public:
+                /**
+                 * @brief Compiles a ruleset from its tiles.
+                 */
+                static std::shared_ptr<const Ruleset> create(std::vector<Tile> tiles) {
+                    std::shared_ptr<Ruleset> ruleset(new Ruleset());
+                    ruleset->m_compiled = CompiledRuleset::compile(tiles);
+                    ruleset->m_tiles = std::move(tiles);
+                    return ruleset;
+                }
 
-                this->m_initialized = true;
-            }
+                /**
+                 * @brief Loads a ruleset in the text format, or in JSON if the path ends in ".json".
+                 * 
+                 * @param filepath Path of the ruleset file.
+                 * @param status Receives the outcome, if not null.
+                 * @return The ruleset, or nullptr if the file could not be read.
+                 */
+                static std::shared_ptr<const Ruleset> load(const std::string& filepath, EStatus* status = nullptr) {
+                    if (filepath.size() >= 5 && filepath.compare(filepath.size() - 5, 5, ".json") == 0) {
+                        return loadJson(filepath, status);
+                    }
 
-            std::vector<Tile> parseRulesFromFile(const std::string& filepath) {
-                std::ifstream inputFile(filepath);
-                if (!inputFile.is_open()) {
-                    std::cerr << "Error: Unable to open file.\n";
-                    return {};
+                    return loadText(filepath, status);
                 }
 
-                std::string line;
-                while (std::getline(inputFile, line)) {
-                    std::istringstream iss(line);
-                    std::string key, value;
-                    if (line.find("[TILE_") != std::string::npos) {
-                        // Extract tile ID from the line
-                        Tile currentTile;
-                        while (std::getline(inputFile, line)) {
-                            if (line.empty() || line[0] == '[') {
-                                // If the line is empty or starts with '[', it's the beginning of a new tile
-                                break;
-                            }
+                /**
+                 * @brief Loads a ruleset in the INI-like text format, one [TILE_n] section per tile.
+                 * 
+                 * Lines that cannot be parsed are skipped with a warning.
+                 * 
+                 * @param filepath Path of the ruleset file.
+                 * @param status Receives the outcome, if not null.
+                 * @return The ruleset, or nullptr if the file could not be opened.
+                 */
+                static std::shared_ptr<const Ruleset> loadText(const std::string& filepath, EStatus* status = nullptr) {
+                    std::ifstream inputFile(filepath);
+                    if (!inputFile.is_open()) {
+                        internal::log<ELogLevel::Error>("Unable to open file: ", filepath);
+                        internal::setStatus(status, EStatus::FileNotFound);
+                        return nullptr;
+                    }
 
-                            std::istringstream iss(line);
-                            if (!(std::getline(iss, key, '=') && std::getline(iss, value))) {
-                                std::cerr << "Error: Failed to parse line: " << line << std::endl;
-                                continue; // Skip to the next line
-                            }
+                    std::vector<Tile> tiles;
+                    std::string line;
+                    while (std::getline(inputFile, line)) {
+                        std::istringstream iss(line);
+                        std::string key, value;
+                        if (line.find("[TILE_") != std::string::npos) {
+                            // Extract tile ID from the line
+                            Tile currentTile;
+                            while (std::getline(inputFile, line)) {
+                                if (line.empty() || line[0] == '[') {
+                                    // If the line is empty or starts with '[', it's the beginning of a new tile
+                                    break;
+                                }
+
+                                std::istringstream iss(line);
+                                if (!(std::getline(iss, key, '=') && std::getline(iss, value))) {
+                                    internal::log<ELogLevel::Warning>("Skipping unparsable line: ", line);
+                                    continue; // Skip to the next line
+                                }
+
+                                if (key == "weight") {
+                                    std::istringstream wss(value);
+                                    double weight;
+                                    if (!(wss >> weight) || !(weight > 0.0)) {
+                                        internal::log<ELogLevel::Warning>("Skipping invalid weight: ", line);
+                                        continue;
+                                    }
 
-                            // Parse option and update currentTile
-                            auto parseOption = [&currentTile](const std::string& key, const std::string& value) {
-                                size_t index = 0;
-                                if(key == "up") index = 0;
-                                else if(key == "down") index = 1;
-                                else if(key == "left") index = 2;
-                                else if(key == "right") index = 3;
+                                    currentTile.weight = weight;
+                                    continue;
+                                }
+
+                                // Parse option and update currentTile
+                                const size_t index = Topology::findDirection(key);
+                                if (index == NUM_OPTION_DIRECTIONS) {
+                                    internal::log<ELogLevel::Warning>("Skipping unknown direction: ", line);
+                                    continue;
+                                }
 
                                 std::istringstream vss(value);
                                 size_t optionTileID;
                                 while (vss >> optionTileID) {
                                     currentTile.options[index].set(optionTileID, true);
                                 }
-                            };
-                                                    
-                            parseOption(key, value);
-                            
+                            }
+
+                            tiles.push_back(currentTile);
+                        }
+                    }
+
+                    inputFile.close();
+
+                    internal::setStatus(status, EStatus::Ok);
+                    return create(std::move(tiles));
+                }
+
+                /**
+                 * @brief Loads a ruleset in the JSON format.
+                 * 
+                 * The document holds a "tiles" array; each tile has an "id", an "options" object listing the
+                 * tiles allowed in every direction of the topology ("up", "down", "left" and "right" on a 2D
+                 * grid), and an optional positive "weight":
+                 * 
+                 * @code
+                 * { "tiles": [ { "id": 0, "options": { "up": [0, 1], "down": [0], "left": [1], "right": [0, 1] }, "weight": 2.0 } ] }
+                 * @endcode
+                 * 
+                 * Tiles may be listed in any order, but their ids must be 0 to N-1.
+                 * 
+                 * @param filepath Path of the JSON file.
+                 * @param status Receives the outcome, if not null.
+                 * @return The ruleset, or nullptr if the file could not be read or is not a valid ruleset.
+                 */
+                static std::shared_ptr<const Ruleset> loadJson(const std::string& filepath, EStatus* status = nullptr) {
+                    std::ifstream inputFile(filepath, std::ios::binary);
+                    if (!inputFile.is_open()) {
+                        internal::log<ELogLevel::Error>("Unable to open file: ", filepath);
+                        internal::setStatus(status, EStatus::FileNotFound);
+                        return nullptr;
+                    }
+
+                    const std::string text((std::istreambuf_iterator<char>(inputFile)), std::istreambuf_iterator<char>());
+
+                    internal::JsonValue document;
+                    std::string error;
+                    if (!internal::JsonValue::parse(text, document, error)) {
+                        internal::log<ELogLevel::Error>("Invalid JSON in ", filepath, ": ", error);
+                        internal::setStatus(status, EStatus::InvalidFormat);
+                        return nullptr;
+                    }
+
+                    const internal::JsonValue* entries = document.find("tiles");
+                    if (!entries || !entries->isArray()) {
+                        internal::log<ELogLevel::Error>("Missing \"tiles\" array in ", filepath);
+                        internal::setStatus(status, EStatus::InvalidFormat);
+                        return nullptr;
+                    }
+
+                    const auto isIndex = [](const internal::JsonValue& value, size_t bound) {
+                        return value.isNumber() && value.number() >= 0.0 && value.number() < static_cast<double>(bound)
+                            && value.number() == std::floor(value.number());
+                    };
+
+                    std::vector<Tile> tiles(entries->array().size());
+                    std::vector<bool> seen(tiles.size(), false);
+                    for (size_t i = 0; i < entries->array().size(); ++i) {
+                        const internal::JsonValue& entry = entries->array()[i];
+                        const internal::JsonValue* id = entry.find("id");
+                        if (!id || !isIndex(*id, tiles.size()) || seen[static_cast<size_t>(id->number())]) {
+                            internal::log<ELogLevel::Error>("Tile ", i, " needs a unique id below ", tiles.size());
+                            internal::setStatus(status, EStatus::InvalidFormat);
+                            return nullptr;
+                        }
+
+                        const size_t tileID = static_cast<size_t>(id->number());
+                        seen[tileID] = true;
+                        Tile& tile = tiles[tileID];
+
+                        if (const internal::JsonValue* weight = entry.find("weight")) {
+                            if (!weight->isNumber() || !(weight->number() > 0.0)) {
+                                internal::log<ELogLevel::Error>("Invalid weight for tile ", tileID);
+                                internal::setStatus(status, EStatus::InvalidFormat);
+                                return nullptr;
+                            }
+                            tile.weight = weight->number();
                         }
 
-                        this->m_ruleset.push_back(currentTile);
+                        const internal::JsonValue* options = entry.find("options");
+                        if (!options || !options->isObject()) {
+                            internal::log<ELogLevel::Error>("Missing \"options\" for tile ", tileID);
+                            internal::setStatus(status, EStatus::InvalidFormat);
+                            return nullptr;
+                        }
+
+                        for (size_t direction = 0; direction < NUM_OPTION_DIRECTIONS; ++direction) {
+                            const std::string key = Topology::directionName(direction);
+                            const internal::JsonValue* list = options->find(key);
+                            if (!list) {
+                                continue;
+                            }
+
+                            if (!list->isArray()) {
+                                internal::log<ELogLevel::Error>("\"", key, "\" of tile ", tileID, " is not an array");
+                                internal::setStatus(status, EStatus::InvalidFormat);
+                                return nullptr;
+                            }
+
+                            for (const internal::JsonValue& option : list->array()) {
+                                // Like the text format, options naming missing tiles are left to compile() to drop
+                                if (!isIndex(option, std::numeric_limits<uint16_t>::max())) {
+                                    internal::log<ELogLevel::Error>("Invalid option for tile ", tileID);
+                                    internal::setStatus(status, EStatus::InvalidFormat);
+                                    return nullptr;
+                                }
+                                tile.options[direction].set(static_cast<size_t>(option.number()), true);
+                            }
+                        }
                     }
+
+                    internal::setStatus(status, EStatus::Ok);
+                    return create(std::move(tiles));
                 }
 
-                inputFile.close();
+                const std::vector<Tile>& tiles() const {
+                    return this->m_tiles;
+                }
 
-                return this->m_ruleset;
-            }
+                const std::shared_ptr<const CompiledRuleset>& compiled() const {
+                    return this->m_compiled;
+                }
 
-            /**
-             * @brief Runs the Wave Function Collapse algorithm.
-             */
-            void run() {
-                if (!this->m_initialized) {
-                    std::cerr << "Error: WaveFunctionCollapse2D not initialized.\n";
-                    return;
+                size_t size() const {
+                    return this->m_tiles.size();
+                }
+
+                bool empty() const {
+                    return this->m_tiles.empty();
+                }
+
+                const Tile& operator[](size_t tile) const {
+                    return this->m_tiles[tile];
                 }
 
-                // Algorithm logic here...
+                typename std::vector<Tile>::const_iterator begin() const {
+                    return this->m_tiles.begin();
+                }
 
-                // Choose a random tile index
-                size_t randomTileIndex = random(0, m_wave.size() - 1);
+                typename std::vector<Tile>::const_iterator end() const {
+                    return this->m_tiles.end();
+                }
 
-                // Choose a random direction index
-                size_t randomDirectionIndex = random(0, NUM_OPTION_DIRECTIONS - 1);
+            private:
+                Ruleset() = default;
 
-                // Choose a random option index
-                size_t randomOptionIndex = random(0, BITSET_SIZE - 1);
+                std::vector<Tile> m_tiles;
+                std::shared_ptr<const CompiledRuleset> m_compiled;
+            };
 
-                // Set the random option for the random direction of the random tile
-                m_wave[randomTileIndex].options[randomDirectionIndex].set(randomOptionIndex);
+            // Public methods for user interaction
+            WaveFunctionCollapseImpl() = default;
+            virtual ~WaveFunctionCollapseImpl() = default;
 
-                // Print the chosen random option
-                std::cout << "Chosen random option for Tile " << randomTileIndex
-                        << ", Direction " << randomDirectionIndex
-                        << ": " << randomOptionIndex << std::endl;   
+        public:
+            /**
+             * @brief Iterators over the cells of the output grid, in row-major order.
+             */
+            using iterator = TileIndex*;
+            using const_iterator = const TileIndex*;
 
-                m_output[randomTileIndex] = randomOptionIndex;
+            /**
+            * @brief Enum class for heuristic type.
+            */
+            enum class EHeuristic { Entropy };
 
-                collapse(randomTileIndex);
-            }
+            static constexpr size_t NOT_FOUND = std::numeric_limits<size_t>::max();
 
             /**
-             * @brief Collapses the wave function.
+            * @brief Enum class for propagation strategy.
+            * 
+            * ArcConsistency revises whole neighbour domains against the compiled masks (AC-3).
+            * SupportCounting keeps, per cell, tile and direction, the number of neighbouring options that
+            * still support the tile, and bans a tile as soon as one of its counters drops to zero. It costs
+            * more memory but removing a tile is O(1) amortized, which pays off for large tilesets.
+            */
+            enum class EPropagation { ArcConsistency, SupportCounting };
+
+            using EBoundary = wfc2d::EBoundary;
+
+            /**
+             * @brief Selects the propagation strategy.
              * 
-             * This method collapses the wave function in the Wave Function Collapse algorithm.
+             * If the solver is initialized, its wave is reseeded.
              * 
-             * @return True if the wave function collapse is successful, false otherwise.
+             * @param propagation Propagation strategy to use.
              */
-            bool collapse(size_t index) { 
-                if (m_wave[index].collapsed) {
-                    return true;
+            void setPropagation(EPropagation propagation) {
+                this->m_propagation = propagation;
+
+                if (this->m_initialized) {
+                    this->resetWave();
                 }
+            }
 
-                m_wave[index].collapsed = true;
-                
-                return true; 
+            EPropagation getPropagation() const {
+                return this->m_propagation;
             }
 
             /**
-             * @brief Applies the superposition principle.
+             * @brief Spreads AC-3 propagation over several threads once enough tiles are dirty.
              * 
-             * This method applies the superposition principle in the Wave Function Collapse algorithm.
+             * The cells are split into bands of consecutive indices, rows on a 2D grid, one per thread. Every
+             * thread works through the dirty tiles of its band and narrows the neighbouring domains with atomic
+             * fetch-and; tiles of another band that shrink are handed to their owner through a lock-free
+             * queue. Arc consistency has a unique fixpoint, so the domains end up exactly as with the
+             * sequential propagator. The option counts, entropy sums and heap keys of the changed tiles are
+             * rebuilt afterwards, the sums from scratch, so entropies may differ from the sequential ones in
+             * the last bits.
+             * 
+             * Only used with ArcConsistency and without backtracking. Small worklists, like the ones left by
+             * most single collapses, are always propagated sequentially.
+             * 
+             * The threads are started here and sleep between propagations; the worklists and inboxes of the
+             * bands are sized by initialize(). Both are kept until the thread count changes.
+             * 
+             * @param numThreads Number of threads; 0 or 1 propagates sequentially.
+             * @param minDirtyTiles Smallest worklist that is propagated in parallel.
              */
-            void propagate() { 
-                for (size_t index = 0; index < m_wave.size(); ++index) {
-                    size_t row = index / this->m_gridWidth;
-                    size_t col = index % this->m_gridWidth;
+            void setPropagationThreads(size_t numThreads, size_t minDirtyTiles = DEFAULT_PARALLEL_MIN_DIRTY_TILES) {
+                this->m_propagationThreads = numThreads;
+                this->m_parallelMinDirtyTiles = std::max<size_t>(1, minDirtyTiles);
+                this->preparePropagationThreads();
+            }
 
-                    auto neighbors = getNeighboringIndices(index);
-                    for (auto neighborIndex : neighbors) {
-                        // Propagate logic here...
-                    }
-                }
+            size_t getPropagationThreads() const {
+                return this->m_propagationThreads;
+            }
+
+            EBoundary getBoundary() const {
+                return this->m_topology.boundary();
+            }
+
+            const Topology& getTopology() const {
+                return this->m_topology;
             }
 
             /**
-             * @brief Checks if the Wave Function Collapse algorithm is initialized.
+             * @brief Initializes the Wave Function Collapse algorithm.
              * 
-             * @return True if initialized, false otherwise.
+             * @param topology Cells of the output and their neighbours.
              */
-
-            bool isInitialized() const {
-                return this->m_initialized;
+            void initialize(Topology topology) {
+                this->m_topology = std::move(topology);
+                this->initializeCells();
             }
 
             /**
-             * @brief Gets the size of the output grid.
+             * @brief Initializes the solver on a topology built from its sizes.
              * 
-             * @return Size of the output grid.
+             * Takes the arguments of the constructor of the topology: rows, cols and an optional EBoundary for
+             * 2D grids and hex maps, layers, rows, cols and an optional EBoundary for boxes. The topology is
+             * reshaped in place, so like the wave it does not allocate again for a size solved before.
              */
-            size_t size() const {
-                return this->m_output.size();
+            template <typename... Sizes, typename = std::enable_if_t<std::is_constructible_v<Topology, size_t, Sizes...>>>
+            void initialize(size_t size, Sizes... sizes) {
+                this->m_topology.assign(size, sizes...);
+                this->initializeCells();
             }
 
             /**
-             * @brief Accesses the pattern at the specified index in the output grid using bounds checking.
+             * @brief Loads a ruleset from a file and attaches it, replacing the current one.
              * 
-             * @param index Index of the pattern to access.
-             * @return Reference to the pattern at the specified index.
-             * @throws std::out_of_range if index is out of range.
+             * Reads the text format, or JSON if the path ends in ".json". The returned tiles are a view of the
+             * attached ruleset and stay valid until another one is attached; use getRuleset() to share it.
+             * 
+             * @param filepath Path of the ruleset file.
+             * @return The tiles of the loaded ruleset, or an empty ruleset if the file could not be read, in
+             * which case the current ruleset is kept and getStatus() tells why.
              */
-            const size_t& at(size_t index) const {
-                return this->m_output.at(index);
+            const Ruleset& parseRulesFromFile(const std::string& filepath) {
+                return this->attachLoadedRuleset(Ruleset::load(filepath, &this->m_status));
             }
 
             /**
-             * @brief Accesses the pattern at the specified index in the output grid without bounds checking.
+             * @brief Loads a ruleset in the JSON format and attaches it, see Ruleset::loadJson().
+             */
+            const Ruleset& parseRulesFromJson(const std::string& filepath) {
+                return this->attachLoadedRuleset(Ruleset::loadJson(filepath, &this->m_status));
+            }
+
+            /**
+             * @brief Gets the attached ruleset.
              * 
-             * @param index Index of the pattern to access.
-             * @return Reference to the pattern at the specified index.
-             * @warning No bounds checking is performed. Accessing an out-of-range index leads to undefined behavior.
+             * @return Shared, read-only ruleset, or nullptr if none is attached or only a compiled one was.
              */
-            const size_t& operator[](size_t index) const {
-                return this->m_output[index];
+            std::shared_ptr<const Ruleset> getRuleset() const {
+                return this->m_ruleset;
             }
 
             /**
-             * @brief Returns an iterator to the beginning of the output grid.
+             * @brief Attaches a loaded ruleset, e.g. one shared with other solvers.
              * 
-             * @return Iterator to the beginning of the output grid.
+             * Nothing is copied or compiled: the solver keeps a reference to the ruleset and propagates with
+             * its compiled form. If the solver is initialized, its wave is reseeded from the new ruleset.
+             * 
+             * @param ruleset Ruleset to use.
              */
-            iterator begin() {
-                return iterator(this->m_output, 0);
+            void setRuleset(std::shared_ptr<const Ruleset> ruleset) {
+                this->setCompiledRuleset(ruleset ? ruleset->compiled() : nullptr);
+                this->m_ruleset = std::move(ruleset);
             }
 
             /**
-             * @brief Returns an iterator to the end of the output grid.
+             * @brief Gets the compiled form of the loaded ruleset.
              * 
-             * @return Iterator to the end of the output grid.
+             * @return Shared, read-only compiled ruleset, or nullptr if no ruleset has been loaded yet.
              */
-            iterator end() {
-                return iterator(this->m_output, this->m_output.size());
+            std::shared_ptr<const CompiledRuleset> getCompiledRuleset() const {
+                return this->m_compiledRuleset;
             }
 
-            void print() const {
-                for (size_t row = 0; row < m_gridHeight; ++row) {
-                    for (size_t col = 0; col < m_gridWidth; ++col) {
-                        size_t index = row * m_gridWidth + col;
-                        std::cout << m_output[index] << " ";
-                    }
-                    std::cout << std::endl;
+            /**
+             * @brief Attaches an already compiled ruleset, e.g. one shared with another solver.
+             * 
+             * The ruleset is only read, so the same instance can be attached to any number of solvers.
+             * If the solver is initialized, its wave is reseeded from the new ruleset.
+             * 
+             * @param compiledRuleset Compiled ruleset to use for propagation.
+             */
+            void setCompiledRuleset(std::shared_ptr<const CompiledRuleset> compiledRuleset) {
+                this->m_compiledRuleset = std::move(compiledRuleset);
+
+                // The tiles only describe the compiled ruleset they came with
+                if (this->m_ruleset && this->m_ruleset->compiled() != this->m_compiledRuleset) {
+                    this->m_ruleset.reset();
+                }
+
+                // The wave was seeded from the previous ruleset, so start over from the new one
+                if (this->m_initialized) {
+                    this->resetWave();
                 }
             }
 
             /**
-             * @brief Gets the neighboring indices of a given cell.
-             * 
-             * This method calculates the neighboring indices of a cell in the grid based on its current index.
+             * @brief Attaches a ruleset saved with CompiledRuleset::save(), mapped in place.
              * 
-             * @param currentIndex The index of the current cell.
+             * @param filepath Path of the binary compiled ruleset.
+             * @return True if the file was loaded; otherwise the current ruleset is kept and getStatus() tells why.
+             */
+            bool loadCompiledRuleset(const std::string& filepath) {
+                auto compiledRuleset = CompiledRuleset::load(filepath, &this->m_status);
+                if (!compiledRuleset) {
+                    return false;
+                }
+
+                this->setCompiledRuleset(std::move(compiledRuleset));
+                return true;
+            }
+
+            /**
+             * @brief Runs the Wave Function Collapse algorithm.
+             * 
+             * Loops observe -> collapse -> propagate until every tile is collapsed. The first attempt continues
+             * from the current wave, so tiles collapsed beforehand are kept. When propagation runs into an
+             * empty domain the attempt is abandoned at once and the wave is reseeded in place, without
+             * reallocating, for the next one, up to the restart limit and the time budget.
+             * With backtracking enabled, a contradiction first rolls back to the last decision and bans the
+             * option chosen there; the attempt is only abandoned once no decision is left or the backtrack
+             * limit is reached.
+             * 
+             * @return True if a complete output was produced, false otherwise; getStatus() tells why.
+             */
+            bool run() {
+                if (!this->m_initialized) {
+                    internal::log<ELogLevel::Error>("WaveFunctionCollapse2D not initialized.");
+                    this->m_status = EStatus::NotInitialized;
+                    return false;
+                }
+
+                if (this->numTiles() == 0) {
+                    internal::log<ELogLevel::Error>("No ruleset loaded.");
+                    this->m_status = EStatus::NoRuleset;
+                    return false;
+                }
+
+                if (this->numTiles() > MAX_OUTPUT_TILES) {
+                    internal::log<ELogLevel::Error>("The output holds at most ", MAX_OUTPUT_TILES, " tiles, see WFC_TILE_INDEX_BITS.");
+                    this->m_status = EStatus::TooManyTiles;
+                    return false;
+                }
+
+                const auto start = std::chrono::steady_clock::now();
+                const auto outOfTime = [this, start]() {
+                    return this->m_timeBudget.count() > 0 && std::chrono::steady_clock::now() - start >= this->m_timeBudget;
+                };
+
+                this->m_stats = {};
+                size_t totalCollapses = 0;
+
+                for (size_t attempt = 0; attempt <= this->m_maxRestarts; ++attempt) {
+                    if (attempt > 0) {
+                        internal::log<ELogLevel::Debug>("Restarting after a contradiction, attempt ", attempt + 1, ".");
+                        this->resetWave();
+                        countStat(this->m_stats.restarts);
+                    }
+
+                    this->m_attempts = attempt + 1;
+
+                    this->m_backtracks = 0;
+
+                    bool consistent = timed(this->m_stats.propagateNanoseconds, [this] { return propagate(); });
+                    for (size_t collapses = 0; ; ++collapses) {
+                        if (!consistent) {
+                            countStat(this->m_stats.contradictions);
+                            if (stopRequested() || !timed(this->m_stats.propagateNanoseconds, [this] { return backtrack(); })) {
+                                break;
+                            }
+                        }
+
+                        // Reading the clock on every collapse would show up in small maps
+                        if (collapses % TIME_CHECK_INTERVAL == 0 && outOfTime()) {
+                            internal::log<ELogLevel::Warning>("Time budget exhausted after ", this->m_attempts, " attempts.");
+                            this->m_status = EStatus::TimeBudgetExhausted;
+                            return false;
+                        }
+
+                        // Choose the tile with the lowest entropy
+                        const size_t index = timed(this->m_stats.observeNanoseconds, [this] { return observe(); });
+                        if (index == NOT_FOUND) {
+                            internal::log<ELogLevel::Debug>("Solved in ", this->m_attempts, " attempts.");
+                            this->m_status = EStatus::Ok;
+                            return true;
+                        }
+
+                        const bool collapsed = timed(this->m_stats.outputNanoseconds, [this, index] {
+                            const size_t option = chooseOption(index);
+                            if (m_backtracking) {
+                                m_decisions.push_back({ m_trail.size(), index, option });
+                            }
+                            internal::log<ELogLevel::Trace>("Collapsing tile ", index, " to option ", option, ".");
+                            return collapse(index, option);
+                        });
+                        countStat(this->m_stats.collapses);
+
+                        consistent = collapsed && timed(this->m_stats.propagateNanoseconds, [this] { return propagate(); });
+
+                        if (this->m_progressInterval > 0 && ++totalCollapses % this->m_progressInterval == 0) {
+                            this->m_progressCallback();
+                        }
+                    }
+
+                    // A cancelled solver stays quiet, someone else already has a result
+                    if (stopRequested()) {
+                        this->m_status = EStatus::Cancelled;
+                        return false;
+                    }
+
+                    if (outOfTime()) {
+                        break;
+                    }
+                }
+
+                if (outOfTime()) {
+                    internal::log<ELogLevel::Warning>("Time budget exhausted after ", this->m_attempts, " attempts.");
+                    this->m_status = EStatus::TimeBudgetExhausted;
+                    return false;
+                }
+
+                internal::log<ELogLevel::Warning>("Contradiction in every attempt.");
+                this->m_status = EStatus::Contradiction;
+                return false;
+            }
+
+            /**
+             * @brief Runs several copies of the solver with different seeds and keeps the first solution.
+             * 
+             * Each copy continues from the current wave on its own thread, with its own wave buffers, the
+             * shared compiled ruleset and its own stream of draws. As soon as one of them succeeds the others
+             * are cancelled through a shared stop flag, which bounds the latency of rulesets that contradict
+             * often. On success the winning solver replaces this one.
+             * 
+             * @param numSolvers Number of solvers; 0 uses one per hardware thread.
+             * @return True if a solver found a solution, false otherwise.
+             * @note A flag given to setStopFlag() is not forwarded to the copies. The progress callback is only
+             * called by the copy running on the calling thread, and the copies propagate sequentially.
+             */
+            bool solveParallel(size_t numSolvers) {
+                if (!this->m_initialized) {
+                    internal::log<ELogLevel::Error>("WaveFunctionCollapse2D not initialized.");
+                    this->m_status = EStatus::NotInitialized;
+                    return false;
+                }
+
+                if (numSolvers == 0) {
+                    numSolvers = std::max<size_t>(1, std::thread::hardware_concurrency());
+                }
+
+                if (numSolvers == 1) {
+                    return run();
+                }
+
+                const uint64_t seed = this->m_random.next();
+                std::atomic<bool> stop{ false };
+                std::atomic<size_t> winner{ NOT_FOUND };
+
+                std::vector<std::unique_ptr<WaveFunctionCollapseImpl>> solvers(numSolvers);
+                for (size_t i = 0; i < numSolvers; ++i) {
+                    solvers[i].reset(new WaveFunctionCollapseImpl(*this));
+                    solvers[i]->m_random = Random::forStream(seed, i);
+                    solvers[i]->m_stopFlag = &stop;
+
+                    // The copies already use a thread each, and only the one on this thread reports progress
+                    solvers[i]->m_propagationThreads = 1;
+                    if (i > 0) {
+                        solvers[i]->m_progressCallback = nullptr;
+                        solvers[i]->m_progressInterval = 0;
+                    }
+                }
+
+                const auto solve = [&solvers, &stop, &winner](size_t i) {
+                    if (!solvers[i]->run()) {
+                        return;
+                    }
+
+                    size_t expected = NOT_FOUND;
+                    if (winner.compare_exchange_strong(expected, i)) {
+                        stop.store(true, std::memory_order_relaxed);
+                    }
+                };
+
+                std::vector<std::thread> threads;
+                threads.reserve(numSolvers - 1);
+                for (size_t i = 1; i < numSolvers; ++i) {
+                    threads.emplace_back(solve, i);
+                }
+                solve(0);
+
+                for (auto& thread : threads) {
+                    thread.join();
+                }
+
+                if (winner.load() == NOT_FOUND) {
+                    internal::log<ELogLevel::Warning>("No solver found a solution.");
+                    this->m_status = solvers[0]->m_status;
+                    return false;
+                }
+
+                const std::atomic<bool>* stopFlag = this->m_stopFlag;
+                const size_t propagationThreads = this->m_propagationThreads;
+                CallbackFn progressCallback = std::move(this->m_progressCallback);
+                const size_t progressInterval = this->m_progressInterval;
+
+                *this = std::move(*solvers[winner.load()]);
+
+                this->m_stopFlag = stopFlag;
+                this->m_propagationThreads = propagationThreads;
+                this->m_progressCallback = std::move(progressCallback);
+                this->m_progressInterval = progressInterval;
+                return true;
+            }
+
+            /**
+             * @brief Sets a flag that cancels run() and propagate() once it becomes true.
+             * 
+             * The flag is polled with a relaxed load on every collapse and every propagated tile, so it can be
+             * raised from any thread. A cancelled run() returns false.
+             * 
+             * @param stopFlag Flag to poll, or nullptr to never stop; it must outlive the runs it cancels.
+             */
+            void setStopFlag(const std::atomic<bool>* stopFlag) {
+                this->m_stopFlag = stopFlag;
+            }
+
+            bool stopRequested() const {
+                return this->m_stopFlag && this->m_stopFlag->load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Reseeds the wave in place, discarding every collapse.
+             */
+            void reset() {
+                if (this->m_initialized) {
+                    this->resetWave();
+                }
+            }
+
+            static constexpr uint32_t SNAPSHOT_VERSION = 1; /**< Version of the format written by snapshot(). */
+
+            /**
+             * @brief Writes the complete state of the solver into a buffer, to be restored with restore().
+             *
+             * The snapshot holds everything run() continues from: the wave with its weight sums and support
+             * counters, the entropy heap in its exact layout, the output, the generator, the trail and
+             * decisions of backtracking, pending propagation work, the pins and the propagation and
+             * backtracking modes. The ruleset and the topology are not part of it and are only checked on
+             * restore. Like a compiled ruleset, it is a fixed header followed by raw arrays aligned to 64 bytes
+             * in the byte order of the machine; it is built with one copy per array into the buffer, whose
+             * capacity is reused, so a snapshot can be taken from the progress callback of a running solver.
+             *
+             * @param buffer Receives the snapshot.
+             * @param status Receives the outcome, if not null.
+             * @return True if the solver is initialized and has a ruleset.
+             */
+            bool snapshot(std::vector<unsigned char>& buffer, EStatus* status = nullptr) const {
+                if (!this->m_initialized) {
+                    internal::log<ELogLevel::Error>("WaveFunctionCollapse2D not initialized.");
+                    internal::setStatus(status, EStatus::NotInitialized);
+                    return false;
+                }
+
+                if (this->numTiles() == 0) {
+                    internal::log<ELogLevel::Error>("No ruleset loaded.");
+                    internal::setStatus(status, EStatus::NoRuleset);
+                    return false;
+                }
+
+                SnapshotHeader header = {};
+                std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+                header.version = SNAPSHOT_VERSION;
+                header.byteOrder = SNAPSHOT_BYTE_ORDER;
+                header.headerSize = sizeof(SnapshotHeader);
+                header.flags = (this->m_propagation == EPropagation::SupportCounting ? SNAPSHOT_FLAG_SUPPORT_COUNTING : 0)
+                    | (this->m_backtracking ? SNAPSHOT_FLAG_BACKTRACKING : 0)
+                    | (this->m_contradiction ? SNAPSHOT_FLAG_CONTRADICTION : 0);
+                header.cells = this->m_output.size();
+                header.numTiles = this->numTiles();
+                header.words = this->m_words;
+                header.directions = NUM_OPTION_DIRECTIONS;
+                header.tileIndexBytes = sizeof(TileIndex);
+                header.rulesetFingerprint = this->m_compiledRuleset->fingerprint();
+                std::memcpy(header.random, this->m_random.state(), sizeof(header.random));
+                header.seed = this->m_seed;
+                header.attempts = this->m_attempts;
+                header.backtracks = this->m_backtracks;
+                header.invalidRegion[0] = this->m_invalidRegion.top;
+                header.invalidRegion[1] = this->m_invalidRegion.left;
+                header.invalidRegion[2] = this->m_invalidRegion.bottom;
+                header.invalidRegion[3] = this->m_invalidRegion.right;
+
+                const auto sections = this->snapshotSections();
+                uint64_t offset = alignSnapshot(sizeof(SnapshotHeader));
+                for (size_t section = 0; section < NUM_SNAPSHOT_SECTIONS; ++section) {
+                    header.counts[section] = sections[section].count;
+                    header.offsets[section] = offset;
+                    offset = alignSnapshot(offset + sections[section].count * sections[section].elementSize);
+                }
+                header.fileSize = offset;
+
+                // Zero the padding too, so that equal states give equal bytes
+                buffer.assign(static_cast<size_t>(header.fileSize), 0);
+                std::memcpy(buffer.data(), &header, sizeof(header));
+                for (size_t section = 0; section < NUM_SNAPSHOT_SECTIONS; ++section) {
+                    if (sections[section].count > 0) {
+                        std::memcpy(buffer.data() + header.offsets[section], sections[section].data, static_cast<size_t>(sections[section].count * sections[section].elementSize));
+                    }
+                }
+
+                internal::setStatus(status, EStatus::Ok);
+                return true;
+            }
+
+            /**
+             * @brief Writes a snapshot to a file with a single write, see snapshot() and loadSnapshot().
+             *
+             * @param filepath Path of the file to write.
+             * @param status Receives the outcome, if not null.
+             * @return True if the file was written.
+             */
+            bool saveSnapshot(const std::string& filepath, EStatus* status = nullptr) const {
+                std::vector<unsigned char> buffer;
+                if (!this->snapshot(buffer, status)) {
+                    return false;
+                }
+
+                std::ofstream outputFile(filepath, std::ios::binary | std::ios::trunc);
+                if (!outputFile.is_open()) {
+                    internal::log<ELogLevel::Error>("Unable to open file: ", filepath);
+                    internal::setStatus(status, EStatus::FileNotFound);
+                    return false;
+                }
+
+                outputFile.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+                outputFile.flush();
+                if (!outputFile) {
+                    internal::log<ELogLevel::Error>("Failed to write file: ", filepath);
+                    internal::setStatus(status, EStatus::WriteFailed);
+                    return false;
+                }
+
+                internal::setStatus(status, EStatus::Ok);
+                return true;
+            }
+
+            /**
+             * @brief Restores a state written by snapshot().
+             *
+             * The solver has to be initialized on the same topology with the same ruleset as the one the
+             * snapshot was taken from; its settings other than the propagation and backtracking modes are kept.
+             * A restored solver continues exactly like the original would have: calling run() draws the same
+             * tiles and gives the same output, except that the restart and backtrack limits count from the
+             * start again, as for any run() that continues a wave. Restoring one snapshot into several
+             * solvers forks the wave; reseeding the forks through getRandom() afterwards gives each of them
+             * its own variant of the common prefix.
+             *
+             * @param snapshot The bytes of the snapshot.
+             * @return True if the state was restored. Otherwise the solver is left unchanged and getStatus()
+             * tells why: NotInitialized, NoRuleset, or InvalidFormat for snapshots that are truncated, corrupt,
+             * of another version or byte order, or were taken with another ruleset or topology.
+             */
+            bool restore(Span<const unsigned char> snapshot) {
+                if (!this->m_initialized) {
+                    internal::log<ELogLevel::Error>("WaveFunctionCollapse2D not initialized.");
+                    this->m_status = EStatus::NotInitialized;
+                    return false;
+                }
+
+                if (this->numTiles() == 0) {
+                    internal::log<ELogLevel::Error>("No ruleset loaded.");
+                    this->m_status = EStatus::NoRuleset;
+                    return false;
+                }
+
+                SnapshotHeader header;
+                if (snapshot.size() < sizeof(header)) {
+                    internal::log<ELogLevel::Error>("Not a solver snapshot.");
+                    this->m_status = EStatus::InvalidFormat;
+                    return false;
+                }
+                std::memcpy(&header, snapshot.data(), sizeof(header));
+
+                if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+                    internal::log<ELogLevel::Error>("Not a solver snapshot.");
+                    this->m_status = EStatus::InvalidFormat;
+                    return false;
+                }
+
+                if (header.version != SNAPSHOT_VERSION || header.byteOrder != SNAPSHOT_BYTE_ORDER || header.headerSize != sizeof(SnapshotHeader)) {
+                    internal::log<ELogLevel::Error>("Unsupported solver snapshot version or byte order.");
+                    this->m_status = EStatus::InvalidFormat;
+                    return false;
+                }
+
+                const size_t cells = this->m_output.size();
+                const size_t tiles = this->numTiles();
+                if (header.cells != cells || header.numTiles != tiles || header.words != this->m_words
+                    || header.directions != NUM_OPTION_DIRECTIONS || header.tileIndexBytes != sizeof(TileIndex)
+                    || header.rulesetFingerprint != this->m_compiledRuleset->fingerprint()) {
+                    internal::log<ELogLevel::Error>("The snapshot was taken with another ruleset or topology.");
+                    this->m_status = EStatus::InvalidFormat;
+                    return false;
+                }
+
+                if (!this->validSnapshot(header, snapshot)) {
+                    internal::log<ELogLevel::Error>("Corrupt solver snapshot.");
+                    this->m_status = EStatus::InvalidFormat;
+                    return false;
+                }
+
+                // The heap checks its own layout, and is the only part that can still be rejected
+                const unsigned char* data = snapshot.data();
+                if (!this->m_entropyHeap.assign(snapshotSection<uint32_t>(data, header, SECTION_HEAP),
+                    snapshotSection<uint32_t>(data, header, SECTION_HEAP_POSITIONS), snapshotSection<float>(data, header, SECTION_HEAP_KEYS))) {
+                    internal::log<ELogLevel::Error>("Corrupt solver snapshot.");
+                    this->m_status = EStatus::InvalidFormat;
+                    return false;
+                }
+
+                restoreSection(data, header, SECTION_WAVE, this->m_wave);
+                restoreSection(data, header, SECTION_REMAINING, this->m_remaining);
+                restoreSection(data, header, SECTION_SUM_WEIGHTS, this->m_sumWeights);
+                restoreSection(data, header, SECTION_SUM_WEIGHT_LOG_WEIGHTS, this->m_sumWeightLogWeights);
+                restoreSection(data, header, SECTION_COLLAPSED, this->m_collapsed);
+                restoreSection(data, header, SECTION_OUTPUT, this->m_output);
+                restoreSection(data, header, SECTION_COMPATIBLE, this->m_compatible);
+                restoreSection(data, header, SECTION_TRAIL, this->m_trail);
+                restoreSection(data, header, SECTION_DECISIONS, this->m_decisions);
+                restoreSection(data, header, SECTION_BAN_STACK, this->m_banStack);
+                restoreSection(data, header, SECTION_PINS, this->m_pins);
+
+                this->clearDirty();
+                restoreSection(data, header, SECTION_PROPAGATION_STACK, this->m_propagationStack);
+                for (const size_t index : this->m_propagationStack) {
+                    this->m_onStack[index] = true;
+                }
+
+                this->m_propagation = (header.flags & SNAPSHOT_FLAG_SUPPORT_COUNTING) != 0 ? EPropagation::SupportCounting : EPropagation::ArcConsistency;
+                this->m_backtracking = (header.flags & SNAPSHOT_FLAG_BACKTRACKING) != 0;
+                this->m_contradiction = (header.flags & SNAPSHOT_FLAG_CONTRADICTION) != 0;
+                this->m_random.setState(header.random);
+                this->m_seed = header.seed;
+                this->m_attempts = static_cast<size_t>(header.attempts);
+                this->m_backtracks = static_cast<size_t>(header.backtracks);
+                this->m_invalidRegion = { static_cast<size_t>(header.invalidRegion[0]), static_cast<size_t>(header.invalidRegion[1]),
+                    static_cast<size_t>(header.invalidRegion[2]), static_cast<size_t>(header.invalidRegion[3]) };
+
+                this->m_status = EStatus::Ok;
+                return true;
+            }
+
+            /**
+             * @brief Restores a snapshot written by saveSnapshot(), reading it through a memory mapping.
+             *
+             * @param filepath Path of the snapshot file.
+             * @return True if the state was restored, see restore(); FileNotFound if the file can't be opened.
+             */
+            bool loadSnapshot(const std::string& filepath) {
+                const auto file = internal::MappedFile::open(filepath);
+                if (!file) {
+                    internal::log<ELogLevel::Error>("Unable to open file: ", filepath);
+                    this->m_status = EStatus::FileNotFound;
+                    return false;
+                }
+
+                return this->restore(Span<const unsigned char>(file->data(), file->size()));
+            }
+
+            static constexpr size_t DEFAULT_RESOLVE_MARGIN = 2;
+
+            /**
+             * @brief Fixes a tile to an option, e.g. after a hand edit.
+             * 
+             * A tile that is not collapsed yet is collapsed to the option right away. Pins outlive restarts and
+             * reset(): every time the wave is reseeded, pinned tiles are collapsed before anything else, and a
+             * pin the fresh wave rules out makes the attempt fail. The tile is also marked for resolve(), which
+             * brings an already solved 2D map in line with the pin. initialize() drops every pin.
+             * 
+             * @param index Index of the tile.
+             * @param option Option the tile is fixed to.
+             * @return False if the solver is not initialized, the index or option is out of range, or the tile
+             * is still open and the option was already removed from its domain; no pin is set then.
+             */
+            bool pin(size_t index, size_t option) {
+                if (!this->m_initialized || index >= this->m_output.size() || option >= numTiles()) {
+                    return false;
+                }
+
+                if (!isCollapsed(index) && !internal::testBit(domain(index), option)) {
+                    return false;
+                }
+
+                const auto it = findPin(index);
+                if (it != this->m_pins.end() && it->index == index) {
+                    it->option = option;
+                }
+                else {
+                    this->m_pins.insert(it, Pin{ index, option });
+                }
+
+                // A tile that is still open takes the pin at once; run() propagates it
+                if (!isCollapsed(index)) {
+                    const bool collapsed = collapse(index, option);
+                    assert(collapsed);
+                    (void)collapsed;
+                }
+
+                if constexpr (IS_GRID) {
+                    invalidate(index / this->m_topology.cols(), index % this->m_topology.cols(), 1, 1);
+                }
+                return true;
+            }
+
+            /**
+             * @brief Releases a pinned tile, which resolve() will then draw again.
+             */
+            void unpin(size_t index) {
+                const auto it = findPin(index);
+                if (it == this->m_pins.end() || it->index != index) {
+                    return;
+                }
+
+                this->m_pins.erase(it);
+                if constexpr (IS_GRID) {
+                    invalidate(index / this->m_topology.cols(), index % this->m_topology.cols(), 1, 1);
+                }
+            }
+
+            bool isPinned(size_t index) const {
+                const auto it = std::lower_bound(this->m_pins.begin(), this->m_pins.end(), index, [](const Pin& pin, size_t value) { return pin.index < value; });
+                return it != this->m_pins.end() && it->index == index;
+            }
+
+            /**
+             * @brief Marks a rectangle of tiles to be drawn again by resolve().
+             * 
+             * The rectangle is clipped to the grid and merged with the area marked so far.
+             * 
+             * @param row First row of the rectangle.
+             * @param col First column of the rectangle.
+             * @param rows Number of rows of the rectangle.
+             * @param cols Number of columns of the rectangle.
+             */
+            void invalidate(size_t row, size_t col, size_t rows, size_t cols) {
+                static_assert(IS_GRID, "Regions are only redrawn on 2D grids");
+
+                const size_t height = this->m_topology.rows();
+                const size_t width = this->m_topology.cols();
+                if (!this->m_initialized || row >= height || col >= width || rows == 0 || cols == 0) {
+                    return;
+                }
+
+                const size_t bottom = std::min(height, row + std::min(rows, height - row));
+                const size_t right = std::min(width, col + std::min(cols, width - col));
+                if (!hasInvalidRegion()) {
+                    this->m_invalidRegion = { row, col, bottom, right };
+                    return;
+                }
+
+                this->m_invalidRegion.top = std::min(this->m_invalidRegion.top, row);
+                this->m_invalidRegion.left = std::min(this->m_invalidRegion.left, col);
+                this->m_invalidRegion.bottom = std::max(this->m_invalidRegion.bottom, bottom);
+                this->m_invalidRegion.right = std::max(this->m_invalidRegion.right, right);
+            }
+
+            bool hasInvalidRegion() const {
+                return this->m_invalidRegion.bottom > this->m_invalidRegion.top;
+            }
+
+            /**
+             * @brief Sets how many rows and columns around the invalidated area resolve() draws again.
+             * 
+             * Tiles next to an edit may have to change for it to fit; a wider margin gives the solver more
+             * room, a narrower one keeps more of the map and is faster.
+             */
+            void setResolveMargin(size_t margin) {
+                this->m_resolveMargin = margin;
+            }
+
+            size_t getResolveMargin() const {
+                return this->m_resolveMargin;
+            }
+
+            /**
+             * @brief Draws the invalidated area again, leaving the rest of a solved map untouched.
+             * 
+             * The area grown by the margin is solved on its own by a solver sized to it, with the ring of
+             * tiles around it pinned to their current options and with the pins inside it applied, so its
+             * constraints propagate inward from the frozen border. If that has no solution the margin is
+             * doubled and the solve repeated, up to the whole grid. The cost follows the size of the area, not
+             * of the map.
+             * 
+             * On a grid that is not solved yet, the wave is reseeded and run() solves all of it.
+             * 
+             * @return True if the map is solved and agrees with every pin; otherwise the previous map is kept.
+             */
+            bool resolve() {
+                static_assert(IS_GRID, "Regions are only redrawn on 2D grids");
+
+                if (!this->m_initialized) {
+                    internal::log<ELogLevel::Error>("WaveFunctionCollapse2D not initialized.");
+                    this->m_status = EStatus::NotInitialized;
+                    return false;
+                }
+
+                if (!isSolved()) {
+                    this->resetWave();
+                    if (!run()) {
+                        return false;
+                    }
+                    this->m_invalidRegion = {};
+                    return true;
+                }
+
+                if (!hasInvalidRegion()) {
+                    this->m_status = EStatus::Ok;
+                    return true;
+                }
+
+                for (size_t margin = this->m_resolveMargin; ; margin = std::max<size_t>(1, 2 * margin)) {
+                    const Region region = marginRegion(margin);
+
+                    if (resolveRegion(region)) {
+                        this->m_invalidRegion = {};
+                        this->m_status = EStatus::Ok;
+                        return true;
+                    }
+
+                    internal::log<ELogLevel::Debug>("No solution with a margin of ", margin, ", widening it.");
+
+                    if (region.bottom - region.top == this->m_topology.rows() && region.right - region.left == this->m_topology.cols()) {
+                        internal::log<ELogLevel::Warning>("Unable to resolve the invalidated region.");
+                        this->m_status = EStatus::Contradiction;
+                        return false;
+                    }
+                }
+            }
+
+            /**
+             * @brief Sets how many times run() may start over after a contradiction.
+             * 
+             * @param maxRestarts Number of restarts; 0 allows a single attempt.
+             */
+            void setMaxRestarts(size_t maxRestarts) {
+                this->m_maxRestarts = maxRestarts;
+            }
+
+            /**
+             * @brief Sets the wall-clock time run() may take.
+             * 
+             * @param timeBudget Time budget; zero means unlimited.
+             */
+            void setTimeBudget(std::chrono::nanoseconds timeBudget) {
+                this->m_timeBudget = timeBudget;
+            }
+
+            /**
+             * @brief Enables backtracking instead of restarting on every contradiction.
+             * 
+             * Collapses and propagation then log every change they make to a trail, which costs a few stores
+             * per removed option. If the solver is initialized, its wave is reseeded.
+             * 
+             * @param enabled True to backtrack on contradictions.
+             * @param maxBacktracks Number of backtracks allowed per attempt before it is restarted.
+             */
+            void setBacktracking(bool enabled, size_t maxBacktracks = DEFAULT_MAX_BACKTRACKS) {
+                this->m_backtracking = enabled;
+                this->m_maxBacktracks = maxBacktracks;
+
+                if (this->m_initialized) {
+                    this->resetWave();
+                }
+            }
+
+            bool isBacktracking() const {
+                return this->m_backtracking;
+            }
+
+            /**
+             * @brief Gets the number of backtracks of the last attempt of run().
+             */
+            size_t getBacktracks() const {
+                return this->m_backtracks;
+            }
+
+            /**
+             * @brief Gets the outcome of the last run(), solveParallel(), resolve() or ruleset load.
+             * 
+             * Failures are reported here rather than printed; install a sink with setLogSink() to also get
+             * them as messages.
+             */
+            EStatus getStatus() const {
+                return this->m_status;
+            }
+
+            /**
+             * @brief Gets the number of attempts the last run() made.
+             */
+            size_t getAttempts() const {
+                return this->m_attempts;
+            }
+
+            /**
+             * @brief Counters and phase timers of the last run(), see getStats().
+             * 
+             * Collected only when the library is built with WFC_SOLVER_STATS=1; otherwise every field stays
+             * zero and the solver does no bookkeeping at all.
+             */
+            struct SolverStats {
+                size_t collapses{ 0 };             /**< Tiles collapsed by run(). */
+                size_t bans{ 0 };                  /**< Options removed from domains by propagation and backtracking. */
+                size_t maxQueueSize{ 0 };          /**< High-water mark of the propagation worklist. */
+                size_t contradictions{ 0 };        /**< Collapses, propagations and backtracks that emptied a domain. */
+                size_t backtracks{ 0 };            /**< Decisions taken back, over all attempts. */
+                size_t restarts{ 0 };              /**< Attempts started over from a fresh wave. */
+                uint64_t observeNanoseconds{ 0 };  /**< Time spent picking the tile to collapse. */
+                uint64_t propagateNanoseconds{ 0 };/**< Time spent propagating, rollbacks of backtracking included. */
+                uint64_t outputNanoseconds{ 0 };   /**< Time spent drawing options and writing them to the output. */
+            };
+
+            static constexpr bool STATS_ENABLED = WFC_SOLVER_STATS != 0;
+
+            /**
+             * @brief Gets the statistics of the last run(); all zero unless built with WFC_SOLVER_STATS=1.
+             */
+            const SolverStats& getStats() const {
+                return this->m_stats;
+            }
+
+            /**
+             * @brief Calls a function every few collapses made by run(), e.g. to report progress.
+             * 
+             * The callback runs on the thread of run(), which waits for it to return; the solver may be
+             * inspected from it but not modified.
+             * 
+             * @param callback Function to call, or an empty function to remove it.
+             * @param interval Number of collapses between two calls; 0 disables the callback.
+             */
+            void setProgressCallback(CallbackFn callback, size_t interval) {
+                this->m_progressCallback = std::move(callback);
+                this->m_progressInterval = this->m_progressCallback ? interval : 0;
+            }
+
+            /**
+             * @brief Picks the tile to collapse next (EHeuristic::Entropy).
+             * 
+             * Tiles that are not collapsed yet are kept in an indexed min-heap keyed on their entropy, which
+             * propagation updates in place, so this is O(1). Ties are broken by a noise term derived from the
+             * seed and the tile index, so the choice is deterministic.
+             * 
+             * @return Index of the uncollapsed tile with the lowest entropy, or NOT_FOUND if every tile is collapsed.
+             */
+            size_t observe() const {
+                return this->m_entropyHeap.empty() ? NOT_FOUND : this->m_entropyHeap.top();
+            }
+
+            /**
+             * @brief Collapses the wave function.
+             * 
+             * This method collapses the wave function in the Wave Function Collapse algorithm.
+             * An option still possible for the tile is drawn with a probability proportional to its weight,
+             * by binary search over the cumulative weights of the remaining options.
+             * 
+             * @return True if the wave function collapse is successful, false otherwise.
+             */
+            bool collapse(size_t index) { 
+                if (isCollapsed(index)) {
+                    return true;
+                }
+
+                if (m_remaining[index] == 0) {
+                    return false;
+                }
+
+                return collapse(index, chooseOption(index));
+            }
+
+            /**
+             * @brief Draws one of the options still possible for a tile, weighted by the tile weights.
+             * 
+             * @param index Index of the tile; its domain must not be empty.
+             * @return The chosen option.
+             */
+            size_t chooseOption(size_t index) {
+                m_candidates.clear();
+                m_cumulativeWeights.clear();
+
+                float total = 0.0f;
+                internal::DomainOps<0>::forEach(domain(index), m_words, [&](size_t option) {
+                    total += m_compiledRuleset->weights[option];
+                    m_candidates.push_back(static_cast<uint32_t>(option));
+                    m_cumulativeWeights.push_back(total);
+                });
+
+                const float threshold = m_random.uniformFloat() * total;
+                const size_t choice = std::upper_bound(m_cumulativeWeights.begin(), m_cumulativeWeights.end(), threshold) - m_cumulativeWeights.begin();
+
+                // Rounding can put the threshold on the total itself
+                return m_candidates[std::min(choice, m_candidates.size() - 1)];
+            }
+
+            /**
+             * @brief Collapses the tile at the given index to a specific option.
+             * 
+             * The tile is queued for propagation; call propagate() to bring the rest of the wave back
+             * to a consistent state.
+             * 
+             * @param index Index of the tile to collapse.
+             * @param option Option (tile ID) the tile collapses to.
+             * @return True if the option was still possible for the tile, false otherwise.
+             */
+            bool collapse(size_t index, size_t option) {
+                if (option >= numTiles() || option >= MAX_OUTPUT_TILES || !internal::testBit(domain(index), option)) {
+                    return false;
+                }
+
+                m_entropyHeap.remove(index);
+
+                if (m_propagation == EPropagation::SupportCounting) {
+                    // Every other option is banned so that its supports get withdrawn from the neighbours
+                    std::copy(domain(index), domain(index) + m_words, m_scratch.begin());
+                    internal::DomainOps<0>::forEach(m_scratch.data(), m_words, [&](size_t other) {
+                        if (other != option) {
+                            ban(index, other);
+                        }
+                    });
+                }
+                else {
+                    if (m_backtracking) {
+                        internal::DomainOps<0>::forEach(domain(index), m_words, [&](size_t other) {
+                            if (other != option) {
+                                record(ETrail::Removal, index, other);
+                            }
+                        });
+                    }
+
+                    internal::DomainOps<0>::clear(domain(index), m_words);
+                    internal::setBit(domain(index), option);
+                    m_remaining[index] = 1;
+
+                    pushDirty(index);
+                }
+
+                // Set the sums outright so no rounding from the removals is left behind
+                m_sumWeights[index] = m_compiledRuleset->weights[option];
+                m_sumWeightLogWeights[index] = m_compiledRuleset->weightLogWeights[option];
+
+                internal::setBit(m_collapsed.data(), index);
+                m_output[index] = static_cast<TileIndex>(option);
+
+                if (m_backtracking) {
+                    record(ETrail::Collapse, index, option);
+                }
+
+                return true;
+            }
+
+            /**
+             * @brief Applies the superposition principle.
+             * 
+             * This method applies the superposition principle in the Wave Function Collapse algorithm.
+             * Dirty tiles are popped from the worklist and every neighbour is revised against them (AC-3).
+             * A neighbour whose domain shrinks is pushed in turn, so only the affected region is visited and
+             * the loop stops as soon as the wave reaches a fixpoint.
+             * 
+             * In SupportCounting mode the worklist holds banned (tile, option) pairs instead, whose supports are
+             * withdrawn from the neighbouring tiles.
+             * 
+             * @return True if the wave is consistent, false if a tile ran out of options.
+             */
+            bool propagate() { 
+                // Flagged by a ban that emptied a tile, or by applyPins() when a pin could not be applied
+                if (m_contradiction) {
+                    clearDirty();
+                    m_banStack.clear();
+                    m_contradiction = false;
+                    return false;
+                }
+
+                return propagateWave();
+            }
+
+            /**
+             * @brief Gets the options that are still possible for a tile.
+             * 
+             * @param index Index of the tile.
+             * @return Bitset with a bit set for every tile ID that is still possible.
+             */
+            Bitset getDomain(size_t index) const {
+                return Bitset(domain(index), numTiles());
+            }
+
+            /**
+             * @brief Gets the Shannon entropy of a tile.
+             * 
+             * With the weights w of the options still possible, H = log(sum w) - sum(w log w) / sum w.
+             * Both sums are kept per tile and updated when an option is removed, so this is O(1).
+             * 
+             * @param index Index of the tile.
+             * @return Entropy of the tile, 0 once a single option is left.
+             */
+            float getEntropy(size_t index) const {
+                if (m_remaining[index] <= 1) {
+                    return 0.0f;
+                }
+
+                const float sumWeights = m_sumWeights[index];
+                return m_compiledRuleset->logTable.log(sumWeights) - m_sumWeightLogWeights[index] / sumWeights;
+            }
+
+            /**
+             * @brief Checks whether a tile has been collapsed to a single option.
+             * 
+             * @param index Index of the tile.
+             * @return True if the tile was collapsed, false otherwise.
+             */
+            bool isCollapsed(size_t index) const {
+                return internal::testBit(this->m_collapsed.data(), index);
+            }
+
+            /**
+             * @brief Checks if the Wave Function Collapse algorithm is initialized.
+             * 
+             * @return True if initialized, false otherwise.
+             */
+
+            bool isInitialized() const {
+                return this->m_initialized;
+            }
+
+            /**
+             * @brief Gets the size of the output grid.
+             * 
+             * @return Size of the output grid.
+             */
+            size_t size() const {
+                return this->m_output.size();
+            }
+
+            /**
+             * @brief Accesses the pattern at the specified index in the output grid using bounds checking.
+             * 
+             * @param index Index of the pattern to access.
+             * @return Reference to the pattern at the specified index.
+             * @throws std::out_of_range if index is out of range.
+             */
+            const TileIndex& at(size_t index) const {
+                return this->m_output.at(index);
+            }
+
+            /**
+             * @brief Accesses the pattern at the specified index in the output grid without bounds checking.
+             * 
+             * @param index Index of the pattern to access.
+             * @return Reference to the pattern at the specified index.
+             * @warning No bounds checking is performed. Accessing an out-of-range index leads to undefined behavior.
+             */
+            const TileIndex& operator[](size_t index) const {
+                return this->m_output[index];
+            }
+
+            /**
+             * @brief Gets the output grid in row-major order, without copying.
+             * 
+             * Collapsed cells hold their tile and the others NO_TILE. The view stays valid until the solver
+             * is initialized again; see writeRaw() and writePng() to export it.
+             */
+            Span<const TileIndex> getOutput() const {
+                return Span<const TileIndex>(this->m_output);
+            }
+
+            size_t getRows() const {
+                return this->m_topology.rows();
+            }
+
+            size_t getCols() const {
+                return this->m_topology.cols();
+            }
+
+            /**
+             * @brief Returns an iterator to the beginning of the output grid.
+             * 
+             * The iterators are plain pointers into the row-major grid: contiguous and random access, so
+             * the standard algorithms, parallel ones included, can split the range freely.
+             * 
+             * @return Iterator to the beginning of the output grid.
+             */
+            iterator begin() {
+                return this->m_output.data();
+            }
+
+            const_iterator begin() const {
+                return this->m_output.data();
+            }
+
+            const_iterator cbegin() const {
+                return this->m_output.data();
+            }
+
+            /**
+             * @brief Returns an iterator to the end of the output grid.
+             * 
+             * @return Iterator to the end of the output grid.
+             */
+            iterator end() {
+                return this->m_output.data() + this->m_output.size();
+            }
+
+            const_iterator end() const {
+                return this->m_output.data() + this->m_output.size();
+            }
+
+            const_iterator cend() const {
+                return this->m_output.data() + this->m_output.size();
+            }
+
+            /**
+             * @brief Gets one row of the output grid, without copying.
+             */
+            Span<const TileIndex> getRow(size_t row) const {
+                assert(row < getRows());
+                return getOutput().subspan(row * getCols(), getCols());
+            }
+
+            /**
+             * @brief Gets count consecutive rows of the output grid, starting at first, without copying.
+             * 
+             * Row bands can be handed to separate workers, e.g. for post-processing passes.
+             */
+            Span<const TileIndex> getRowRange(size_t first, size_t count) const {
+                assert(first + count <= getRows());
+                return getOutput().subspan(first * getCols(), count * getCols());
+            }
+
+            /**
+             * @brief Prints the output grid, one line per row and "-" for the cells that are not collapsed.
+             * 
+             * The layers of a box are printed one after the other. Every row is formatted into a buffer and
+             * written at once.
+             */
+            void print(std::ostream& stream = std::cout) const {
+                std::string line;
+                char digits[8];
+                const size_t cols = getCols();
+                for (size_t row = 0; row < m_output.size() / cols; ++row) {
+                    line.clear();
+                    for (size_t col = 0; col < cols; ++col) {
+                        const TileIndex tile = m_output[row * cols + col];
+                        if (tile == NO_TILE) {
+                            line += '-';
+                        }
+                        else {
+                            line.append(digits, std::to_chars(digits, digits + sizeof(digits), tile).ptr);
+                        }
+                        line += ' ';
+                    }
+                    line += '\n';
+                    stream.write(line.data(), static_cast<std::streamsize>(line.size()));
+                }
+                stream.flush();
+            }
+
+            /**
+             * @brief Gets the neighboring indices of a given cell.
+             * 
+             * This method calculates the neighboring indices of a cell in the grid based on its current index.
+             * 
+             * @param currentIndex The index of the current cell.
              * @return A vector containing the neighboring indices of the current cell: UP, DOWN, LEFT, RIGHT.
              * 
-             * The neighboring indices are calculated based on the current index in the grid.
-             * The order of neighboring indices in the returned vector is UP, DOWN, LEFT, RIGHT.
-             * If a neighboring cell exists in the upward direction, its index is included first.
-             * If a neighboring cell exists in the downward direction, its index is included second.
-             * If a neighboring cell exists in the leftward direction, its index is included third.
-             * If a neighboring cell exists in the rightward direction, its index is included last.
+             * The neighboring indices are calculated based on the current index in the grid.
+             * The order of neighboring indices in the returned vector is UP, DOWN, LEFT, RIGHT.
+             * If a neighboring cell exists in the upward direction, its index is included first.
+             * If a neighboring cell exists in the downward direction, its index is included second.
+             * If a neighboring cell exists in the leftward direction, its index is included third.
+             * If a neighboring cell exists in the rightward direction, its index is included last.
+             * Other topologies list their neighbours in the order of their directions.
+             */
+            std::vector<size_t> getNeighboringIndices(size_t currentIndex) {
+                const Neighbors neighbors = getNeighbors(currentIndex);
+                return std::vector<size_t>(neighbors.indices, neighbors.indices + neighbors.count);
+            }
+
+            /**
+             * @brief Neighbours of a cell, stored inline.
+             */
+            struct Neighbors {
+                size_t indices[NUM_OPTION_DIRECTIONS];    /**< Neighbour indices in the order UP, DOWN, LEFT, RIGHT. */
+                size_t directions[NUM_OPTION_DIRECTIONS]; /**< Direction of every neighbour in indices. */
+                size_t count{ 0 };
+            };
+
+            /**
+             * @brief Gets the neighbours of a cell without allocating.
+             * 
+             * @param currentIndex The index of the current cell.
+             * @return The existing neighbours with their directions, in the order UP, DOWN, LEFT, RIGHT.
+             */
+            Neighbors getNeighbors(size_t currentIndex) const {
+                Neighbors neighbors;
+                forEachNeighbor(currentIndex, [&neighbors](size_t direction, size_t neighborIndex) {
+                    neighbors.indices[neighbors.count] = neighborIndex;
+                    neighbors.directions[neighbors.count] = direction;
+                    ++neighbors.count;
+                });
+                return neighbors;
+            }
+
+            /**
+             * @brief Calls fn(direction, neighborIndex) for every neighbour of a cell, in the order UP, DOWN, LEFT, RIGHT.
+             * 
+             * This is what propagation uses: nothing is allocated, and the walk of the topology is inlined. On
+             * a 2D grid the offsets come from per-row and per-column tables that already hold the wrap-around
+             * of a periodic grid, so only the edges of a fixed grid test which neighbours exist; see
+             * QuadTopology::forEachNeighbor().
+             * 
+             * @param currentIndex The index of the current cell.
+             * @param fn Visitor called with the direction (EDirections of the topology as size_t) and the index of each neighbour.
+             */
+            template <typename Fn>
+            void forEachNeighbor(size_t currentIndex, Fn&& fn) const {
+                this->m_topology.forEachNeighbor(currentIndex, std::forward<Fn>(fn));
+            }
+
+            // Utility function to generate a random integer in [min, max]
+            size_t random(size_t min, size_t max) {
+                return min + static_cast<size_t>(this->m_random.uniform(static_cast<uint64_t>(max - min) + 1));
+            }
+
+            /**
+             * @brief Seeds the random number generator and the entropy tie-breaking noise.
+             * 
+             * Two solvers with the same seed, ruleset and calls produce the same output. If the solver is
+             * initialized, its wave is reseeded.
+             * 
+             * @param seed Seed of the run.
+             * @param stream Independent stream of the seed to draw from, e.g. one per worker thread.
+             */
+            void setSeed(uint64_t seed, uint64_t stream = 0) {
+                this->setNextSeed(seed, stream);
+
+                if (this->m_initialized) {
+                    this->resetWave();
+                }
+            }
+
+            /**
+             * @brief Seeds the solver like setSeed(), but leaves the wave alone.
+             * 
+             * The seed takes effect with the next initialize() or reset(), which saves reseeding a wave that
+             * is rebuilt right after anyway, e.g. when a solver is reused for another map. Call one of them
+             * before run().
+             * 
+             * @param seed Seed of the run.
+             * @param stream Independent stream of the seed to draw from.
+             */
+            void setNextSeed(uint64_t seed, uint64_t stream = 0) {
+                this->m_random = Random::forStream(seed, stream);
+                this->m_seed = this->m_random.next();
+            }
+
+            /**
+             * @brief Gets the random number generator of the solver.
+             */
+            Random& getRandom() {
+                return this->m_random;
+            }
+
+        protected:
+            using FixedKernel = bool (WaveFunctionCollapseImpl::*)();
+
+            /**
+             * @brief Makes propagate() run a kernel specialized for one ruleset while the solver uses it.
+             * 
+             * The kernel is a member rather than a virtual override so that runtime solvers pay a null check
+             * and nothing else, and the copies made by solveParallel() keep it.
+             * 
+             * @param kernel An instance of propagateFixed().
+             * @param ruleset The ruleset the kernel was generated for; any other falls back to the generic kernels.
+             */
+            void setFixedKernel(FixedKernel kernel, std::shared_ptr<const CompiledRuleset> ruleset) {
+                this->m_fixedKernel = kernel;
+                this->m_fixedRuleset = std::move(ruleset);
+            }
+
+            /**
+             * @brief Propagates the wave with the fixed kernel if it applies, the generic kernels otherwise.
+             */
+            bool propagateWave() {
+                if (m_fixedKernel != nullptr && m_compiledRuleset == m_fixedRuleset) {
+                    return (this->*m_fixedKernel)();
+                }
+
+                // Domains of up to 256 tiles get kernels with a fixed word count
+                switch (m_words) {
+                    case 1:  return propagateWords<1>();
+                    case 2:  return propagateWords<2>();
+                    case 4:  return propagateWords<4>();
+                    default: return propagateWords<0>();
+                }
+            }
+
+            /**
+             * @brief AC-3 with the adjacency masks of a ruleset known at compile time.
+             * 
+             * Rules provides Rules::supportedBy(source, direction), the union of the masks of the options in
+             * source, for rulesets of at most 64 tiles. With the masks as constants the union folds into a few
+             * immediate ANDs and ORs instead of a loop over table lookups. SupportCounting and parallel
+             * propagation keep using the generic kernels.
+             * 
+             * @tparam Rules Static description of the ruleset.
+             */
+            template <typename Rules>
+            bool propagateFixed() {
+                if (m_propagation == EPropagation::SupportCounting || m_words != 1 ||
+                    (m_propagationThreads > 1 && !m_backtracking && m_propagationStack.size() >= m_parallelMinDirtyTiles)) {
+                    return propagateWords<1>();
+                }
+
+                while (!m_propagationStack.empty()) {
+                    if (stopRequested()) {
+                        clearDirty();
+                        return false;
+                    }
+
+                    const size_t index = m_propagationStack.back();
+                    m_propagationStack.pop_back();
+                    m_onStack[index] = false;
+
+                    const uint64_t source = *domain(index);
+                    bool contradiction = false;
+                    forEachNeighbor(index, [&](size_t direction, size_t neighborIndex) {
+                        if (contradiction) {
+                            return;
+                        }
+
+                        uint64_t& target = *domain(neighborIndex);
+                        const uint64_t supported = Rules::supportedBy(source, direction);
+                        const uint64_t removed = target & ~supported;
+                        if (removed == 0) {
+                            return;
+                        }
+
+                        target &= supported;
+                        for (uint64_t bits = removed; bits != 0; bits &= bits - 1) {
+                            const size_t option = internal::countTrailingZeros(bits);
+                            removeWeight(neighborIndex, option);
+                            if (m_backtracking) {
+                                record(ETrail::Removal, neighborIndex, option);
+                            }
+                        }
+
+                        m_remaining[neighborIndex] = static_cast<uint16_t>(m_remaining[neighborIndex] - internal::popcount(removed));
+                        m_entropyHeap.update(neighborIndex, entropyKey(neighborIndex));
+
+                        contradiction = m_remaining[neighborIndex] == 0;
+                        pushDirty(neighborIndex);
+                    });
+
+                    if (contradiction) {
+                        clearDirty();
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+        private:
+            // Solvers can't be copied by users; solveParallel() clones this one for its speculative runs
+            WaveFunctionCollapseImpl(const WaveFunctionCollapseImpl&) = default;
+            WaveFunctionCollapseImpl(WaveFunctionCollapseImpl&&) = default;
+            WaveFunctionCollapseImpl& operator=(const WaveFunctionCollapseImpl&) = default;
+            WaveFunctionCollapseImpl& operator=(WaveFunctionCollapseImpl&&) = default;
+
+            /**
+             * @brief Attaches a ruleset returned by a loader, keeping the current one if loading failed.
+             */
+            const Ruleset& attachLoadedRuleset(std::shared_ptr<const Ruleset> ruleset) {
+                static const std::shared_ptr<const Ruleset> none = Ruleset::create({});
+                if (!ruleset) {
+                    return *none;
+                }
+
+                this->setRuleset(std::move(ruleset));
+                return *this->m_ruleset;
+            }
+
+            /**
+             * @brief A tile fixed by pin().
+             */
+            struct Pin {
+                size_t index;
+                size_t option;
+            };
+
+            /**
+             * @brief Rectangle of tiles, rows [top, bottom) and columns [left, right).
+             */
+            struct Region {
+                size_t top{ 0 };
+                size_t left{ 0 };
+                size_t bottom{ 0 };
+                size_t right{ 0 };
+            };
+
+            static constexpr char SNAPSHOT_MAGIC[8] = { 'W', 'F', 'C', 'S', 'N', 'A', 'P', '\0' };
+            static constexpr uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+            static constexpr uint32_t SNAPSHOT_FLAG_SUPPORT_COUNTING = 1;
+            static constexpr uint32_t SNAPSHOT_FLAG_BACKTRACKING = 2;
+            static constexpr uint32_t SNAPSHOT_FLAG_CONTRADICTION = 4;
+            static constexpr float SNAPSHOT_SUM_TOLERANCE = 1e-3f; /**< Slack of the weight sums, relative to the sums over all tiles. */
+            static constexpr uint64_t SNAPSHOT_ALIGNMENT = 64;
+
+            /**
+             * @brief Arrays of a snapshot, in file order.
+             */
+            enum ESnapshotSection : size_t {
+                SECTION_WAVE,
+                SECTION_REMAINING,
+                SECTION_SUM_WEIGHTS,
+                SECTION_SUM_WEIGHT_LOG_WEIGHTS,
+                SECTION_COLLAPSED,
+                SECTION_OUTPUT,
+                SECTION_COMPATIBLE,
+                SECTION_HEAP,
+                SECTION_HEAP_POSITIONS,
+                SECTION_HEAP_KEYS,
+                SECTION_TRAIL,
+                SECTION_DECISIONS,
+                SECTION_PROPAGATION_STACK,
+                SECTION_BAN_STACK,
+                SECTION_PINS,
+                NUM_SNAPSHOT_SECTIONS
+            };
+
+            /**
+             * @brief Start of a snapshot; offsets are counted from the start of the snapshot, counts are in elements.
+             */
+            struct SnapshotHeader {
+                char magic[8];
+                uint32_t version;
+                uint32_t byteOrder;  /**< Reads back as another value on a machine of the other byte order. */
+                uint32_t headerSize;
+                uint32_t flags;
+                uint64_t cells;
+                uint64_t numTiles;
+                uint64_t words;
+                uint64_t directions;
+                uint64_t tileIndexBytes;     /**< Size of the output type, see WFC_TILE_INDEX_BITS. */
+                uint64_t rulesetFingerprint; /**< CompiledRuleset::fingerprint() of the ruleset of the solver. */
+                uint64_t random[4];          /**< State of the generator. */
+                uint64_t seed;               /**< Seed of the entropy noise. */
+                uint64_t attempts;
+                uint64_t backtracks;
+                uint64_t invalidRegion[4];   /**< Top, left, bottom and right of the region resolve() redraws. */
+                uint64_t counts[NUM_SNAPSHOT_SECTIONS];
+                uint64_t offsets[NUM_SNAPSHOT_SECTIONS];
+                uint64_t fileSize;
+            };
+
+            struct SnapshotSection {
+                const void* data;
+                uint64_t count;
+                uint64_t elementSize;
+            };
+
+            static constexpr uint64_t alignSnapshot(uint64_t offset) {
+                return (offset + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+            }
+
+            template <typename T>
+            static SnapshotSection snapshotSection(const std::vector<T>& values) {
+                return { values.data(), values.size(), sizeof(T) };
+            }
+
+            template <typename T>
+            static Span<const T> snapshotSection(const unsigned char* data, const SnapshotHeader& header, size_t section) {
+                return Span<const T>(reinterpret_cast<const T*>(data + header.offsets[section]), static_cast<size_t>(header.counts[section]));
+            }
+
+            template <typename T>
+            static void restoreSection(const unsigned char* data, const SnapshotHeader& header, size_t section, std::vector<T>& values) {
+                const Span<const T> saved = snapshotSection<T>(data, header, section);
+                values.assign(saved.begin(), saved.end());
+            }
+
+            /**
+             * @brief Gets the arrays written to a snapshot, in the order of ESnapshotSection.
+             */
+            std::array<SnapshotSection, NUM_SNAPSHOT_SECTIONS> snapshotSections() const {
+                return { {
+                    snapshotSection(this->m_wave),
+                    snapshotSection(this->m_remaining),
+                    snapshotSection(this->m_sumWeights),
+                    snapshotSection(this->m_sumWeightLogWeights),
+                    snapshotSection(this->m_collapsed),
+                    snapshotSection(this->m_output),
+                    snapshotSection(this->m_compatible),
+                    snapshotSection(this->m_entropyHeap.cells()),
+                    snapshotSection(this->m_entropyHeap.positions()),
+                    snapshotSection(this->m_entropyHeap.keys()),
+                    snapshotSection(this->m_trail),
+                    snapshotSection(this->m_decisions),
+                    snapshotSection(this->m_propagationStack),
+                    snapshotSection(this->m_banStack),
+                    snapshotSection(this->m_pins),
+                } };
+            }
+
+            /**
+             * @brief Checks the layout of a snapshot that matches this solver, and every index stored in it.
+             */
+            bool validSnapshot(const SnapshotHeader& header, Span<const unsigned char> snapshot) const {
+                if (header.fileSize != snapshot.size()) {
+                    return false;
+                }
+
+                const uint64_t cells = header.cells;
+                const uint64_t tiles = header.numTiles;
+                const uint64_t counters = (header.flags & SNAPSHOT_FLAG_SUPPORT_COUNTING) != 0 ? cells * this->m_compiledRuleset->supportCounts.size() : 0;
+                const uint64_t any = std::numeric_limits<uint64_t>::max();
+                const uint64_t expectedCounts[NUM_SNAPSHOT_SECTIONS] = {
+                    cells * header.words, cells, cells, cells, internal::wordsForTiles(static_cast<size_t>(cells)), cells, counters,
+                    any, cells, cells, any, any, any, any, any,
+                };
+
+                // The element sizes are those of this build, which the version and byte order pin down
+                const auto sections = this->snapshotSections();
+                for (size_t section = 0; section < NUM_SNAPSHOT_SECTIONS; ++section) {
+                    const uint64_t count = header.counts[section];
+                    const uint64_t offset = header.offsets[section];
+                    if ((expectedCounts[section] != any && count != expectedCounts[section])
+                        || offset % SNAPSHOT_ALIGNMENT != 0 || offset < sizeof(SnapshotHeader) || offset > header.fileSize
+                        || count > (header.fileSize - offset) / sections[section].elementSize) {
+                        return false;
+                    }
+                }
+
+                const unsigned char* data = snapshot.data();
+                if (header.counts[SECTION_PROPAGATION_STACK] > cells || header.counts[SECTION_PINS] > cells) {
+                    return false;
+                }
+
+                for (const size_t index : snapshotSection<size_t>(data, header, SECTION_PROPAGATION_STACK)) {
+                    if (index >= cells) {
+                        return false;
+                    }
+                }
+
+                for (const auto& ban : snapshotSection<std::pair<size_t, size_t>>(data, header, SECTION_BAN_STACK)) {
+                    if (ban.first >= cells || ban.second >= tiles) {
+                        return false;
+                    }
+                }
+
+                for (const Pin& pin : snapshotSection<Pin>(data, header, SECTION_PINS)) {
+                    if (pin.index >= cells || pin.option >= tiles) {
+                        return false;
+                    }
+                }
+
+                for (const Decision& decision : snapshotSection<Decision>(data, header, SECTION_DECISIONS)) {
+                    if (decision.index >= cells || decision.option >= tiles || decision.trailSize > header.counts[SECTION_TRAIL]) {
+                        return false;
+                    }
+                }
+
+                for (const TrailEntry& entry : snapshotSection<TrailEntry>(data, header, SECTION_TRAIL)) {
+                    const bool valid = entry.kind == ETrail::Counter ? entry.target < counters
+                        : (entry.kind == ETrail::Removal || entry.kind == ETrail::Collapse) && entry.target < cells && entry.value < tiles;
+                    if (!valid) {
+                        return false;
+                    }
+                }
+
+                return validSnapshotCells(header, data);
+            }
+
+            /**
+             * @brief Checks that the per-cell sections of a snapshot agree with its wave.
+             *
+             * Every domain has to be free of bits past the last tile and its count has to match. The weight
+             * sums are updated by subtraction, so they only have to be within rounding of the sums over the
+             * domain. A cell is collapsed exactly when its output holds a tile, and that tile has to be in its
+             * domain; the collapsed bits past the last cell have to be clear.
+             */
+            bool validSnapshotCells(const SnapshotHeader& header, const unsigned char* data) const {
+                const size_t cells = static_cast<size_t>(header.cells);
+                const size_t tiles = static_cast<size_t>(header.numTiles);
+                const size_t words = static_cast<size_t>(header.words);
+                const CompiledRuleset& ruleset = *this->m_compiledRuleset;
+
+                const Span<const uint64_t> wave = snapshotSection<uint64_t>(data, header, SECTION_WAVE);
+                const Span<const uint16_t> remaining = snapshotSection<uint16_t>(data, header, SECTION_REMAINING);
+                const Span<const float> sumWeights = snapshotSection<float>(data, header, SECTION_SUM_WEIGHTS);
+                const Span<const float> sumWeightLogWeights = snapshotSection<float>(data, header, SECTION_SUM_WEIGHT_LOG_WEIGHTS);
+                const Span<const uint64_t> collapsed = snapshotSection<uint64_t>(data, header, SECTION_COLLAPSED);
+                const Span<const TileIndex> output = snapshotSection<TileIndex>(data, header, SECTION_OUTPUT);
+
+                // Bounds for the rounding left by removals, which subtract at most every weight once
+                float weightScale = 1.0f;
+                float weightLogWeightScale = 1.0f;
+                for (size_t option = 0; option < tiles; ++option) {
+                    weightScale += std::abs(ruleset.weights[option]);
+                    weightLogWeightScale += std::abs(ruleset.weightLogWeights[option]);
+                }
+                const float weightTolerance = SNAPSHOT_SUM_TOLERANCE * weightScale;
+                const float weightLogWeightTolerance = SNAPSHOT_SUM_TOLERANCE * weightLogWeightScale;
+
+                for (size_t index = 0; index < cells; ++index) {
+                    const uint64_t* cellDomain = wave.data() + index * words;
+                    for (size_t word = tiles / 64; word < words; ++word) {
+                        const uint64_t padding = word == tiles / 64 ? ~uint64_t{ 0 } << (tiles % 64) : ~uint64_t{ 0 };
+                        if ((cellDomain[word] & padding) != 0) {
+                            return false;
+                        }
+                    }
+
+                    if (remaining[index] != internal::DomainOps<0>::count(cellDomain, words)) {
+                        return false;
+                    }
+
+                    float weightSum = 0.0f;
+                    float weightLogWeightSum = 0.0f;
+                    internal::DomainOps<0>::forEach(cellDomain, words, [&](size_t option) {
+                        weightSum += ruleset.weights[option];
+                        weightLogWeightSum += ruleset.weightLogWeights[option];
+                    });
+
+                    // Written so that NaNs fail as well
+                    if (!(std::abs(sumWeights[index] - weightSum) <= weightTolerance)
+                        || !(std::abs(sumWeightLogWeights[index] - weightLogWeightSum) <= weightLogWeightTolerance)) {
+                        return false;
+                    }
+
+                    const bool isCollapsed = internal::testBit(collapsed.data(), index);
+                    if (isCollapsed != (output[index] != NO_TILE)
+                        || (isCollapsed && (output[index] >= tiles || !internal::testBit(cellDomain, output[index])))) {
+                        return false;
+                    }
+                }
+
+                for (size_t index = cells; index < collapsed.size() * 64; ++index) {
+                    if (internal::testBit(collapsed.data(), index)) {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            typename std::vector<Pin>::iterator findPin(size_t index) {
+                return std::lower_bound(this->m_pins.begin(), this->m_pins.end(), index, [](const Pin& pin, size_t value) { return pin.index < value; });
+            }
+
+            bool isSolved() const {
+                return internal::DomainOps<0>::count(this->m_collapsed.data(), this->m_collapsed.size()) == this->m_output.size();
+            }
+
+            /**
+             * @brief Collapses every pinned tile, right after the wave was reseeded.
+             * 
+             * A pin whose option is already gone, e.g. banned as unsupported at the border, flags a
+             * contradiction, so the next propagate() fails and run() restarts or gives up.
+             */
+            void applyPins() {
+                for (const Pin& pin : this->m_pins) {
+                    if (!isCollapsed(pin.index) && !collapse(pin.index, pin.option)) {
+                        internal::log<ELogLevel::Debug>("Pinned option ", pin.option, " of tile ", pin.index, " is not possible.");
+                        m_contradiction = true;
+                    }
+                }
+            }
+
+            /**
+             * @brief Gets the invalidated region grown by a margin on every side.
+             * 
+             * On a periodic grid the region may cross the edges, so it is given in coordinates shifted by one
+             * grid size, which keeps the ring around it positive; rows and columns are taken modulo the grid
+             * size. A region that would overlap its own ring across the wrap-around becomes the whole grid.
+             */
+            Region marginRegion(size_t margin) const {
+                const Region& invalid = this->m_invalidRegion;
+                const size_t height = this->m_topology.rows();
+                const size_t width = this->m_topology.cols();
+                if (this->m_topology.boundary() == EBoundary::Fixed) {
+                    return {
+                        invalid.top - std::min(margin, invalid.top),
+                        invalid.left - std::min(margin, invalid.left),
+                        std::min(height, invalid.bottom + margin),
+                        std::min(width, invalid.right + margin),
+                    };
+                }
+
+                const size_t rows = invalid.bottom - invalid.top + 2 * margin;
+                const size_t cols = invalid.right - invalid.left + 2 * margin;
+                if (rows + 2 > height || cols + 2 > width) {
+                    return { 0, 0, height, width };
+                }
+
+                const size_t top = invalid.top + height - margin;
+                const size_t left = invalid.left + width - margin;
+                return { top, left, top + rows, left + cols };
+            }
+
+            /**
+             * @brief Solves a region of a solved grid against the current tiles around it.
+             * 
+             * @param region Region given by marginRegion().
+             * @return True if the region was solved and written back.
+             */
+            bool resolveRegion(const Region& region) {
+                const size_t height = this->m_topology.rows();
+                const size_t gridWidth = this->m_topology.cols();
+                const EBoundary boundary = this->m_topology.boundary();
+                const bool whole = region.bottom - region.top == height && region.right - region.left == gridWidth;
+                const bool wraps = boundary == EBoundary::Periodic && !whole;
+
+                // One ring of frozen tiles carries the constraints of the rest of the map; the whole grid of a
+                // periodic map is solved as a periodic grid instead
+                const size_t top = region.top - (wraps || region.top > 0);
+                const size_t left = region.left - (wraps || region.left > 0);
+                const size_t bottom = region.bottom + (wraps || region.bottom < height);
+                const size_t right = region.right + (wraps || region.right < gridWidth);
+                const size_t width = right - left;
+                const auto gridIndex = [height, gridWidth](size_t row, size_t col) {
+                    return row % height * gridWidth + col % gridWidth;
+                };
+
+                WaveFunctionCollapseImpl solver;
+                solver.setCompiledRuleset(this->m_compiledRuleset);
+                solver.setPropagation(this->m_propagation);
+                solver.setBacktracking(this->m_backtracking, this->m_maxBacktracks);
+                solver.setMaxRestarts(this->m_maxRestarts);
+                solver.setTimeBudget(this->m_timeBudget);
+                solver.setSeed(this->m_random.next());
+                solver.initialize(bottom - top, width, whole ? boundary : EBoundary::Fixed);
+
+                for (size_t row = top; row < bottom; ++row) {
+                    for (size_t col = left; col < right; ++col) {
+                        const bool inside = row >= region.top && row < region.bottom && col >= region.left && col < region.right;
+                        if (!inside) {
+                            solver.pin((row - top) * width + col - left, this->m_output[gridIndex(row, col)]);
+                        }
+                    }
+                }
+
+                for (const Pin& pin : this->m_pins) {
+                    // Distance of the pin past the first row and column of the region, across the wrap-around
+                    const size_t row = (pin.index / gridWidth + 2 * height - region.top) % height;
+                    const size_t col = (pin.index % gridWidth + 2 * gridWidth - region.left) % gridWidth;
+                    if (row < region.bottom - region.top && col < region.right - region.left) {
+                        solver.pin((row + region.top - top) * width + col + region.left - left, pin.option);
+                    }
+                }
+
+                if (!solver.run()) {
+                    return false;
+                }
+
+                for (size_t row = region.top; row < region.bottom; ++row) {
+                    for (size_t col = region.left; col < region.right; ++col) {
+                        setSolvedTile(gridIndex(row, col), solver.m_output[(row - top) * width + col - left]);
+                    }
+                }
+                return true;
+            }
+
+            /**
+             * @brief Overwrites a collapsed tile of a solved grid with another option.
+             * 
+             * Only the domain, counts and sums are rewritten: on a solved grid nothing is left to propagate.
+             */
+            void setSolvedTile(size_t index, size_t option) {
+                internal::DomainOps<0>::clear(domain(index), m_words);
+                internal::setBit(domain(index), option);
+                m_remaining[index] = 1;
+                m_sumWeights[index] = m_compiledRuleset->weights[option];
+                m_sumWeightLogWeights[index] = m_compiledRuleset->weightLogWeights[option];
+                m_output[index] = static_cast<TileIndex>(option);
+            }
+
+            /**
+             * @brief Sizes the per-cell buffers for the current topology and seeds the wave.
+             */
+            void initializeCells() {
+                assert(this->m_topology.size() > 0);
+
+                const size_t cells = this->m_topology.size();
+                this->m_output.resize(cells);
+
+                // The worklist never holds a cell twice, so the grid size bounds it
+                this->m_propagationStack.clear();
+                this->m_propagationStack.reserve(cells);
+                this->m_onStack.assign(cells, false);
+
+                this->m_pins.clear();
+                this->m_invalidRegion = {};
+
+                this->resetWave();
+                this->preparePropagationThreads();
+
+                this->m_initialized = true;
+            }
+
+            /**
+             * @brief Refills every tile with all options of the ruleset and clears the output.
+             */
+            void resetWave() {
+                const size_t tiles = numTiles();
+                this->m_words = this->m_compiledRuleset ? this->m_compiledRuleset->words : 0;
+
+                // Build one full domain and copy it into every cell of the plane; the second half of the
+                // scratch holds the removed bits in reviseWide()
+                this->m_scratch.assign(2 * m_words, 0);
+                for (size_t option = 0; option < tiles; ++option) {
+                    internal::setBit(m_scratch.data(), option);
+                }
+
+                const size_t cells = m_output.size();
+                this->m_wave.resize(cells * m_words);
+                for (size_t index = 0; index < cells; ++index) {
+                    std::copy(m_scratch.begin(), m_scratch.begin() + m_words, m_wave.begin() + index * m_words);
+                }
+
+                this->m_remaining.assign(cells, static_cast<uint16_t>(tiles));
+                this->m_sumWeights.assign(cells, m_compiledRuleset ? m_compiledRuleset->sumWeights : 0.0f);
+                this->m_sumWeightLogWeights.assign(cells, m_compiledRuleset ? m_compiledRuleset->sumWeightLogWeights : 0.0f);
+                this->m_collapsed.assign(internal::wordsForTiles(cells), 0);
+
+                std::fill(this->m_output.begin(), this->m_output.end(), NO_TILE);
+
+                clearDirty();
+                m_banStack.clear();
+                m_contradiction = false;
+
+                if (m_propagation == EPropagation::SupportCounting) {
+                    const Span<const uint16_t> supportCounts = m_compiledRuleset ? m_compiledRuleset->supportCounts : Span<const uint16_t>{};
+                    m_compatible.resize(cells * supportCounts.size());
+                    for (size_t index = 0; index < cells; ++index) {
+                        std::copy(supportCounts.begin(), supportCounts.end(), m_compatible.begin() + index * supportCounts.size());
+                    }
+                }
+                else {
+                    m_compatible.clear();
+                    m_compatible.shrink_to_fit();
+                }
+
+                m_entropyHeap.build(cells, [this](size_t index) { return entropyKey(index); });
+
+                m_trail.clear();
+                m_decisions.clear();
+                if (m_backtracking && m_trail.capacity() == 0) {
+                    m_trail.reserve(cells * std::min<size_t>(tiles, TRAIL_RESERVE_PER_TILE));
+                }
+
+                if (m_compiledRuleset && m_compiledRuleset->hasUnsupported) {
+                    queueUnsupported();
+                }
+
+                applyPins();
+            }
+
+            /**
+             * @brief Kinds of changes logged to the trail.
+             */
+            enum class ETrail : uint32_t {
+                Removal,  /**< Option value was removed from tile target. */
+                Counter,  /**< Support counter at offset target held value. */
+                Collapse, /**< Tile target was collapsed. */
+            };
+
+            struct TrailEntry {
+                uint64_t target;
+                uint32_t value;
+                ETrail kind;
+            };
+
+            /**
+             * @brief A collapse made by run() that can be taken back.
+             */
+            struct Decision {
+                size_t trailSize; /**< Size of the trail before the collapse. */
+                size_t index;
+                size_t option;
+            };
+
+            void record(ETrail kind, size_t target, size_t value) {
+                m_trail.push_back({ static_cast<uint64_t>(target), static_cast<uint32_t>(value), kind });
+            }
+
+            void recordCounter(const uint16_t* counter) {
+                record(ETrail::Counter, static_cast<size_t>(counter - m_compatible.data()), *counter);
+            }
+
+            /**
+             * @brief Rolls the wave back to the given trail size, undoing changes newest first.
+             */
+            void undoTo(size_t trailSize) {
+                while (m_trail.size() > trailSize) {
+                    const TrailEntry entry = m_trail.back();
+                    m_trail.pop_back();
+
+                    const size_t target = static_cast<size_t>(entry.target);
+                    switch (entry.kind) {
+                        case ETrail::Removal:
+                            internal::setBit(domain(target), entry.value);
+                            ++m_remaining[target];
+                            m_sumWeights[target] += m_compiledRuleset->weights[entry.value];
+                            m_sumWeightLogWeights[target] += m_compiledRuleset->weightLogWeights[entry.value];
+                            m_entropyHeap.update(target, entropyKey(target));
+                            break;
+                        case ETrail::Counter:
+                            m_compatible[target] = static_cast<uint16_t>(entry.value);
+                            break;
+                        case ETrail::Collapse:
+                            internal::resetBit(m_collapsed.data(), target);
+                            m_output[target] = NO_TILE;
+                            m_entropyHeap.insert(target);
+                            break;
+                    }
+                }
+            }
+
+            /**
+             * @brief Recovers from a contradiction by taking back the most recent decision.
+             * 
+             * The wave is rolled back to the state before the decision and the option chosen there is banned,
+             * which is itself logged as part of the previous decision. If that contradicts too, the next older
+             * decision is taken back.
+             * 
+             * @return True if a consistent wave was reached, false if the attempt has to be abandoned.
              */
-            std::vector<size_t> getNeighboringIndices(size_t currentIndex) {
-                std::vector<size_t> neighboringIndices;
+            bool backtrack() {
+                if (!m_backtracking) {
+                    return false;
+                }
+
+                while (!m_decisions.empty() && m_backtracks < m_maxBacktracks) {
+                    const Decision decision = m_decisions.back();
+                    m_decisions.pop_back();
+                    ++m_backtracks;
+                    countStat(m_stats.backtracks);
+
+                    undoTo(decision.trailSize);
+                    clearDirty();
+                    m_banStack.clear();
+                    m_contradiction = false;
+
+                    if (removeOption(decision.index, decision.option) && propagate()) {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            /**
+             * @brief Removes a single option from a tile and queues the tile for propagation.
+             * 
+             * @return False if the tile has no option left.
+             */
+            bool removeOption(size_t index, size_t option) {
+                if (m_propagation == EPropagation::SupportCounting) {
+                    ban(index, option);
+                    return m_remaining[index] != 0;
+                }
+
+                internal::resetBit(domain(index), option);
+                removeWeight(index, option);
+                if (m_backtracking) {
+                    record(ETrail::Removal, index, option);
+                }
+
+                --m_remaining[index];
+                m_entropyHeap.update(index, entropyKey(index));
+                pushDirty(index);
+
+                return m_remaining[index] != 0;
+            }
+
+            /**
+             * @brief Queues the removal of options that can never be supported where they are.
+             * 
+             * A tile that accepts no neighbour in some direction is only possible on the matching edge. Such
+             * options are queued here and removed by the next propagate().
+             */
+            void queueUnsupported() {
+                const size_t tiles = numTiles();
 
-                size_t row = currentIndex / this->m_gridWidth;
-                size_t col = currentIndex % this->m_gridWidth;
+                for (size_t index = 0; index < m_output.size(); ++index) {
+                    if (m_propagation != EPropagation::SupportCounting) {
+                        pushDirty(index);
+                        continue;
+                    }
 
-                if (row > 0) {
-                    neighboringIndices.push_back(currentIndex - this->m_gridWidth); // Up
+                    forEachNeighbor(index, [&](size_t neighborDirection, size_t) {
+                        // Counter d of a tile counts the supports of its neighbour opposite to d
+                        const size_t direction = opposite(neighborDirection);
+                        for (size_t option = 0; option < tiles; ++option) {
+                            if (m_compiledRuleset->supportCounts[option * NUM_OPTION_DIRECTIONS + direction] == 0 && internal::testBit(domain(index), option)) {
+                                ban(index, option);
+                            }
+                        }
+                    });
                 }
+            }
+
+            /**
+             * @brief Gets the key of a tile in the entropy heap.
+             * 
+             * The noise term is tiny compared to the entropies and in practice only orders ties.
+             */
+            float entropyKey(size_t index) const {
+                // splitmix64 finalizer, so neighbouring tiles get unrelated noise
+                uint64_t z = m_seed + (index + 1) * 0x9E3779B97F4A7C15ull;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                z ^= z >> 31;
+
+                const float noise = static_cast<float>(z >> 40) * (ENTROPY_NOISE / static_cast<float>(1u << 24));
+                return getEntropy(index) + noise;
+            }
+
+            uint64_t* domain(size_t index) {
+                return m_wave.data() + index * m_words;
+            }
+
+            const uint64_t* domain(size_t index) const {
+                return m_wave.data() + index * m_words;
+            }
+
+            size_t numTiles() const {
+                return this->m_compiledRuleset ? this->m_compiledRuleset->numTiles : 0;
+            }
 
-                if (row < this->m_gridHeight - 1) {
-                    neighboringIndices.push_back(currentIndex + this->m_gridWidth); // Down
+            template <size_t Words>
+            bool propagateWords() {
+                if (m_propagation == EPropagation::SupportCounting) {
+                    return propagateSupports<Words>();
                 }
 
-                if (col > 0) {
-                    neighboringIndices.push_back(currentIndex - 1);                 // Left
+                if (m_propagationThreads > 1 && !m_backtracking && m_propagationStack.size() >= m_parallelMinDirtyTiles) {
+                    return propagateParallel<Words>();
                 }
 
-                if (col < this->m_gridWidth - 1) {
-                    neighboringIndices.push_back(currentIndex + 1);                 // Right
+                while (!m_propagationStack.empty()) {
+                    if (stopRequested()) {
+                        clearDirty();
+                        return false;
+                    }
+
+                    size_t index = m_propagationStack.back();
+                    m_propagationStack.pop_back();
+                    m_onStack[index] = false;
+
+                    bool contradiction = false;
+                    forEachNeighbor(index, [&](size_t direction, size_t neighborIndex) {
+                        if (contradiction || !revise<Words>(neighborIndex, index, direction)) {
+                            return;
+                        }
+
+                        contradiction = m_remaining[neighborIndex] == 0;
+                        pushDirty(neighborIndex);
+                    });
+
+                    if (contradiction) {
+                        // Leave the worklist reusable for the next attempt
+                        clearDirty();
+                        return false;
+                    }
                 }
 
-                return neighboringIndices;
+                return true;
             }
 
-            // Utility function to generate a random integer
-            size_t random(int min, int max) const {
-                std::random_device rd;
-                std::default_random_engine generator(rd());
-                std::uniform_int_distribution<size_t> distribution(min, max); 
-                return distribution(generator);
+            /**
+             * @brief revise() for domains wider than the unrolled kernels, on the SIMD kernels of the CPU.
+             */
+            bool reviseWide(size_t index, size_t sourceIndex, size_t direction) {
+                uint64_t* supported = m_scratch.data();
+                uint64_t* removed = supported + m_words;
+
+                m_kernels->uniteMasks(supported, domain(sourceIndex), m_compiledRuleset->mask(direction, 0), m_words);
+                const size_t remaining = m_kernels->intersect(domain(index), supported, removed, m_words);
+                if (remaining == m_remaining[index]) {
+                    return false;
+                }
+
+                internal::DomainOps<0>::forEach(removed, m_words, [&](size_t option) {
+                    removeWeight(index, option);
+                    if (m_backtracking) {
+                        record(ETrail::Removal, index, option);
+                    }
+                });
+
+                m_remaining[index] = static_cast<uint16_t>(remaining);
+                m_entropyHeap.update(index, entropyKey(index));
+                return true;
             }
 
-        private:
-            size_t m_gridWidth{ 0 };
-            size_t m_gridHeight{ 0 };
+            /**
+             * @brief Threads and band buffers of propagateParallel(), kept from one propagation to the next.
+             */
+            struct ParallelPropagation {
+                explicit ParallelPropagation(size_t numThreads)
+                    : pool(numThreads) {}
+
+                internal::ThreadPool pool;
+                size_t cells{ 0 };
+                size_t words{ 0 };
+                size_t cellsPerBand{ 0 };
+                std::vector<std::vector<uint32_t>> worklists;  /**< Tiles of each band left to revise the neighbours of. */
+                std::vector<std::vector<uint32_t>> touched;    /**< Tiles whose domain each band narrowed. */
+                std::vector<std::vector<uint64_t>> scratch;    /**< Per band, the source domain and the union of its masks. */
+                std::vector<std::atomic<uint32_t>> inboxes;    /**< Per band, tiles handed over by the other bands. */
+                std::atomic<size_t> pending{ 0 };              /**< Tiles still queued somewhere or being processed. */
+                std::atomic<bool> failed{ false };
+                std::atomic<size_t> sleeping{ 0 };             /**< Bands waiting on wake for a tile or the end. */
+                std::mutex mutex;
+                std::condition_variable wake;
+            };
+
+            /**
+             * @brief Starts the propagation threads and sizes their buffers for the current wave.
+             */
+            void preparePropagationThreads() {
+                if (this->m_propagationThreads <= 1) {
+                    this->m_parallel.reset();
+                    return;
+                }
+
+                if (!this->m_parallel || this->m_parallel->pool.size() != this->m_propagationThreads) {
+                    this->m_parallel = std::make_shared<ParallelPropagation>(this->m_propagationThreads);
+                }
+
+                const size_t cells = this->m_output.size();
+                if (cells == 0) {
+                    return;
+                }
+
+                this->m_parallelQueued.assign(cells, 0);
+                this->m_parallelTouched.assign(cells, 0);
+                this->m_parallelNext.assign(cells, EMPTY_INBOX);
+
+                // Bands of consecutive indices: rows of a grid, layers of a box
+                ParallelPropagation& parallel = *this->m_parallel;
+                const size_t bands = std::min(this->m_propagationThreads, cells);
+                parallel.cells = cells;
+                parallel.words = this->m_words;
+                parallel.cellsPerBand = (cells + bands - 1) / bands;
+
+                // A band only queues its own tiles, each at most once
+                parallel.worklists.resize(bands);
+                parallel.touched.resize(bands);
+                for (size_t band = 0; band < bands; ++band) {
+                    parallel.worklists[band].clear();
+                    parallel.worklists[band].reserve(parallel.cellsPerBand);
+                    parallel.touched[band].clear();
+                    parallel.touched[band].reserve(parallel.cellsPerBand);
+                }
+                parallel.scratch.assign(bands, std::vector<uint64_t>(2 * this->m_words));
+                parallel.inboxes = std::vector<std::atomic<uint32_t>>(bands);
+            }
+
+            /**
+             * @brief AC-3 on several threads, see setPropagationThreads().
+             */
+            template <size_t Words>
+            bool propagateParallel() {
+                using Ops = internal::DomainOps<Words>;
+
+                const size_t cells = m_output.size();
+                assert(cells < EMPTY_INBOX);
+
+                // Normally done by initialize(); a new ruleset may have changed the width of the domains
+                if (!m_parallel || m_parallel->cells != cells || m_parallel->words != m_words) {
+                    preparePropagationThreads();
+                }
+
+                ParallelPropagation& parallel = *m_parallel;
+                parallel.pending.store(m_propagationStack.size(), std::memory_order_relaxed);
+                parallel.failed.store(false, std::memory_order_relaxed);
+                for (auto& inbox : parallel.inboxes) {
+                    inbox.store(EMPTY_INBOX, std::memory_order_relaxed);
+                }
+
+                for (size_t index : m_propagationStack) {
+                    m_onStack[index] = false;
+                    m_parallelQueued[index] = 1;
+                    parallel.worklists[index / parallel.cellsPerBand].push_back(static_cast<uint32_t>(index));
+                }
+                m_propagationStack.clear();
+
+                // Captures nothing but this, so the task fits in the small buffer of std::function
+                parallel.pool.parallelFor(parallel.worklists.size(), [this](size_t band, size_t) { propagateBand<Words>(band); });
+
+                // Rebuild the bookkeeping of every tile whose domain shrank
+                bool consistent = !parallel.failed.load();
+                for (auto& list : parallel.touched) {
+                    for (uint32_t index : list) {
+                        m_parallelTouched[index] = 0;
+
+                        float sumWeights = 0.0f;
+                        float sumWeightLogWeights = 0.0f;
+                        Ops::forEach(domain(index), m_words, [&](size_t option) {
+                            sumWeights += m_compiledRuleset->weights[option];
+                            sumWeightLogWeights += m_compiledRuleset->weightLogWeights[option];
+                        });
+
+                        const size_t remaining = Ops::count(domain(index), m_words);
+                        countStat(m_stats.bans, m_remaining[index] - remaining);
+                        m_remaining[index] = static_cast<uint16_t>(remaining);
+                        m_sumWeights[index] = sumWeights;
+                        m_sumWeightLogWeights[index] = sumWeightLogWeights;
+                        m_entropyHeap.update(index, entropyKey(index));
+
+                        consistent = consistent && m_remaining[index] != 0;
+                    }
+                    list.clear();
+                }
+
+                if (!consistent) {
+                    // Tiles may be left on worklists that were abandoned
+                    for (auto& worklist : parallel.worklists) {
+                        worklist.clear();
+                    }
+                    std::fill(m_parallelQueued.begin(), m_parallelQueued.end(), uint8_t{ 0 });
+                }
+
+                return consistent;
+            }
+
+            /**
+             * @brief Works through the dirty tiles of one band until no band has any left.
+             */
+            template <size_t Words>
+            void propagateBand(size_t band) {
+                using Ops = internal::DomainOps<Words>;
+
+                ParallelPropagation& parallel = *m_parallel;
+                const size_t words = internal::DomainWidth<Words>::words(m_words);
+                uint64_t* source = parallel.scratch[band].data();
+                uint64_t* supported = source + m_words;
+                std::vector<uint32_t>& worklist = parallel.worklists[band];
+
+                while (!parallel.failed.load(std::memory_order_relaxed)) {
+                    if (worklist.empty()) {
+                        for (uint32_t index = parallel.inboxes[band].exchange(EMPTY_INBOX, std::memory_order_acquire); index != EMPTY_INBOX; index = m_parallelNext[index]) {
+                            worklist.push_back(index);
+                        }
+                    }
+
+                    if (worklist.empty()) {
+                        if (!waitForBandWork(band)) {
+                            return;
+                        }
+                        continue;
+                    }
+
+                    if (stopRequested()) {
+                        failBands();
+                        return;
+                    }
+
+                    const size_t index = worklist.back();
+                    worklist.pop_back();
+
+                    // Unqueue before reading, so that a concurrent change to the tile queues it again
+                    internal::atomicExchange(&m_parallelQueued[index], 0);
+                    for (size_t w = 0; w < words; ++w) {
+                        source[w] = internal::atomicLoad(domain(index) + w);
+                    }
+
+                    forEachNeighbor(index, [&](size_t direction, size_t neighborIndex) {
+                        if (parallel.failed.load(std::memory_order_relaxed)) {
+                            return;
+                        }
+
+                        Ops::clear(supported, m_words);
+                        Ops::forEach(source, m_words, [&](size_t sourceOption) {
+                            Ops::unite(supported, m_compiledRuleset->mask(direction, sourceOption), m_words);
+                        });
+
+                        uint64_t* target = domain(neighborIndex);
+                        uint64_t removed = 0;
+                        uint64_t left = 0;
+                        for (size_t w = 0; w < words; ++w) {
+                            uint64_t value = internal::atomicLoad(target + w);
+                            if ((value & ~supported[w]) != 0) {
+                                value = internal::atomicFetchAnd(target + w, supported[w]);
+                                removed |= value & ~supported[w];
+                            }
+                            left |= value & supported[w];
+                        }
+
+                        if (removed == 0) {
+                            return;
+                        }
+
+                        if (internal::atomicExchange(&m_parallelTouched[neighborIndex], 1) == 0) {
+                            parallel.touched[band].push_back(static_cast<uint32_t>(neighborIndex));
+                        }
+
+                        // Words narrowed by other threads may be stale here; the rebuild catches the rest
+                        if (left == 0) {
+                            failBands();
+                            return;
+                        }
+
+                        enqueueBandTile(band, neighborIndex);
+                    });
+
+                    if (parallel.pending.fetch_sub(1, std::memory_order_seq_cst) == 1) {
+                        wakeBands();
+                    }
+                }
+            }
+
+            /**
+             * @brief Queues a tile whose domain shrank with the band that owns it.
+             */
+            void enqueueBandTile(size_t band, size_t index) {
+                if (internal::atomicExchange(&m_parallelQueued[index], 1) != 0) {
+                    return;
+                }
+
+                ParallelPropagation& parallel = *m_parallel;
+                parallel.pending.fetch_add(1, std::memory_order_relaxed);
+
+                const size_t owner = index / parallel.cellsPerBand;
+                if (owner == band) {
+                    parallel.worklists[band].push_back(static_cast<uint32_t>(index));
+                    return;
+                }
+
+                // Push onto the owner's inbox, a lock-free stack linked through m_parallelNext
+                std::atomic<uint32_t>& inbox = parallel.inboxes[owner];
+                uint32_t head = inbox.load(std::memory_order_relaxed);
+                do {
+                    m_parallelNext[index] = head;
+                } while (!inbox.compare_exchange_weak(head, static_cast<uint32_t>(index), std::memory_order_seq_cst, std::memory_order_relaxed));
+
+                wakeBands();
+            }
+
+            /**
+             * @brief Sleeps until another band hands this one a tile, or the propagation is over.
+             * 
+             * @return True if the inbox of the band holds tiles.
+             */
+            bool waitForBandWork(size_t band) {
+                ParallelPropagation& parallel = *m_parallel;
+                const auto hasWork = [&parallel, band]() {
+                    return parallel.inboxes[band].load(std::memory_order_seq_cst) != EMPTY_INBOX;
+                };
+                const auto done = [&parallel]() {
+                    return parallel.pending.load(std::memory_order_seq_cst) == 0 || parallel.failed.load(std::memory_order_seq_cst);
+                };
+
+                std::unique_lock<std::mutex> lock(parallel.mutex);
+                parallel.sleeping.fetch_add(1, std::memory_order_seq_cst);
+                parallel.wake.wait(lock, [&]() { return hasWork() || done(); });
+                parallel.sleeping.fetch_sub(1, std::memory_order_relaxed);
+                return !done();
+            }
+
+            /**
+             * @brief Wakes the sleeping bands; the sequentially consistent accesses on both sides keep a band
+             * from going to sleep on work or an end it has not seen.
+             */
+            void wakeBands() {
+                ParallelPropagation& parallel = *m_parallel;
+                if (parallel.sleeping.load(std::memory_order_seq_cst) == 0) {
+                    return;
+                }
+
+                // Taking the lock orders the notification after the check of a band that is about to wait
+                { std::lock_guard<std::mutex> lock(parallel.mutex); }
+                parallel.wake.notify_all();
+            }
+
+            void failBands() {
+                m_parallel->failed.store(true, std::memory_order_seq_cst);
+                wakeBands();
+            }
+
+            /**
+             * @brief Removes the options of a tile that have no support left in a neighbouring tile.
+             * 
+             * The options supported by the source tile are the union of the compiled masks of its remaining
+             * options; intersecting that union with the domain drops everything else.
+             * 
+             * @param index Index of the tile to revise.
+             * @param sourceIndex Index of the neighbouring tile that changed.
+             * @param direction Direction in which the revised tile lies, seen from the source tile.
+             * @return True if the domain of the revised tile shrank.
+             */
+            template <size_t Words>
+            bool revise(size_t index, size_t sourceIndex, size_t direction) {
+                if constexpr (Words == 0) {
+                    return reviseWide(index, sourceIndex, direction);
+                }
+
+                using Ops = internal::DomainOps<Words>;
+
+                uint64_t* supported = m_scratch.data();
+                Ops::clear(supported, m_words);
+                Ops::forEach(domain(sourceIndex), m_words, [&](size_t sourceOption) {
+                    Ops::unite(supported, m_compiledRuleset->mask(direction, sourceOption), m_words);
+                });
+
+                const size_t removed = Ops::intersect(domain(index), supported, m_words, [&](size_t option) {
+                    removeWeight(index, option);
+                    if (m_backtracking) {
+                        record(ETrail::Removal, index, option);
+                    }
+                });
+
+                if (removed == 0) {
+                    return false;
+                }
+
+                m_remaining[index] = static_cast<uint16_t>(m_remaining[index] - removed);
+                m_entropyHeap.update(index, entropyKey(index));
+                return true;
+            }
+
+            /**
+             * @brief Takes the weight of a removed option out of the entropy sums of a tile.
+             */
+            void removeWeight(size_t index, size_t option) {
+                m_sumWeights[index] -= m_compiledRuleset->weights[option];
+                m_sumWeightLogWeights[index] -= m_compiledRuleset->weightLogWeights[option];
+                countStat(m_stats.bans);
+            }
+
+            /**
+             * @brief Removes an option from a tile and queues the removal for support propagation.
+             */
+            void ban(size_t index, size_t option) {
+                internal::resetBit(domain(index), option);
+                removeWeight(index, option);
+
+                // The counters of a banned option are never looked at again; zeroing them keeps them from
+                // triggering a second ban
+                uint16_t* counts = &m_compatible[(index * numTiles() + option) * NUM_OPTION_DIRECTIONS];
+                if (m_backtracking) {
+                    record(ETrail::Removal, index, option);
+                    for (size_t direction = 0; direction < NUM_OPTION_DIRECTIONS; ++direction) {
+                        recordCounter(counts + direction);
+                    }
+                }
+                std::fill(counts, counts + NUM_OPTION_DIRECTIONS, uint16_t{ 0 });
+
+                if (--m_remaining[index] == 0) {
+                    m_contradiction = true;
+                }
+                m_entropyHeap.update(index, entropyKey(index));
+
+                m_banStack.emplace_back(index, option);
+                trackQueueSize(m_banStack.size());
+            }
+
+            /**
+             * @brief Drains the ban stack, decrementing the support counters of the neighbouring tiles.
+             */
+            template <size_t Words>
+            bool propagateSupports() {
+                const size_t tiles = numTiles();
+
+                while (!m_banStack.empty() && !m_contradiction) {
+                    if (stopRequested()) {
+                        m_contradiction = true;
+                        break;
+                    }
+
+                    const auto [index, option] = m_banStack.back();
+                    m_banStack.pop_back();
+
+                    forEachNeighbor(index, [&](size_t direction, size_t neighborIndex) {
+                        uint16_t* counts = &m_compatible[neighborIndex * tiles * NUM_OPTION_DIRECTIONS + direction];
+                        internal::DomainOps<Words>::forEach(m_compiledRuleset->mask(direction, option), m_words, [&](size_t neighborOption) {
+                            uint16_t& count = counts[neighborOption * NUM_OPTION_DIRECTIONS];
+                            if (count == 0) {
+                                return;
+                            }
+
+                            if (m_backtracking) {
+                                recordCounter(&count);
+                            }
+
+                            if (--count == 0) {
+                                ban(neighborIndex, neighborOption);
+                            }
+                        });
+                    });
+                }
+
+                if (m_contradiction) {
+                    m_banStack.clear();
+                    m_contradiction = false;
+                    return false;
+                }
+
+                return true;
+            }
+
+            void pushDirty(size_t index) {
+                if (!m_onStack[index]) {
+                    m_onStack[index] = true;
+                    m_propagationStack.push_back(index);
+                    trackQueueSize(m_propagationStack.size());
+                }
+            }
+
+            /**
+             * @brief Adds one to a counter of SolverStats, if statistics are compiled in.
+             */
+            void countStat(size_t& counter, size_t amount = 1) {
+                if constexpr (STATS_ENABLED) {
+                    counter += amount;
+                }
+            }
+
+            void trackQueueSize(size_t size) {
+                if constexpr (STATS_ENABLED) {
+                    m_stats.maxQueueSize = std::max(m_stats.maxQueueSize, size);
+                }
+            }
+
+            /**
+             * @brief Runs a phase of run(), adding its duration to a timer of SolverStats if statistics are
+             * compiled in.
+             */
+            template <typename Fn>
+            std::invoke_result_t<Fn&> timed(uint64_t& nanoseconds, Fn&& phase) {
+                if constexpr (STATS_ENABLED) {
+                    const auto start = std::chrono::steady_clock::now();
+                    auto result = phase();
+                    nanoseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+                    return result;
+                }
+                else {
+                    return phase();
+                }
+            }
+
+            void clearDirty() {
+                for (size_t index : m_propagationStack) {
+                    m_onStack[index] = false;
+                }
+                m_propagationStack.clear();
+            }
+
+            static constexpr bool IS_GRID = std::is_same_v<Topology, QuadTopology>;
+
+            Topology m_topology;                    /**< Cells and neighbours set by initialize(). */
+
+            // The wave is stored as planes so that each pass only touches the bytes it needs
+            std::vector<uint64_t> m_wave;           /**< Domain of every tile, m_words words each. */
+            std::vector<uint16_t> m_remaining;      /**< Number of options left in every tile. */
+            std::vector<float> m_sumWeights;        /**< Sum of w over the options left in every tile. */
+            std::vector<float> m_sumWeightLogWeights; /**< Sum of w * log(w) over the options left in every tile. */
+            std::vector<uint64_t> m_collapsed;      /**< One bit per tile, set once the tile is collapsed. */
+            size_t m_words{ 0 };
+            std::vector<uint64_t> m_scratch;        /**< Two domains worth of scratch words. */
+            const internal::DomainKernels* m_kernels{ &internal::domainKernels() }; /**< Kernels for wide domains. */
+            std::vector<TileIndex> m_output;        /**< Tile of every collapsed cell, NO_TILE elsewhere. */
+            std::shared_ptr<const Ruleset> m_ruleset;
+            std::shared_ptr<const CompiledRuleset> m_compiledRuleset;
+            FixedKernel m_fixedKernel{ nullptr };   /**< Kernel for m_fixedRuleset, see setFixedKernel(). */
+            std::shared_ptr<const CompiledRuleset> m_fixedRuleset;
+
+            std::vector<size_t> m_propagationStack; /**< Worklist of tiles whose neighbours still have to be revised. */
+            std::vector<bool> m_onStack;            /**< Marks the tiles currently on the worklist. */
+
+            EPropagation m_propagation{ EPropagation::ArcConsistency };
+            std::vector<uint16_t> m_compatible;     /**< Support counters, [tile][option][direction], SupportCounting only. */
+            std::vector<std::pair<size_t, size_t>> m_banStack; /**< Banned (tile, option) pairs still to propagate. */
+            bool m_contradiction{ false };
+
+            static constexpr float ENTROPY_NOISE = 1e-4f;
+            internal::EntropyHeap m_entropyHeap;    /**< Uncollapsed tiles ordered by entropy. */
+            uint64_t m_seed{ 0 };
+
+            static constexpr size_t DEFAULT_MAX_RESTARTS = 10;
+            static constexpr size_t TIME_CHECK_INTERVAL = 64;
+            size_t m_maxRestarts{ DEFAULT_MAX_RESTARTS };
+            std::chrono::nanoseconds m_timeBudget{ 0 };
+            size_t m_attempts{ 0 };
+
+            static constexpr size_t DEFAULT_MAX_BACKTRACKS = 1000;
+            static constexpr size_t TRAIL_RESERVE_PER_TILE = 4;
+            bool m_backtracking{ false };
+            size_t m_maxBacktracks{ DEFAULT_MAX_BACKTRACKS };
+            size_t m_backtracks{ 0 };
+            std::vector<TrailEntry> m_trail;        /**< Undo log of every change since the wave was seeded. */
+            std::vector<Decision> m_decisions;      /**< Collapses of run() that can still be taken back. */
+            Random m_random;                        /**< Generator owned by the solver. */
+            const std::atomic<bool>* m_stopFlag{ nullptr }; /**< Cancels run() and propagate() when raised. */
+
+            static constexpr size_t DEFAULT_PARALLEL_MIN_DIRTY_TILES = 4096;
+            static constexpr uint32_t EMPTY_INBOX = std::numeric_limits<uint32_t>::max();
+            size_t m_propagationThreads{ 0 };
+            size_t m_parallelMinDirtyTiles{ DEFAULT_PARALLEL_MIN_DIRTY_TILES };
+            std::shared_ptr<ParallelPropagation> m_parallel; /**< Threads of the parallel propagation, if enabled. */
+            std::vector<uint8_t> m_parallelQueued;  /**< Parallel propagation: the tile is on a worklist or an inbox. */
+            std::vector<uint8_t> m_parallelTouched; /**< Parallel propagation: the domain of the tile shrank. */
+            std::vector<uint32_t> m_parallelNext;   /**< Parallel propagation: next tile in the same inbox. */
+            std::vector<uint32_t> m_candidates;     /**< Scratch: options of the tile being collapsed. */
+            std::vector<float> m_cumulativeWeights; /**< Scratch: running weight sums of m_candidates. */
+
+            SolverStats m_stats;                    /**< Filled by run() when built with WFC_SOLVER_STATS=1. */
+            CallbackFn m_progressCallback;
+            size_t m_progressInterval{ 0 };         /**< Collapses between two calls of m_progressCallback; 0 if unset. */
+
+            std::vector<Pin> m_pins;                /**< Pinned tiles, sorted by index. */
+            Region m_invalidRegion;                 /**< Area resolve() has to draw again; empty if bottom == top. */
+            size_t m_resolveMargin{ DEFAULT_RESOLVE_MARGIN };
+
+            EStatus m_status{ EStatus::Ok };        /**< Outcome of the last run, resolve or load. */
 
-            std::vector<Tile> m_wave;
-            std::vector<size_t> m_output;
-            std::vector<Tile> m_ruleset;
             bool m_initialized{ false }; /**< Flag indicating whether the algorithm is initialized. */
         };
 
+        using WaveFunctionCollapse2DImpl = WaveFunctionCollapseImpl<QuadTopology>;
+
     } // end of namespace internal
 
     // User-facing interface class
     class WaveFunctionCollapse2D : public internal::WaveFunctionCollapse2DImpl {
     public:
-        using internal::WaveFunctionCollapse2DImpl::WaveFunctionCollapse2DImpl;
+        using internal::WaveFunctionCollapse2DImpl::WaveFunctionCollapseImpl;
+    };
+
+    /**
+     * @brief Solver for boxes of voxels, see CubeTopology.
+     */
+    class WaveFunctionCollapse3D : public internal::WaveFunctionCollapseImpl<CubeTopology> {
+    public:
+        using internal::WaveFunctionCollapseImpl<CubeTopology>::WaveFunctionCollapseImpl;
+    };
+
+    /**
+     * @brief Solver for hex maps, see HexTopology.
+     */
+    class WaveFunctionCollapseHex : public internal::WaveFunctionCollapseImpl<HexTopology> {
+    public:
+        using internal::WaveFunctionCollapseImpl<HexTopology>::WaveFunctionCollapseImpl;
+    };
+
+    /**
+     * @brief Solver for any graph of cells given as an adjacency list, see GraphTopology.
+     */
+    template <size_t Directions>
+    class WaveFunctionCollapseGraph : public internal::WaveFunctionCollapseImpl<GraphTopology<Directions>> {
+    public:
+        using internal::WaveFunctionCollapseImpl<GraphTopology<Directions>>::WaveFunctionCollapseImpl;
     };
 
 } // end of namespace wfc2d
\ No newline at end of file
@@ -0,0 +1,86 @@
+// Replaces the global allocation functions of the test binaries to count allocations. They live in their own
+// translation unit so that the compiler never sees free() inlined into code that allocated with new.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+    std::atomic<size_t> g_allocations{ 0 };
+
+    void* allocate(size_t size) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        if (void* pointer = std::malloc(size > 0 ? size : 1)) {
+            return pointer;
+        }
+        throw std::bad_alloc();
+    }
+
+    void* allocateAligned(size_t size, std::align_val_t alignment) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+
+        // aligned_alloc() wants a size that is a multiple of the alignment
+        const size_t align = static_cast<size_t>(alignment);
+        const size_t rounded = (size + align - 1) / align * align;
+        if (void* pointer = std::aligned_alloc(align, rounded > 0 ? rounded : align)) {
+            return pointer;
+        }
+        throw std::bad_alloc();
+    }
+
+} // end of anonymous namespace
+
+// Every allocation of the test binary, for the tests that check that a path does not allocate
+size_t allocationCount() {
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return allocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
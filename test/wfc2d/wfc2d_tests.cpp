@@ -1,5 +1,161 @@
 #include <gtest/gtest.h>
 #include <wfc/wfc2d.hpp>
+#include <wfc/batch.hpp>
+#include <wfc/chunked.hpp>
+#include <wfc/overlapping.hpp>
+#include <wfc/static_wfc2d.hpp>
+#include <wfc/streaming.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Every allocation of the test binary, counted by allocation_counter.cpp
+size_t allocationCount();
+
+namespace {
+
+    // Writes a ruleset of numTiles tiles where tile i only accepts tiles i - 1, i and i + 1 (wrapping around)
+    // next to it, in every direction
+    std::string writeBandRuleset(size_t numTiles) {
+        const std::string filepath = "band_ruleset_" + std::to_string(numTiles) + ".txt";
+        std::ofstream output(filepath);
+
+        for (size_t tile = 0; tile < numTiles; ++tile) {
+            const size_t previous = (tile + numTiles - 1) % numTiles;
+            const size_t next = (tile + 1) % numTiles;
+
+            output << "[TILE_" << tile << "]\n";
+            for (const char* direction : { "up", "down", "left", "right" }) {
+                output << direction << "=" << previous << " " << tile << " " << next << "\n";
+            }
+            output << "\n";
+        }
+
+        return filepath;
+    }
+
+    // Checks that every pair of neighbours in the output is allowed by the rules of both tiles
+    template <typename Solver, typename Tiles>
+    void expectValidOutput(const Solver& solver, const Tiles& tiles, size_t rows, size_t cols) {
+        for (size_t index = 0; index < rows * cols; ++index) {
+            ASSERT_LT(solver.at(index), tiles.size()) << "Tile " << index << " was not collapsed";
+        }
+
+        for (size_t row = 0; row < rows; ++row) {
+            for (size_t col = 0; col < cols; ++col) {
+                const size_t tile = solver.at(row * cols + col);
+                if (col + 1 < cols) {
+                    const size_t right = solver.at(row * cols + col + 1);
+                    EXPECT_TRUE(tiles[tile].options[3].test(right) && tiles[right].options[2].test(tile)) << "Row " << row << ", column " << col;
+                }
+                if (row + 1 < rows) {
+                    const size_t down = solver.at((row + 1) * cols + col);
+                    EXPECT_TRUE(tiles[tile].options[1].test(down) && tiles[down].options[0].test(tile)) << "Row " << row << ", column " << col;
+                }
+            }
+        }
+    }
+
+    // Checks every pair of neighbours of any topology, in both directions
+    template <typename Solver, typename Tiles>
+    void expectValidNeighbors(const Solver& solver, const Tiles& tiles) {
+        const auto& topology = solver.getTopology();
+        for (size_t index = 0; index < topology.size(); ++index) {
+            ASSERT_LT(solver.at(index), tiles.size()) << "Tile " << index << " was not collapsed";
+        }
+
+        for (size_t index = 0; index < topology.size(); ++index) {
+            const size_t tile = solver.at(index);
+            topology.forEachNeighbor(index, [&](size_t direction, size_t neighbor) {
+                const size_t other = solver.at(neighbor);
+                EXPECT_TRUE(tiles[tile].options[direction].test(other) && tiles[other].options[topology.opposite(direction)].test(tile))
+                    << "Cell " << index << ", direction " << direction;
+            });
+        }
+    }
+
+    // Checks that every neighbour of a cell lists it back in the opposite direction, and counts the links
+    template <typename Topology>
+    size_t countSymmetricLinks(const Topology& topology) {
+        size_t links = 0;
+        for (size_t index = 0; index < topology.size(); ++index) {
+            topology.forEachNeighbor(index, [&](size_t direction, size_t neighbor) {
+                EXPECT_LT(neighbor, topology.size()) << "Cell " << index << ", direction " << direction;
+                size_t back = 0;
+                topology.forEachNeighbor(neighbor, [&](size_t otherDirection, size_t other) {
+                    back += otherDirection == Topology::opposite(direction) && other == index ? 1 : 0;
+                });
+                EXPECT_EQ(back, 1u) << "Cell " << index << ", direction " << direction;
+                ++links;
+            });
+        }
+        return links;
+    }
+
+    // Tiles that must differ from all their neighbours, for any number of directions
+    template <typename Solver>
+    std::vector<typename Solver::Tile> makeColoringTiles(size_t numColors) {
+        std::vector<typename Solver::Tile> tiles(numColors);
+        for (size_t tile = 0; tile < numColors; ++tile) {
+            for (auto& options : tiles[tile].options) {
+                for (size_t other = 0; other < numColors; ++other) {
+                    if (other != tile) {
+                        options.set(other);
+                    }
+                }
+            }
+        }
+        return tiles;
+    }
+
+    // Writes a ruleset where no two neighbouring cells may hold the same of three tiles (3-colouring),
+    // which runs into contradictions a lot
+    std::string writeColoringRuleset() {
+        const std::string filepath = "coloring_ruleset.txt";
+        std::ofstream output(filepath);
+
+        for (size_t tile = 0; tile < 3; ++tile) {
+            output << "[TILE_" << tile << "]\n";
+            for (const char* direction : { "up", "down", "left", "right" }) {
+                output << direction << "=" << (tile + 1) % 3 << " " << (tile + 2) % 3 << "\n";
+            }
+            output << "\n";
+        }
+
+        return filepath;
+    }
+
+    // Same rules as writeBandRuleset(8), known at compile time
+    constexpr uint64_t bandOptions(size_t tile) {
+        return (uint64_t{ 1 } << (tile + 7) % 8) | (uint64_t{ 1 } << tile) | (uint64_t{ 1 } << (tile + 1) % 8);
+    }
+
+    constexpr uint64_t BAND_ROW[8] = { bandOptions(0), bandOptions(1), bandOptions(2), bandOptions(3), bandOptions(4), bandOptions(5), bandOptions(6), bandOptions(7) };
+
+    constexpr wfc2d::StaticRuleset<8> STATIC_BAND_RULESET = {
+        { { BAND_ROW[0], BAND_ROW[1], BAND_ROW[2], BAND_ROW[3], BAND_ROW[4], BAND_ROW[5], BAND_ROW[6], BAND_ROW[7] },
+          { BAND_ROW[0], BAND_ROW[1], BAND_ROW[2], BAND_ROW[3], BAND_ROW[4], BAND_ROW[5], BAND_ROW[6], BAND_ROW[7] },
+          { BAND_ROW[0], BAND_ROW[1], BAND_ROW[2], BAND_ROW[3], BAND_ROW[4], BAND_ROW[5], BAND_ROW[6], BAND_ROW[7] },
+          { BAND_ROW[0], BAND_ROW[1], BAND_ROW[2], BAND_ROW[3], BAND_ROW[4], BAND_ROW[5], BAND_ROW[6], BAND_ROW[7] } },
+        { 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0 }
+    };
+
+    // Tile 1 lists tile 0 to its right, but tile 0 does not list tile 1 to its left, so the pair is dropped
+    constexpr wfc2d::StaticRuleset<2> STATIC_ONE_SIDED_RULESET = {
+        { { 3, 3 }, { 3, 3 }, { 1, 3 }, { 3, 3 } },
+        { 1.0, 2.0 }
+    };
+
+} // end of anonymous namespace
 
 // Test case to verify the initialization of WaveFunctionCollapse2D
 TEST(WFC2DTest, InitializationTest) {
@@ -98,6 +254,48 @@ TEST(WFC2DTest, NeighboringIndicesTest) {
     EXPECT_EQ(neighbors[2], 2); // Right
 }
 
+TEST(WFC2DTest, ForEachNeighborTest) {
+    // Degenerate grids exercise the edge path in every direction
+    const size_t shapes[][2] = { { 1, 1 }, { 1, 5 }, { 5, 1 }, { 2, 2 }, { 4, 7 } };
+
+    for (const auto& shape : shapes) {
+        const size_t rows = shape[0];
+        const size_t cols = shape[1];
+
+        wfc2d::WaveFunctionCollapse2D wfc2d;
+        wfc2d.initialize(rows, cols);
+
+        for (size_t index = 0; index < rows * cols; ++index) {
+            const size_t row = index / cols;
+            const size_t col = index % cols;
+
+            std::vector<size_t> expected;
+            if (row > 0) expected.push_back(index - cols);
+            if (row + 1 < rows) expected.push_back(index + cols);
+            if (col > 0) expected.push_back(index - 1);
+            if (col + 1 < cols) expected.push_back(index + 1);
+
+            std::vector<size_t> visited;
+            std::vector<size_t> directions;
+            wfc2d.forEachNeighbor(index, [&](size_t direction, size_t neighbor) {
+                directions.push_back(direction);
+                visited.push_back(neighbor);
+            });
+
+            EXPECT_EQ(visited, expected) << rows << "x" << cols << " cell " << index;
+            EXPECT_TRUE(std::is_sorted(directions.begin(), directions.end()));
+            EXPECT_EQ(wfc2d.getNeighboringIndices(index), expected);
+
+            const auto neighbors = wfc2d.getNeighbors(index);
+            ASSERT_EQ(neighbors.count, expected.size());
+            for (size_t i = 0; i < neighbors.count; ++i) {
+                EXPECT_EQ(neighbors.indices[i], expected[i]);
+                EXPECT_EQ(neighbors.directions[i], directions[i]);
+            }
+        }
+    }
+}
+
 TEST(WFC2DTest, ParsesTileOptionsCorrectly) {
     wfc2d::WaveFunctionCollapse2D wfc2d;
 
@@ -141,7 +339,7 @@ TEST(WFC2DTest, ParsesTileOptionsCorrectly) {
 
     // Call the parseRulesFromFile function with the test file path
     std::string testFilePath = "test_tile_options.txt";
-    const auto tiles = wfc2d.parseRulesFromFile(testFilePath);
+    const auto& tiles = wfc2d.parseRulesFromFile(testFilePath);
     
     wfc2d.run();
 
@@ -213,7 +411,7 @@ TEST(WFC2DTest, PrintDataTest) {
 
     // Call the parseRulesFromFile function with the test file path
     std::string testFilePath = "test_tile_options.txt";
-    const auto tiles = wfc2d.parseRulesFromFile(testFilePath);
+    wfc2d.parseRulesFromFile(testFilePath);
     
     wfc2d.run();
 
@@ -221,8 +419,2397 @@ TEST(WFC2DTest, PrintDataTest) {
     wfc2d.print();
 }
 
+// Test case to verify that collapsing a tile narrows its neighbours to the compatible options
+TEST(WFC2DTest, PropagationNarrowsNeighborsTest) {
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+
+    const int ROWS = 3;
+    const int COLS = 3;
+
+    wfc2d.initialize(ROWS, COLS);
+    wfc2d.parseRulesFromFile("test_tile_options.txt");
+
+    ASSERT_TRUE(wfc2d.collapse(4, 1));
+    ASSERT_TRUE(wfc2d.propagate());
+
+    EXPECT_EQ(wfc2d.getDomain(4).to_ulong(), 0b0010); // Collapsed to TILE_1
+    EXPECT_EQ(wfc2d.getDomain(1).to_ulong(), 0b0001); // Up: only TILE_0
+    EXPECT_EQ(wfc2d.getDomain(7).to_ulong(), 0b0001); // Down: only TILE_0
+    EXPECT_EQ(wfc2d.getDomain(3).to_ulong(), 0b1011); // Left: TILE_2 only allows TILE_0 on its right
+    EXPECT_EQ(wfc2d.getDomain(5).to_ulong(), 0b1111); // Right: everything
+    EXPECT_EQ(wfc2d.at(4), 1);
+
+    // An option that was removed can no longer be chosen
+    EXPECT_FALSE(wfc2d.collapse(1, 2));
+}
+
+// Test case to verify that propagation leaves every pair of neighbours arc consistent
+TEST(WFC2DTest, PropagationReachesFixpointTest) {
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+
+    const int ROWS = 8;
+    const int COLS = 8;
+
+    wfc2d.initialize(ROWS, COLS);
+    const auto& tiles = wfc2d.parseRulesFromFile("test_tile_options.txt");
+
+    const auto isCompatible = [&tiles](size_t a, size_t b, size_t direction) {
+        return tiles[a].options[direction].test(b) && tiles[b].options[direction ^ 1].test(a);
+    };
+
+    const size_t collapsedIndices[] = { 0, 9, 27, 36, 63 };
+    for (size_t index : collapsedIndices) {
+        ASSERT_TRUE(wfc2d.collapse(index));
+        ASSERT_TRUE(wfc2d.propagate());
+    }
+
+    for (size_t index = 0; index < ROWS * COLS; ++index) {
+        const size_t row = index / COLS;
+        const size_t col = index % COLS;
+        const std::pair<bool, size_t> neighbors[] = {
+            { row > 0, index - COLS }, { row < ROWS - 1, index + COLS },
+            { col > 0, index - 1 },    { col < COLS - 1, index + 1 },
+        };
+
+        for (size_t direction = 0; direction < 4; ++direction) {
+            if (!neighbors[direction].first) {
+                continue;
+            }
+
+            const auto& domain = wfc2d.getDomain(index);
+            const auto& neighborDomain = wfc2d.getDomain(neighbors[direction].second);
+            for (size_t option = 0; option < tiles.size(); ++option) {
+                if (!neighborDomain.test(option)) {
+                    continue;
+                }
+
+                bool supported = false;
+                for (size_t source = 0; source < tiles.size(); ++source) {
+                    supported |= domain.test(source) && isCompatible(source, option, direction);
+                }
+                EXPECT_TRUE(supported) << "Option " << option << " of Tile " << neighbors[direction].second << " has no support in Tile " << index;
+            }
+        }
+    }
+}
+
+// Test case to verify the compiled per-direction masks combine the rules of both tiles
+TEST(WFC2DTest, CompiledRulesetTest) {
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+
+    ASSERT_EQ(wfc2d.getCompiledRuleset(), nullptr);
+
+    wfc2d.parseRulesFromFile("test_tile_options.txt");
+    const auto compiled = wfc2d.getCompiledRuleset();
+
+    ASSERT_NE(compiled, nullptr);
+    ASSERT_EQ(compiled->numTiles, 4);
+    ASSERT_EQ(compiled->words, 1);
+
+    // up, down, left, right
+    EXPECT_EQ(compiled->mask(0, 0)[0], 0b1111); // TILE_1 lists TILE_0 up and down
+    EXPECT_EQ(compiled->mask(0, 1)[0], 0b0001);
+    EXPECT_EQ(compiled->mask(2, 1)[0], 0b1011); // TILE_2 only accepts TILE_0 on its right
+    EXPECT_EQ(compiled->mask(3, 2)[0], 0b0001);
+    EXPECT_EQ(compiled->mask(3, 0)[0], 0b1111);
+}
+
+// Test case to verify a compiled ruleset can be shared by several solvers
+TEST(WFC2DTest, SharedCompiledRulesetTest) {
+    wfc2d::WaveFunctionCollapse2D source;
+    source.parseRulesFromFile("test_tile_options.txt");
+
+    wfc2d::WaveFunctionCollapse2D first;
+    wfc2d::WaveFunctionCollapse2D second;
+
+    first.initialize(3, 3);
+    second.initialize(3, 3);
+
+    first.setCompiledRuleset(source.getCompiledRuleset());
+    second.setCompiledRuleset(source.getCompiledRuleset());
+
+    EXPECT_EQ(first.getCompiledRuleset(), second.getCompiledRuleset());
+    EXPECT_EQ(first.getDomain(0).to_ulong(), 0b1111);
+
+    ASSERT_TRUE(first.collapse(4, 1));
+    ASSERT_TRUE(first.propagate());
+    ASSERT_TRUE(second.collapse(4, 2));
+    ASSERT_TRUE(second.propagate());
+
+    EXPECT_EQ(first.getDomain(1).to_ulong(), 0b0001);
+    EXPECT_EQ(second.getDomain(5).to_ulong(), 0b0001);
+    EXPECT_EQ(second.getDomain(1).to_ulong(), 0b1101);
+}
+
+// Test case to verify support counting reaches the same fixpoint as arc consistency
+TEST(WFC2DTest, SupportCountingPropagationTest) {
+    using EPropagation = wfc2d::WaveFunctionCollapse2D::EPropagation;
+
+    wfc2d::WaveFunctionCollapse2D arcs;
+    wfc2d::WaveFunctionCollapse2D supports;
+
+    const int ROWS = 6;
+    const int COLS = 7;
+
+    supports.setPropagation(EPropagation::SupportCounting);
+    ASSERT_EQ(supports.getPropagation(), EPropagation::SupportCounting);
+    ASSERT_EQ(arcs.getPropagation(), EPropagation::ArcConsistency);
+
+    for (auto* solver : { &arcs, &supports }) {
+        solver->initialize(ROWS, COLS);
+        solver->parseRulesFromFile("test_tile_options.txt");
+    }
+
+    const std::pair<size_t, size_t> choices[] = { { 8, 1 }, { 17, 2 }, { 30, 1 }, { 40, 3 } };
+    for (const auto& choice : choices) {
+        for (auto* solver : { &arcs, &supports }) {
+            ASSERT_TRUE(solver->collapse(choice.first, choice.second));
+            ASSERT_TRUE(solver->propagate());
+        }
+    }
+
+    for (size_t index = 0; index < ROWS * COLS; ++index) {
+        EXPECT_EQ(arcs.getDomain(index), supports.getDomain(index)) << "Domains of Tile " << index << " differ";
+    }
+
+    // Both TILE_0 neighbours of TILE_1 at index 8 must have been narrowed
+    EXPECT_EQ(supports.getDomain(1).to_ulong(), 0b0001);
+    EXPECT_EQ(supports.getDomain(15).to_ulong(), 0b0001);
+}
+
+// Test case to verify rulesets larger than a single domain word, on every kernel width
+TEST(WFC2DTest, LargeTilesetTest) {
+    using EPropagation = wfc2d::WaveFunctionCollapse2D::EPropagation;
+
+    for (size_t numTiles : { 8, 64, 100, 200, 300 }) {
+        const std::string filepath = writeBandRuleset(numTiles);
+
+        for (auto propagation : { EPropagation::ArcConsistency, EPropagation::SupportCounting }) {
+            wfc2d::WaveFunctionCollapse2D wfc2d;
+            wfc2d.setPropagation(propagation);
+            wfc2d.initialize(5, 5);
+
+            const auto& tiles = wfc2d.parseRulesFromFile(filepath);
+            ASSERT_EQ(tiles.size(), numTiles);
+            ASSERT_EQ(wfc2d.getCompiledRuleset()->words, (numTiles + 63) / 64);
+            ASSERT_EQ(wfc2d.getDomain(0).count(), numTiles);
+
+            const size_t chosen = numTiles - 1;
+            ASSERT_TRUE(wfc2d.collapse(12, chosen));
+            ASSERT_TRUE(wfc2d.propagate());
+
+            // Direct neighbours are within one step of the chosen tile, diagonal ones within two
+            const auto neighbor = wfc2d.getDomain(7);
+            EXPECT_EQ(neighbor.count(), 3);
+            EXPECT_TRUE(neighbor.test(chosen - 1));
+            EXPECT_TRUE(neighbor.test(chosen));
+            EXPECT_TRUE(neighbor.test(0));
+
+            EXPECT_EQ(wfc2d.getDomain(6).count(), 5);
+            EXPECT_TRUE(wfc2d.getDomain(6).test(1));
+            EXPECT_FALSE(wfc2d.getDomain(6).test(2));
+        }
+
+        std::remove(filepath.c_str());
+    }
+}
+
+// Test case to verify the collapsed plane tracks collapsed tiles only
+TEST(WFC2DTest, CollapsedPlaneTest) {
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+
+    const int ROWS = 9;
+    const int COLS = 9;
+
+    wfc2d.initialize(ROWS, COLS);
+    wfc2d.parseRulesFromFile("test_tile_options.txt");
+
+    for (size_t index = 0; index < ROWS * COLS; ++index) {
+        ASSERT_FALSE(wfc2d.isCollapsed(index));
+    }
+
+    ASSERT_TRUE(wfc2d.collapse(70, 1));
+    ASSERT_TRUE(wfc2d.propagate());
+
+    for (size_t index = 0; index < ROWS * COLS; ++index) {
+        EXPECT_EQ(wfc2d.isCollapsed(index), index == 70) << "Tile " << index;
+    }
+
+    // Narrowed to a single option by propagation, but not collapsed
+    EXPECT_EQ(wfc2d.getDomain(61).count(), 1);
+
+    // Reseeding the wave clears the plane again
+    wfc2d.initialize(ROWS, COLS);
+    EXPECT_FALSE(wfc2d.isCollapsed(70));
+    EXPECT_EQ(wfc2d.getDomain(70).count(), 4);
+}
+
+// Test case to verify observe() picks an uncollapsed tile with the fewest options, deterministically
+TEST(WFC2DTest, ObserveLowestEntropyTest) {
+    wfc2d::WaveFunctionCollapse2D first;
+    wfc2d::WaveFunctionCollapse2D second;
+
+    const int ROWS = 8;
+    const int COLS = 8;
+
+    for (auto* solver : { &first, &second }) {
+        solver->initialize(ROWS, COLS);
+        solver->parseRulesFromFile("test_tile_options.txt");
+    }
+
+    ASSERT_TRUE(first.collapse(27, 2));
+    ASSERT_TRUE(first.propagate());
+
+    // Right of TILE_2 only TILE_0 remains
+    EXPECT_EQ(first.observe(), 28);
+
+    for (int step = 0; step < 20; ++step) {
+        const size_t index = first.observe();
+        ASSERT_NE(index, wfc2d::WaveFunctionCollapse2D::NOT_FOUND);
+        ASSERT_FALSE(first.isCollapsed(index));
+
+        size_t lowest = std::numeric_limits<size_t>::max();
+        for (size_t other = 0; other < ROWS * COLS; ++other) {
+            if (!first.isCollapsed(other)) {
+                lowest = std::min(lowest, first.getDomain(other).count());
+            }
+        }
+        EXPECT_EQ(first.getDomain(index).count(), lowest);
+
+        // Collapse both solvers to the first remaining option; they must keep observing the same tiles
+        size_t option = 0;
+        while (!first.getDomain(index).test(option)) {
+            ++option;
+        }
+
+        if (step == 0) {
+            ASSERT_TRUE(second.collapse(27, 2));
+            ASSERT_TRUE(second.propagate());
+        }
+        ASSERT_EQ(second.observe(), index);
+
+        for (auto* solver : { &first, &second }) {
+            ASSERT_TRUE(solver->collapse(index, option));
+            ASSERT_TRUE(solver->propagate());
+        }
+    }
+}
+
+// Test case to verify weighted Shannon entropy is maintained while options are removed
+TEST(WFC2DTest, WeightedEntropyTest) {
+    using EPropagation = wfc2d::WaveFunctionCollapse2D::EPropagation;
+
+    const std::string filepath = "weighted_ruleset.txt";
+    {
+        // TILE_0 accepts everything, TILE_1 and TILE_2 only accept TILE_0 next to them
+        std::ofstream output(filepath);
+        output << "[TILE_0]\nweight=4\nup=0 1 2\ndown=0 1 2\nleft=0 1 2\nright=0 1 2\n\n";
+        output << "[TILE_1]\nweight=1\nup=0\ndown=0\nleft=0\nright=0\n\n";
+        output << "[TILE_2]\nweight=2\nup=0\ndown=0\nleft=0\nright=0\n\n";
+    }
+
+    const auto shannon = [](std::initializer_list<double> weights) {
+        double sum = 0.0;
+        double sumLog = 0.0;
+        for (double weight : weights) {
+            sum += weight;
+            sumLog += weight * std::log(weight);
+        }
+        return std::log(sum) - sumLog / sum;
+    };
+
+    for (auto propagation : { EPropagation::ArcConsistency, EPropagation::SupportCounting }) {
+        wfc2d::WaveFunctionCollapse2D wfc2d;
+        wfc2d.setPropagation(propagation);
+        wfc2d.initialize(3, 3);
+
+        const auto& tiles = wfc2d.parseRulesFromFile(filepath);
+        ASSERT_EQ(tiles.size(), 3);
+        EXPECT_DOUBLE_EQ(tiles[0].weight, 4.0);
+        EXPECT_DOUBLE_EQ(tiles[2].weight, 2.0);
+
+        EXPECT_NEAR(wfc2d.getEntropy(0), shannon({ 4, 1, 2 }), 1e-5);
+
+        ASSERT_TRUE(wfc2d.collapse(4, 1));
+        ASSERT_TRUE(wfc2d.propagate());
+
+        EXPECT_FLOAT_EQ(wfc2d.getEntropy(4), 0.0f);
+        EXPECT_FLOAT_EQ(wfc2d.getEntropy(1), 0.0f);  // Only TILE_0 next to TILE_1
+        EXPECT_NEAR(wfc2d.getEntropy(0), shannon({ 4, 1, 2 }), 1e-5);
+
+        ASSERT_TRUE(wfc2d.collapse(0, 0));
+        ASSERT_TRUE(wfc2d.propagate());
+        EXPECT_NEAR(wfc2d.getEntropy(2), shannon({ 4, 1, 2 }), 1e-5);
+
+        ASSERT_TRUE(wfc2d.collapse(8, 2));
+        ASSERT_TRUE(wfc2d.propagate());
+        EXPECT_FLOAT_EQ(wfc2d.getEntropy(5), 0.0f);
+
+        // Tiles next to TILE_1 or TILE_2 are decided, so they come out of observe() first
+        EXPECT_EQ(wfc2d.getDomain(5).count(), 1);
+        EXPECT_FLOAT_EQ(wfc2d.getEntropy(wfc2d.observe()), 0.0f);
+    }
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify the generator is reproducible, bounded and gives independent streams
+TEST(WFC2DTest, RandomTest) {
+    wfc2d::Random first(42);
+    wfc2d::Random second(42);
+    wfc2d::Random otherStream = wfc2d::Random::forStream(42, 1);
+
+    size_t differences = 0;
+    for (int i = 0; i < 1000; ++i) {
+        const uint64_t value = first.next();
+        EXPECT_EQ(value, second.next());
+        differences += value != otherStream.next();
+
+        EXPECT_LT(first.uniform(7), 7u);
+        second.uniform(7);
+
+        const float unit = first.uniformFloat();
+        second.uniformFloat();
+        EXPECT_GE(unit, 0.0f);
+        EXPECT_LT(unit, 1.0f);
+    }
+    EXPECT_EQ(differences, 1000);
+}
+
+// Test case to verify seeded solvers are reproducible and options are drawn by weight
+TEST(WFC2DTest, SeededCollapseTest) {
+    const std::string filepath = "seeded_ruleset.txt";
+    {
+        std::ofstream output(filepath);
+        output << "[TILE_0]\nweight=6\nup=0 1 2\ndown=0 1 2\nleft=0 1 2\nright=0 1 2\n\n";
+        output << "[TILE_1]\nweight=1\nup=0 1 2\ndown=0 1 2\nleft=0 1 2\nright=0 1 2\n\n";
+        output << "[TILE_2]\nweight=3\nup=0 1 2\ndown=0 1 2\nleft=0 1 2\nright=0 1 2\n\n";
+    }
+
+    const size_t CELLS = 4000;
+
+    wfc2d::WaveFunctionCollapse2D first;
+    wfc2d::WaveFunctionCollapse2D second;
+    for (auto* solver : { &first, &second }) {
+        solver->setSeed(1234);
+        solver->initialize(1, CELLS);
+        solver->parseRulesFromFile(filepath);
+    }
+
+    size_t counts[3] = { 0, 0, 0 };
+    for (size_t index = 0; index < CELLS; ++index) {
+        ASSERT_TRUE(first.collapse(index));
+        ASSERT_TRUE(second.collapse(index));
+        ASSERT_EQ(first.at(index), second.at(index));
+        ++counts[first.at(index)];
+    }
+
+    // Expected 2400 / 400 / 1200
+    EXPECT_NEAR(counts[0], 2400, 200);
+    EXPECT_NEAR(counts[1], 400, 100);
+    EXPECT_NEAR(counts[2], 1200, 150);
+
+    // Another seed gives another output
+    second.setSeed(4321);
+    size_t differences = 0;
+    for (size_t index = 0; index < CELLS; ++index) {
+        ASSERT_TRUE(second.collapse(index));
+        differences += first.at(index) != second.at(index);
+    }
+    EXPECT_GT(differences, CELLS / 4);
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify run() produces a complete output that satisfies the rules
+TEST(WFC2DTest, RunSolvesGridTest) {
+    using EPropagation = wfc2d::WaveFunctionCollapse2D::EPropagation;
+
+    const size_t ROWS = 24;
+    const size_t COLS = 32;
+
+    for (const std::string& filepath : { std::string("test_tile_options.txt"), writeBandRuleset(70) }) {
+        for (auto propagation : { EPropagation::ArcConsistency, EPropagation::SupportCounting }) {
+            wfc2d::WaveFunctionCollapse2D wfc2d;
+            wfc2d.setPropagation(propagation);
+            wfc2d.setSeed(7);
+            wfc2d.setMaxRestarts(50);
+            wfc2d.initialize(ROWS, COLS);
+            const auto& tiles = wfc2d.parseRulesFromFile(filepath);
+
+            ASSERT_TRUE(wfc2d.run());
+            EXPECT_GE(wfc2d.getAttempts(), 1u);
+
+            for (size_t index = 0; index < ROWS * COLS; ++index) {
+                ASSERT_TRUE(wfc2d.isCollapsed(index));
+            }
+            expectValidOutput(wfc2d, tiles, ROWS, COLS);
+
+            // Reseeding and solving again reuses the same buffers
+            wfc2d.reset();
+            EXPECT_FALSE(wfc2d.isCollapsed(0));
+            ASSERT_TRUE(wfc2d.run());
+            expectValidOutput(wfc2d, tiles, ROWS, COLS);
+        }
+    }
+
+    std::remove("band_ruleset_70.txt");
+}
+
+// Test case to verify contradictions end the attempt and the restart limit is honoured
+TEST(WFC2DTest, RunDetectsContradictionTest) {
+    const std::string filepath = "unsolvable_ruleset.txt";
+    {
+        // TILE_0 never accepts anything below it and TILE_1 nothing above it, so no column of three fits
+        std::ofstream output(filepath);
+        output << "[TILE_0]\nup=0 1\nleft=0 1\nright=0 1\n\n";
+        output << "[TILE_1]\ndown=0 1\nleft=0 1\nright=0 1\n\n";
+    }
+
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+    wfc2d.setMaxRestarts(3);
+    wfc2d.initialize(3, 3);
+    wfc2d.parseRulesFromFile(filepath);
+
+    EXPECT_FALSE(wfc2d.run());
+    EXPECT_EQ(wfc2d.getAttempts(), 4u);
+    EXPECT_EQ(wfc2d.getStatus(), wfc2d::EStatus::Contradiction);
+
+    // A single row has no vertical neighbours and is solvable
+    wfc2d.initialize(1, 5);
+    EXPECT_TRUE(wfc2d.run());
+    EXPECT_EQ(wfc2d.getAttempts(), 1);
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify the time budget stops run()
+TEST(WFC2DTest, RunTimeBudgetTest) {
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+
+    wfc2d.initialize(64, 64);
+    wfc2d.parseRulesFromFile("test_tile_options.txt");
+    wfc2d.setTimeBudget(std::chrono::nanoseconds(1));
+
+    EXPECT_FALSE(wfc2d.run());
+    EXPECT_EQ(wfc2d.getStatus(), wfc2d::EStatus::TimeBudgetExhausted);
+
+    wfc2d.setTimeBudget(std::chrono::nanoseconds(0));
+    EXPECT_TRUE(wfc2d.run());
+    EXPECT_EQ(wfc2d.getStatus(), wfc2d::EStatus::Ok);
+}
+
+// Test case to verify backtracking recovers from contradictions without restarting as often
+TEST(WFC2DTest, BacktrackingTest) {
+    using EPropagation = wfc2d::WaveFunctionCollapse2D::EPropagation;
+
+    const size_t ROWS = 16;
+    const size_t COLS = 16;
+    const std::string filepath = writeColoringRuleset();
+
+    for (auto propagation : { EPropagation::ArcConsistency, EPropagation::SupportCounting }) {
+        size_t restartAttempts = 0;
+        size_t backtrackAttempts = 0;
+        size_t backtracks = 0;
+
+        for (uint64_t seed = 0; seed < 10; ++seed) {
+            wfc2d::WaveFunctionCollapse2D restarting;
+            wfc2d::WaveFunctionCollapse2D backtracking;
+
+            backtracking.setBacktracking(true);
+            ASSERT_TRUE(backtracking.isBacktracking());
+            ASSERT_FALSE(restarting.isBacktracking());
+
+            for (auto* solver : { &restarting, &backtracking }) {
+                solver->setPropagation(propagation);
+                solver->setSeed(seed);
+                solver->setMaxRestarts(1000);
+                solver->initialize(ROWS, COLS);
+            }
+
+            const auto& tiles = restarting.parseRulesFromFile(filepath);
+            backtracking.parseRulesFromFile(filepath);
+
+            ASSERT_TRUE(restarting.run());
+            ASSERT_TRUE(backtracking.run());
+            expectValidOutput(backtracking, tiles, ROWS, COLS);
+            EXPECT_EQ(restarting.getBacktracks(), 0);
+
+            restartAttempts += restarting.getAttempts();
+            backtrackAttempts += backtracking.getAttempts();
+            backtracks += backtracking.getBacktracks();
+        }
+
+        EXPECT_GT(backtracks, 0u);
+        EXPECT_LT(backtrackAttempts, restartAttempts);
+    }
+
+    std::remove(filepath.c_str());
+}
 
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
 }
+
+TEST(WFC2DTest, ChunkedGenerationTest) {
+    const std::string filepath = writeBandRuleset(8);
+
+    wfc2d::WaveFunctionCollapse2D parser;
+    const auto& tiles = parser.parseRulesFromFile(filepath);
+
+    // Uneven sizes leave partial chunks on the last row and column
+    const size_t ROWS = 101;
+    const size_t COLS = 87;
+
+    for (auto propagation : { wfc2d::WaveFunctionCollapse2D::EPropagation::ArcConsistency, wfc2d::WaveFunctionCollapse2D::EPropagation::SupportCounting }) {
+        wfc2d::ChunkedGenerator generator(4);
+        ASSERT_TRUE(generator.parseRulesFromFile(filepath));
+        generator.setChunkSize(16);
+        generator.setPropagation(propagation);
+        generator.setSeed(7);
+
+        ASSERT_TRUE(generator.generate(ROWS, COLS));
+        ASSERT_EQ(generator.size(), ROWS * COLS);
+        expectValidOutput(generator, tiles, ROWS, COLS);
+    }
+
+    std::remove(filepath.c_str());
+}
+
+TEST(WFC2DTest, ChunkedDeterminismTest) {
+    const std::string filepath = writeBandRuleset(8);
+
+    std::vector<wfc2d::TileIndex> reference;
+    for (size_t threads : { 1, 3, 8 }) {
+        wfc2d::ChunkedGenerator generator(threads);
+        ASSERT_EQ(generator.getThreadCount(), threads);
+        ASSERT_TRUE(generator.parseRulesFromFile(filepath));
+        generator.setChunkSize(10);
+        generator.setSeed(42);
+
+        ASSERT_TRUE(generator.generate(64, 64));
+        if (reference.empty()) {
+            reference = generator.getOutput();
+        }
+        else {
+            EXPECT_EQ(generator.getOutput(), reference) << threads << " threads";
+        }
+    }
+
+    std::remove(filepath.c_str());
+}
+
+TEST(WFC2DTest, SolveParallelTest) {
+    const std::string filepath = writeColoringRuleset();
+
+    const size_t ROWS = 24;
+    const size_t COLS = 24;
+
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+    const auto& tiles = wfc2d.parseRulesFromFile(filepath);
+    wfc2d.setSeed(3);
+    wfc2d.setMaxRestarts(1000);
+    wfc2d.initialize(ROWS, COLS);
+    wfc2d.setPropagationThreads(3);
+
+    // The callback is documented to run on the thread of the caller only
+    const std::thread::id caller = std::this_thread::get_id();
+    std::atomic<size_t> foreignCalls{ 0 };
+    size_t calls = 0;
+    wfc2d.setProgressCallback([&]() {
+        ++calls;
+        foreignCalls += std::this_thread::get_id() != caller ? 1 : 0;
+    }, 16);
+
+    ASSERT_TRUE(wfc2d.solveParallel(4));
+    expectValidOutput(wfc2d, tiles, ROWS, COLS);
+    EXPECT_EQ(foreignCalls.load(), 0u);
+
+    // The winner replaces the solver, which must not keep the stop flag of the race, but keeps the settings
+    EXPECT_FALSE(wfc2d.stopRequested());
+    EXPECT_EQ(wfc2d.getPropagationThreads(), 3u);
+    for (size_t index = 0; index < ROWS * COLS; ++index) {
+        EXPECT_TRUE(wfc2d.isCollapsed(index));
+    }
+
+    calls = 0;
+    wfc2d.reset();
+    EXPECT_TRUE(wfc2d.run());
+    EXPECT_GT(calls, 0u);
+
+    std::remove(filepath.c_str());
+}
+
+TEST(WFC2DTest, StopFlagTest) {
+    const std::string filepath = writeBandRuleset(8);
+
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+    wfc2d.parseRulesFromFile(filepath);
+    wfc2d.initialize(16, 16);
+
+    for (auto propagation : { wfc2d::WaveFunctionCollapse2D::EPropagation::ArcConsistency, wfc2d::WaveFunctionCollapse2D::EPropagation::SupportCounting }) {
+        wfc2d.setPropagation(propagation);
+
+        std::atomic<bool> stop{ true };
+        wfc2d.setStopFlag(&stop);
+        EXPECT_TRUE(wfc2d.stopRequested());
+
+        ASSERT_TRUE(wfc2d.collapse(0, 0));
+        EXPECT_FALSE(wfc2d.propagate());
+        EXPECT_FALSE(wfc2d.run());
+
+        // Lowering the flag lets the same solver finish
+        stop = false;
+        wfc2d.reset();
+        EXPECT_TRUE(wfc2d.run());
+        wfc2d.setStopFlag(nullptr);
+    }
+
+    std::remove(filepath.c_str());
+}
+
+TEST(WFC2DTest, ParallelPropagationTest) {
+    // Tile i must be followed by tile i + 1 to the right and below, so a single collapse decides the whole grid
+    const std::string filepath = "diagonal_ruleset.txt";
+    {
+        std::ofstream output(filepath);
+        const size_t numTiles = 5;
+        for (size_t tile = 0; tile < numTiles; ++tile) {
+            const size_t previous = (tile + numTiles - 1) % numTiles;
+            const size_t next = (tile + 1) % numTiles;
+            output << "[TILE_" << tile << "]\n";
+            output << "up=" << previous << "\ndown=" << next << "\nleft=" << previous << "\nright=" << next << "\n\n";
+        }
+    }
+
+    const size_t ROWS = 40;
+    const size_t COLS = 33;
+
+    wfc2d::WaveFunctionCollapse2D sequential;
+    wfc2d::WaveFunctionCollapse2D parallel;
+    sequential.parseRulesFromFile(filepath);
+    parallel.parseRulesFromFile(filepath);
+    parallel.setPropagationThreads(4, 1);
+    EXPECT_EQ(parallel.getPropagationThreads(), 4);
+
+    sequential.initialize(ROWS, COLS);
+    parallel.initialize(ROWS, COLS);
+
+    ASSERT_TRUE(sequential.collapse(ROWS / 2 * COLS + COLS / 2, 3));
+    ASSERT_TRUE(parallel.collapse(ROWS / 2 * COLS + COLS / 2, 3));
+    ASSERT_TRUE(sequential.propagate());
+    ASSERT_TRUE(parallel.propagate());
+
+    for (size_t index = 0; index < ROWS * COLS; ++index) {
+        ASSERT_EQ(parallel.getDomain(index), sequential.getDomain(index)) << "Tile " << index;
+        EXPECT_EQ(parallel.getDomain(index).count(), 1);
+        EXPECT_FLOAT_EQ(parallel.getEntropy(index), sequential.getEntropy(index));
+    }
+
+    // Neighbours that disagree are a contradiction
+    parallel.reset();
+    ASSERT_TRUE(parallel.collapse(0, 0));
+    ASSERT_TRUE(parallel.collapse(1, 0));
+    EXPECT_FALSE(parallel.propagate());
+
+    // The wave can be reused after a contradiction
+    parallel.reset();
+    EXPECT_TRUE(parallel.run());
+
+    std::remove(filepath.c_str());
+}
+
+TEST(WFC2DTest, ParallelPropagationMatchesSequentialTest) {
+    const std::string filepath = writeBandRuleset(8);
+
+    const size_t ROWS = 48;
+    const size_t COLS = 48;
+
+    wfc2d::WaveFunctionCollapse2D sequential;
+    wfc2d::WaveFunctionCollapse2D parallel;
+    sequential.parseRulesFromFile(filepath);
+    parallel.parseRulesFromFile(filepath);
+    parallel.setPropagationThreads(3, 1);
+
+    sequential.initialize(ROWS, COLS);
+    parallel.initialize(ROWS, COLS);
+
+    // Apply the same collapses to both and compare the wave after every propagation
+    wfc2d::Random random(11);
+    for (size_t step = 0; step < 60; ++step) {
+        const size_t index = random.uniform(ROWS * COLS);
+        if (sequential.isCollapsed(index)) {
+            continue;
+        }
+
+        const wfc2d::Bitset options = sequential.getDomain(index);
+        size_t option = 0;
+        while (!options.test(option)) {
+            ++option;
+        }
+
+        ASSERT_TRUE(sequential.collapse(index, option));
+        ASSERT_TRUE(parallel.collapse(index, option));
+
+        const bool consistent = sequential.propagate();
+        ASSERT_EQ(parallel.propagate(), consistent);
+        if (!consistent) {
+            break;
+        }
+
+        for (size_t cell = 0; cell < ROWS * COLS; ++cell) {
+            ASSERT_EQ(parallel.getDomain(cell), sequential.getDomain(cell)) << "Step " << step << ", tile " << cell;
+            ASSERT_NEAR(parallel.getEntropy(cell), sequential.getEntropy(cell), 1e-4f);
+        }
+    }
+
+    std::remove(filepath.c_str());
+}
+
+TEST(WFC2DTest, DomainKernelsTest) {
+    const auto& scalar = wfc2d::internal::scalarDomainKernels();
+    std::vector<const wfc2d::internal::DomainKernels*> candidates = { &wfc2d::internal::domainKernels() };
+    if (const auto* avx2 = wfc2d::internal::avx2DomainKernels()) {
+        candidates.push_back(avx2);
+    }
+    if (const auto* neon = wfc2d::internal::neonDomainKernels()) {
+        candidates.push_back(neon);
+    }
+
+    wfc2d::Random random(5);
+    for (const auto* kernels : candidates) {
+        // Widths around the vector and block sizes, including partial vectors at the end
+        for (size_t words = 1; words <= 20; ++words) {
+            const size_t tiles = words * 64;
+            std::vector<uint64_t> masks(tiles * words);
+            for (auto& word : masks) {
+                word = random.next() & random.next();
+            }
+
+            for (size_t trial = 0; trial < 8; ++trial) {
+                std::vector<uint64_t> domain(words);
+                for (auto& word : domain) {
+                    word = trial % 2 == 0 ? random.next() & random.next() & random.next() : random.next();
+                }
+
+                std::vector<uint64_t> expected(words), actual(words, ~uint64_t{ 0 });
+                scalar.uniteMasks(expected.data(), domain.data(), masks.data(), words);
+                kernels->uniteMasks(actual.data(), domain.data(), masks.data(), words);
+                ASSERT_EQ(actual, expected) << kernels->name << ", " << words << " words";
+
+                std::vector<uint64_t> expectedDomain = domain, actualDomain = domain;
+                std::vector<uint64_t> expectedRemoved(words), actualRemoved(words);
+                const size_t expectedCount = scalar.intersect(expectedDomain.data(), expected.data(), expectedRemoved.data(), words);
+                const size_t actualCount = kernels->intersect(actualDomain.data(), expected.data(), actualRemoved.data(), words);
+                EXPECT_EQ(actualCount, expectedCount) << kernels->name << ", " << words << " words";
+                EXPECT_EQ(actualDomain, expectedDomain) << kernels->name << ", " << words << " words";
+                EXPECT_EQ(actualRemoved, expectedRemoved) << kernels->name << ", " << words << " words";
+            }
+        }
+    }
+}
+
+TEST(WFC2DTest, StaticRulesetTest) {
+    const std::string filepath = writeBandRuleset(8);
+
+    wfc2d::WaveFunctionCollapse2D runtime;
+    const auto& tiles = runtime.parseRulesFromFile(filepath);
+
+    using StaticSolver = wfc2d::StaticWaveFunctionCollapse2D<STATIC_BAND_RULESET>;
+    static_assert(std::is_same<StaticSolver::Domain, uint8_t>::value, "8 tiles fit a byte");
+
+    const auto staticTiles = StaticSolver::tiles();
+    ASSERT_EQ(staticTiles.size(), tiles.size());
+    for (size_t tile = 0; tile < tiles.size(); ++tile) {
+        for (size_t direction = 0; direction < 4; ++direction) {
+            EXPECT_EQ(staticTiles[tile].options[direction], tiles[tile].options[direction]);
+        }
+    }
+
+    // Same ruleset and seed give the same map as the runtime solver
+    StaticSolver solver;
+    for (auto* wfc : { static_cast<wfc2d::internal::WaveFunctionCollapse2DImpl*>(&solver), static_cast<wfc2d::internal::WaveFunctionCollapse2DImpl*>(&runtime) }) {
+        wfc->setSeed(21);
+        wfc->setMaxRestarts(100);
+        wfc->initialize(30, 30);
+        ASSERT_TRUE(wfc->run());
+    }
+
+    expectValidOutput(solver, tiles, 30, 30);
+    for (size_t index = 0; index < 30 * 30; ++index) {
+        ASSERT_EQ(solver.at(index), runtime.at(index)) << "Tile " << index;
+    }
+
+    // The speculative copies keep the compiled kernel
+    solver.initialize(30, 30);
+    ASSERT_TRUE(solver.solveParallel(3));
+    expectValidOutput(solver, tiles, 30, 30);
+
+    // A ruleset loaded at runtime replaces the static one
+    const std::string coloring = writeColoringRuleset();
+    const auto& coloringTiles = solver.parseRulesFromFile(coloring);
+    solver.setMaxRestarts(1000);
+    solver.initialize(10, 10);
+    ASSERT_TRUE(solver.run());
+    expectValidOutput(solver, coloringTiles, 10, 10);
+
+    std::remove(filepath.c_str());
+    std::remove(coloring.c_str());
+}
+
+TEST(WFC2DTest, StaticRulesetSymmetryTest) {
+    wfc2d::StaticWaveFunctionCollapse2D<STATIC_ONE_SIDED_RULESET> solver;
+    solver.initialize(1, 2);
+
+    // Tile 0 on the right leaves only tile 0 on the left
+    ASSERT_TRUE(solver.collapse(1, 0));
+    ASSERT_TRUE(solver.propagate());
+    EXPECT_EQ(solver.getDomain(0).to_ulong(), 1u);
+
+    EXPECT_DOUBLE_EQ(wfc2d::StaticWaveFunctionCollapse2D<STATIC_ONE_SIDED_RULESET>::tiles()[1].weight, 2.0);
+}
+
+// Test case to verify loading a ruleset replaces the previous one instead of appending to it
+TEST(WFC2DTest, ReloadRulesetTest) {
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+
+    const auto& first = wfc2d.parseRulesFromFile("test_tile_options.txt");
+    ASSERT_EQ(first.size(), 4);
+    const auto firstRuleset = wfc2d.getRuleset();
+
+    const auto& second = wfc2d.parseRulesFromFile("test_tile_options.txt");
+    EXPECT_EQ(second.size(), 4);
+    EXPECT_EQ(wfc2d.getCompiledRuleset()->numTiles, 4);
+    EXPECT_NE(wfc2d.getRuleset(), firstRuleset);
+
+    // A file that can't be read keeps the attached ruleset
+    EXPECT_TRUE(wfc2d.parseRulesFromFile("missing_ruleset.txt").empty());
+    EXPECT_EQ(wfc2d.getCompiledRuleset()->numTiles, 4);
+}
+
+// Test case to verify one loaded ruleset is attached to many solvers without copies
+TEST(WFC2DTest, SharedRulesetTest) {
+    const auto ruleset = wfc2d::WaveFunctionCollapse2D::Ruleset::load("test_tile_options.txt");
+    ASSERT_NE(ruleset, nullptr);
+    ASSERT_EQ(ruleset->size(), 4);
+
+    std::vector<wfc2d::WaveFunctionCollapse2D> solvers(8);
+    for (size_t i = 0; i < solvers.size(); ++i) {
+        solvers[i].setRuleset(ruleset);
+        solvers[i].setSeed(i);
+        solvers[i].setMaxRestarts(100);
+        solvers[i].initialize(6, 6);
+        ASSERT_TRUE(solvers[i].run());
+        expectValidOutput(solvers[i], *ruleset, 6, 6);
+
+        EXPECT_EQ(solvers[i].getRuleset(), ruleset);
+        EXPECT_EQ(solvers[i].getCompiledRuleset(), ruleset->compiled());
+        EXPECT_EQ(&solvers[i].getRuleset()->tiles(), &ruleset->tiles());
+    }
+
+    // Eight solvers plus the local handle
+    EXPECT_EQ(ruleset.use_count(), 9);
+
+    // Attaching another compiled ruleset detaches the tiles that described the old one
+    wfc2d::WaveFunctionCollapse2D other;
+    other.parseRulesFromFile("tile_options.json");
+    solvers[0].setCompiledRuleset(other.getCompiledRuleset());
+    EXPECT_EQ(solvers[0].getRuleset(), nullptr);
+
+    EXPECT_EQ(wfc2d::WaveFunctionCollapse2D::Ruleset::load("missing_ruleset.txt"), nullptr);
+}
+
+// Test case to verify the JSON ruleset reads the same rules as the text format
+TEST(WFC2DTest, JsonRulesetTest) {
+    wfc2d::WaveFunctionCollapse2D text;
+    wfc2d::WaveFunctionCollapse2D json;
+
+    const auto& textTiles = text.parseRulesFromFile("test_tile_options.txt");
+    const auto& jsonTiles = json.parseRulesFromFile("tile_options.json");
+
+    ASSERT_EQ(jsonTiles.size(), textTiles.size());
+    for (size_t tile = 0; tile < textTiles.size(); ++tile) {
+        for (size_t direction = 0; direction < 4; ++direction) {
+            EXPECT_EQ(jsonTiles[tile].options[direction].to_ulong(), textTiles[tile].options[direction].to_ulong()) << "Tile " << tile;
+        }
+        EXPECT_DOUBLE_EQ(jsonTiles[tile].weight, textTiles[tile].weight);
+    }
+
+    // Ids place the tiles, out-of-order entries and weights included
+    const std::string filepath = "reordered_ruleset.json";
+    {
+        std::ofstream output(filepath);
+        output << R"({ "tiles": [
+            { "id": 1, "options": { "up": [0, 1], "down": [0, 1], "left": [0, 1], "right": [0, 1] }, "weight": 3.5 },
+            { "id": 0, "options": { "up": [1], "down": [1], "left": [1], "right": [1] } }
+        ] })";
+    }
+
+    wfc2d::WaveFunctionCollapse2D reordered;
+    const auto& tiles = reordered.parseRulesFromJson(filepath);
+    ASSERT_EQ(tiles.size(), 2);
+    EXPECT_EQ(tiles[0].options[0].to_ulong(), 0b10);
+    EXPECT_DOUBLE_EQ(tiles[0].weight, 1.0);
+    EXPECT_DOUBLE_EQ(tiles[1].weight, 3.5);
+    EXPECT_EQ(reordered.getCompiledRuleset()->mask(0, 1)[0], 0b11);
+
+    // Malformed documents and duplicate ids are rejected
+    for (const char* document : { R"({ "tiles": [ { "id": 0, "options": { "up": [0] } )",
+                                  R"({ "tiles": [ { "id": 0, "options": {} }, { "id": 0, "options": {} } ] })",
+                                  R"({ "tiles": [ { "id": 0, "options": {}, "weight": -1 } ] })" }) {
+        {
+            std::ofstream output(filepath);
+            output << document;
+        }
+
+        wfc2d::WaveFunctionCollapse2D invalid;
+        EXPECT_TRUE(invalid.parseRulesFromJson(filepath).empty()) << document;
+        EXPECT_EQ(invalid.getCompiledRuleset(), nullptr) << document;
+    }
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify a saved compiled ruleset loads back identical and solves the same way
+TEST(WFC2DTest, CompiledRulesetBinaryTest) {
+    const std::string band = writeBandRuleset(70);
+    const std::string filepath = "band_ruleset_70.wfcr";
+
+    wfc2d::WaveFunctionCollapse2D source;
+    const auto& tiles = source.parseRulesFromFile(band);
+    const auto compiled = source.getCompiledRuleset();
+    ASSERT_TRUE(compiled->save(filepath));
+
+    const auto loaded = wfc2d::WaveFunctionCollapse2D::CompiledRuleset::load(filepath);
+    ASSERT_NE(loaded, nullptr);
+    ASSERT_EQ(loaded->numTiles, compiled->numTiles);
+    ASSERT_EQ(loaded->words, compiled->words);
+    EXPECT_TRUE(std::equal(loaded->allowed.begin(), loaded->allowed.end(), compiled->allowed.begin(), compiled->allowed.end()));
+    EXPECT_TRUE(std::equal(loaded->supportCounts.begin(), loaded->supportCounts.end(), compiled->supportCounts.begin(), compiled->supportCounts.end()));
+    EXPECT_TRUE(std::equal(loaded->weights.begin(), loaded->weights.end(), compiled->weights.begin(), compiled->weights.end()));
+    EXPECT_TRUE(std::equal(loaded->weightLogWeights.begin(), loaded->weightLogWeights.end(), compiled->weightLogWeights.begin(), compiled->weightLogWeights.end()));
+    EXPECT_EQ(loaded->sumWeights, compiled->sumWeights);
+    EXPECT_EQ(loaded->hasUnsupported, compiled->hasUnsupported);
+    EXPECT_EQ(loaded->logTable.log(3.0f), compiled->logTable.log(3.0f));
+
+    // The views point into the mapping, which stays alive with the ruleset
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(loaded->allowed.data()) % 64, 0u);
+
+    wfc2d::WaveFunctionCollapse2D fromText;
+    wfc2d::WaveFunctionCollapse2D fromBinary;
+    fromText.setCompiledRuleset(compiled);
+    ASSERT_TRUE(fromBinary.loadCompiledRuleset(filepath));
+    for (auto* wfc : { &fromText, &fromBinary }) {
+        wfc->setSeed(5);
+        wfc->setMaxRestarts(100);
+        wfc->initialize(20, 20);
+        ASSERT_TRUE(wfc->run());
+    }
+
+    expectValidOutput(fromBinary, tiles, 20, 20);
+    for (size_t index = 0; index < 20 * 20; ++index) {
+        ASSERT_EQ(fromBinary.at(index), fromText.at(index)) << "Tile " << index;
+    }
+
+    std::remove(band.c_str());
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify truncated, corrupt and foreign files are not loaded
+TEST(WFC2DTest, CompiledRulesetBinaryRejectsTest) {
+    const std::string filepath = "rejected_ruleset.wfcr";
+
+    wfc2d::WaveFunctionCollapse2D source;
+    source.parseRulesFromFile("test_tile_options.txt");
+    ASSERT_TRUE(source.getCompiledRuleset()->save(filepath));
+
+    std::string contents;
+    {
+        std::ifstream input(filepath, std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    }
+
+    const auto expectRejected = [&filepath](const std::string& bytes) {
+        {
+            std::ofstream output(filepath, std::ios::binary | std::ios::trunc);
+            output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        }
+
+        EXPECT_EQ(wfc2d::WaveFunctionCollapse2D::CompiledRuleset::load(filepath), nullptr);
+
+        wfc2d::WaveFunctionCollapse2D solver;
+        EXPECT_FALSE(solver.loadCompiledRuleset(filepath));
+        EXPECT_EQ(solver.getCompiledRuleset(), nullptr);
+    };
+
+    std::string badMagic = contents;
+    badMagic[0] = 'X';
+    expectRejected(badMagic);
+
+    std::string badVersion = contents;
+    badVersion[8] = static_cast<char>(badVersion[8] + 1);
+    expectRejected(badVersion);
+
+    expectRejected(contents.substr(0, contents.size() - 1));
+    expectRejected(contents.substr(0, 16));
+
+    // The header layout is private, the sections are found by their bytes
+    const auto& compiled = *source.getCompiledRuleset();
+    ASSERT_EQ(compiled.numTiles, 4u);
+    const auto sectionOffset = [&contents](const void* section, size_t bytes) {
+        const size_t offset = contents.find(std::string(static_cast<const char*>(section), bytes));
+        EXPECT_NE(offset, std::string::npos);
+        return offset;
+    };
+
+    std::string paddingBit = contents;
+    const uint64_t firstMask = compiled.allowed.data()[0] | (uint64_t{ 1 } << compiled.numTiles);
+    std::memcpy(&paddingBit[sectionOffset(compiled.allowed.data(), compiled.allowed.size() * sizeof(uint64_t))], &firstMask, sizeof(firstMask));
+    expectRejected(paddingBit);
+
+    std::string nanWeight = contents;
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    std::memcpy(&nanWeight[sectionOffset(compiled.weights.data(), compiled.weights.size() * sizeof(float))], &nan, sizeof(nan));
+    expectRejected(nanWeight);
+
+    std::string wrongCount = contents;
+    const uint16_t count = static_cast<uint16_t>(compiled.supportCounts.data()[0] + 1);
+    std::memcpy(&wrongCount[sectionOffset(compiled.supportCounts.data(), compiled.supportCounts.size() * sizeof(uint16_t))], &count, sizeof(count));
+    expectRejected(wrongCount);
+
+    EXPECT_EQ(wfc2d::WaveFunctionCollapse2D::CompiledRuleset::load("missing_ruleset.wfcr"), nullptr);
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify streamed rows connect across windows and only a window of them is kept
+TEST(WFC2DTest, StreamingGenerationTest) {
+    const std::string filepath = writeBandRuleset(8);
+    const auto ruleset = wfc2d::WaveFunctionCollapse2D::Ruleset::load(filepath);
+
+    wfc2d::StreamingGenerator generator;
+    ASSERT_TRUE(generator.parseRulesFromFile(filepath));
+    generator.setWindowRows(12);
+    generator.setLookaheadRows(3);
+    generator.setSeed(4);
+
+    const size_t ROWS = 200;
+    const size_t COLS = 24;
+    std::vector<size_t> output;
+    size_t nextRow = 0;
+    ASSERT_TRUE(generator.generate(COLS, [&](size_t row, wfc2d::Span<const wfc2d::TileIndex> tiles) {
+        EXPECT_EQ(row, nextRow++);
+        EXPECT_EQ(tiles.size(), COLS);
+        output.insert(output.end(), tiles.begin(), tiles.end());
+        return true;
+    }, ROWS));
+
+    ASSERT_EQ(generator.getRowsEmitted(), ROWS);
+    ASSERT_EQ(output.size(), ROWS * COLS);
+    expectValidOutput(output, *ruleset, ROWS, COLS);
+
+    // The ring buffer holds the last window of rows, older ones are recycled
+    EXPECT_TRUE(generator.getRow(ROWS - 12).data() != nullptr);
+    EXPECT_TRUE(std::equal(generator.getRow(ROWS - 1).begin(), generator.getRow(ROWS - 1).end(), output.end() - COLS));
+    EXPECT_TRUE(generator.getRow(ROWS - 13).empty());
+    EXPECT_TRUE(generator.getRow(ROWS).empty());
+
+    // Same seed, same strip
+    std::vector<size_t> again;
+    ASSERT_TRUE(generator.generate(COLS, [&](size_t, wfc2d::Span<const wfc2d::TileIndex> tiles) {
+        again.insert(again.end(), tiles.begin(), tiles.end());
+        return true;
+    }, ROWS));
+    EXPECT_EQ(again, output);
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify an unbounded stream runs until the consumer stops it
+TEST(WFC2DTest, StreamingConsumerStopTest) {
+    wfc2d::StreamingGenerator generator;
+
+    // Nothing to generate without a ruleset
+    EXPECT_FALSE(generator.generate(4, [](size_t, wfc2d::Span<const wfc2d::TileIndex>) { return true; }));
+
+    ASSERT_TRUE(generator.parseRulesFromFile("test_tile_options.txt"));
+    generator.setWindowRows(6);
+    generator.setLookaheadRows(2);
+
+    size_t received = 0;
+    ASSERT_TRUE(generator.generate(10, [&](size_t row, wfc2d::Span<const wfc2d::TileIndex>) {
+        ++received;
+        return row < 99;
+    }));
+
+    EXPECT_EQ(received, 100);
+    EXPECT_EQ(generator.getRowsEmitted(), 100);
+}
+
+// Test case to verify a pinned edit only redraws the tiles around it
+TEST(WFC2DTest, PinResolveTest) {
+    const std::string filepath = writeBandRuleset(8);
+
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+    const auto& tiles = wfc2d.parseRulesFromFile(filepath);
+    wfc2d.setSeed(12);
+    wfc2d.setMaxRestarts(100);
+    wfc2d.setBacktracking(true);
+    wfc2d.initialize(40, 40);
+    ASSERT_TRUE(wfc2d.run());
+    EXPECT_FALSE(wfc2d.hasInvalidRegion());
+
+    std::vector<size_t> before(wfc2d.size());
+    for (size_t index = 0; index < wfc2d.size(); ++index) {
+        before[index] = wfc2d[index];
+    }
+
+    // Opposite tile of the band: its neighbourhood has to bend over several cells to reach it
+    const size_t center = 20 * 40 + 20;
+    const size_t option = (before[center] + 4) % 8;
+    ASSERT_TRUE(wfc2d.pin(center, option));
+    EXPECT_TRUE(wfc2d.isPinned(center));
+    EXPECT_TRUE(wfc2d.hasInvalidRegion());
+
+    ASSERT_TRUE(wfc2d.resolve());
+    EXPECT_FALSE(wfc2d.hasInvalidRegion());
+    EXPECT_EQ(wfc2d[center], option);
+    expectValidOutput(wfc2d, tiles, 40, 40);
+
+    // The margin doubles from 2 until the edit fits, far from the whole grid
+    for (size_t row = 0; row < 40; ++row) {
+        for (size_t col = 0; col < 40; ++col) {
+            const size_t distance = std::max(row > 20 ? row - 20 : 20 - row, col > 20 ? col - 20 : 20 - col);
+            if (distance > 9) {
+                ASSERT_EQ(wfc2d[row * 40 + col], before[row * 40 + col]) << "Row " << row << ", column " << col;
+            }
+        }
+    }
+
+    // Restarts reseed the wave but keep the pin
+    wfc2d.reset();
+    ASSERT_TRUE(wfc2d.run());
+    EXPECT_EQ(wfc2d[center], option);
+
+    wfc2d.unpin(center);
+    EXPECT_FALSE(wfc2d.isPinned(center));
+    EXPECT_FALSE(wfc2d.pin(wfc2d.size(), 0));
+    EXPECT_FALSE(wfc2d.pin(0, 8));
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify a pin on an option that is already banned is refused
+TEST(WFC2DTest, PinBannedOptionTest) {
+    const std::string filepath = writeBandRuleset(8);
+
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+    wfc2d.parseRulesFromFile(filepath);
+    wfc2d.setSeed(5);
+    wfc2d.initialize(10, 10);
+
+    // Tile 0 leaves only 7, 0 and 1 to its right neighbour
+    ASSERT_TRUE(wfc2d.pin(0, 0));
+    ASSERT_TRUE(wfc2d.propagate());
+    ASSERT_FALSE(wfc2d.getDomain(1).test(4));
+
+    EXPECT_FALSE(wfc2d.pin(1, 4));
+    EXPECT_FALSE(wfc2d.isPinned(1));
+    EXPECT_FALSE(wfc2d.isCollapsed(1));
+    ASSERT_TRUE(wfc2d.run());
+    EXPECT_EQ(wfc2d[0], 0u);
+
+    // Pins that contradict each other fail every attempt instead of being dropped
+    wfc2d.setMaxRestarts(3);
+    wfc2d.initialize(10, 10);
+    ASSERT_TRUE(wfc2d.pin(0, 0));
+    ASSERT_TRUE(wfc2d.pin(1, 4));
+    EXPECT_FALSE(wfc2d.run());
+    EXPECT_EQ(wfc2d.getStatus(), wfc2d::EStatus::Contradiction);
+    EXPECT_EQ(wfc2d.getAttempts(), 4u);
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify an invalidated rectangle is redrawn and the rest of the map kept
+TEST(WFC2DTest, InvalidateRegionTest) {
+    const std::string filepath = writeBandRuleset(8);
+
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+    const auto& tiles = wfc2d.parseRulesFromFile(filepath);
+    wfc2d.setSeed(3);
+    wfc2d.setMaxRestarts(100);
+    wfc2d.setBacktracking(true);
+    wfc2d.initialize(30, 50);
+    ASSERT_TRUE(wfc2d.run());
+
+    std::vector<size_t> before(wfc2d.size());
+    for (size_t index = 0; index < wfc2d.size(); ++index) {
+        before[index] = wfc2d[index];
+    }
+
+    wfc2d.setResolveMargin(1);
+    wfc2d.invalidate(10, 30, 5, 100); // Clipped to the right edge
+    ASSERT_TRUE(wfc2d.resolve());
+    expectValidOutput(wfc2d, tiles, 30, 50);
+
+    bool changed = false;
+    for (size_t row = 0; row < 30; ++row) {
+        for (size_t col = 0; col < 50; ++col) {
+            const bool redrawn = row >= 9 && row < 16 && col >= 29;
+            changed |= redrawn && wfc2d[row * 50 + col] != before[row * 50 + col];
+            if (!redrawn) {
+                ASSERT_EQ(wfc2d[row * 50 + col], before[row * 50 + col]) << "Row " << row << ", column " << col;
+            }
+        }
+    }
+    EXPECT_TRUE(changed);
+
+    // On a grid that was never solved, resolve() solves it all, honouring the pins
+    wfc2d.initialize(10, 10);
+    ASSERT_TRUE(wfc2d.pin(55, 6));
+    ASSERT_TRUE(wfc2d.resolve());
+    EXPECT_EQ(wfc2d[55], 6);
+    expectValidOutput(wfc2d, tiles, 10, 10);
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify run() fills the statistics when they are compiled in, and keeps them at zero otherwise
+TEST(WFC2DTest, SolverStatsTest) {
+    const std::string filepath = writeColoringRuleset();
+
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+    wfc2d.parseRulesFromFile(filepath);
+    wfc2d.setSeed(8);
+    wfc2d.setMaxRestarts(1000);
+    wfc2d.setBacktracking(true);
+    wfc2d.initialize(12, 12);
+    ASSERT_TRUE(wfc2d.run());
+
+    const auto& stats = wfc2d.getStats();
+    if (!wfc2d::WaveFunctionCollapse2D::STATS_ENABLED) {
+        EXPECT_EQ(stats.collapses, 0);
+        EXPECT_EQ(stats.bans, 0);
+        EXPECT_EQ(stats.propagateNanoseconds, 0);
+        std::remove(filepath.c_str());
+        return;
+    }
+
+    EXPECT_GT(stats.collapses, 0);
+    EXPECT_GT(stats.bans, 0);
+    EXPECT_GT(stats.maxQueueSize, 0);
+    EXPECT_EQ(stats.restarts, wfc2d.getAttempts() - 1);
+    EXPECT_GE(stats.contradictions, stats.restarts);
+    EXPECT_GE(stats.backtracks, wfc2d.getBacktracks());
+    EXPECT_LE(stats.backtracks, stats.contradictions);
+    EXPECT_GT(stats.observeNanoseconds + stats.propagateNanoseconds + stats.outputNanoseconds, 0u);
+
+    // A new run starts from zero
+    const size_t collapses = stats.collapses;
+    wfc2d.initialize(2, 2);
+    ASSERT_TRUE(wfc2d.run());
+    EXPECT_LT(wfc2d.getStats().collapses, collapses);
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify the progress callback fires every given number of collapses
+TEST(WFC2DTest, ProgressCallbackTest) {
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+    wfc2d.parseRulesFromFile("test_tile_options.txt");
+    wfc2d.setSeed(2);
+    wfc2d.initialize(20, 20);
+
+    size_t calls = 0;
+    size_t lastOpen = wfc2d.size() + 1;
+    wfc2d.setProgressCallback([&]() {
+        ++calls;
+
+        // The solver can be inspected from the callback
+        size_t open = 0;
+        for (size_t index = 0; index < wfc2d.size(); ++index) {
+            open += wfc2d.isCollapsed(index) ? 0 : 1;
+        }
+        EXPECT_LT(open, lastOpen);
+        lastOpen = open;
+    }, 10);
+
+    ASSERT_TRUE(wfc2d.run());
+    EXPECT_GT(calls, 0);
+    EXPECT_LE(calls * 10, wfc2d.size());
+
+    // Removing the callback stops the calls
+    const size_t before = calls;
+    wfc2d.setProgressCallback({}, 10);
+    wfc2d.reset();
+    ASSERT_TRUE(wfc2d.run());
+    EXPECT_EQ(calls, before);
+}
+
+// Test case to verify failures are reported as status values
+TEST(WFC2DTest, StatusTest) {
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+    EXPECT_FALSE(wfc2d.run());
+    EXPECT_EQ(wfc2d.getStatus(), wfc2d::EStatus::NotInitialized);
+
+    wfc2d.initialize(4, 4);
+    EXPECT_FALSE(wfc2d.run());
+    EXPECT_EQ(wfc2d.getStatus(), wfc2d::EStatus::NoRuleset);
+
+    EXPECT_TRUE(wfc2d.parseRulesFromFile("missing_ruleset.txt").empty());
+    EXPECT_EQ(wfc2d.getStatus(), wfc2d::EStatus::FileNotFound);
+    EXPECT_FALSE(wfc2d.loadCompiledRuleset("test_tile_options.txt"));
+    EXPECT_EQ(wfc2d.getStatus(), wfc2d::EStatus::InvalidFormat);
+
+    ASSERT_FALSE(wfc2d.parseRulesFromFile("test_tile_options.txt").empty());
+    EXPECT_EQ(wfc2d.getStatus(), wfc2d::EStatus::Ok);
+    EXPECT_TRUE(wfc2d.run());
+    EXPECT_EQ(wfc2d.getStatus(), wfc2d::EStatus::Ok);
+
+    // The static loaders report through an optional out-parameter
+    wfc2d::EStatus status = wfc2d::EStatus::Ok;
+    EXPECT_EQ(wfc2d::WaveFunctionCollapse2D::Ruleset::loadJson("missing_ruleset.json", &status), nullptr);
+    EXPECT_EQ(status, wfc2d::EStatus::FileNotFound);
+    EXPECT_EQ(wfc2d::WaveFunctionCollapse2D::CompiledRuleset::load("test_tile_options.txt", &status), nullptr);
+    EXPECT_EQ(status, wfc2d::EStatus::InvalidFormat);
+    EXPECT_STREQ(wfc2d::toString(status), "invalid format");
+
+    wfc2d::ChunkedGenerator generator(1);
+    EXPECT_FALSE(generator.generate(8, 8));
+    EXPECT_EQ(generator.getStatus(), wfc2d::EStatus::NoRuleset);
+}
+
+// Test case to verify messages only reach an installed sink, filtered by level
+TEST(WFC2DTest, LogSinkTest) {
+    std::vector<std::pair<wfc2d::ELogLevel, std::string>> messages;
+    const auto capture = [&messages](wfc2d::ELogLevel level, const std::string& message) {
+        messages.emplace_back(level, message);
+    };
+
+    // Nothing is logged by default
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+    wfc2d.parseRulesFromFile("missing_ruleset.txt");
+    EXPECT_TRUE(messages.empty());
+
+    wfc2d::setLogSink(capture, wfc2d::ELogLevel::Warning);
+    wfc2d.parseRulesFromFile("missing_ruleset.txt");
+    ASSERT_EQ(messages.size(), 1);
+    EXPECT_EQ(messages[0].first, wfc2d::ELogLevel::Error);
+    EXPECT_NE(messages[0].second.find("missing_ruleset.txt"), std::string::npos);
+
+    // Below the sink level: a successful run logs nothing
+    messages.clear();
+    wfc2d.parseRulesFromFile("test_tile_options.txt");
+    wfc2d.initialize(8, 8);
+    ASSERT_TRUE(wfc2d.run());
+    EXPECT_TRUE(messages.empty());
+
+    // Trace messages only exist in builds that keep them
+    wfc2d::setLogSink(capture, wfc2d::ELogLevel::Trace);
+    wfc2d.reset();
+    ASSERT_TRUE(wfc2d.run());
+    const bool traced = std::any_of(messages.begin(), messages.end(), [](const auto& message) {
+        return message.first == wfc2d::ELogLevel::Trace;
+    });
+    EXPECT_EQ(traced, WFC_MIN_LOG_LEVEL == 0);
+
+    // Removing the sink turns logging off again
+    messages.clear();
+    wfc2d::setLogSink({});
+    wfc2d.parseRulesFromFile("missing_ruleset.txt");
+    EXPECT_TRUE(messages.empty());
+}
+
+// Test case to verify the output is held in the compact tile type and viewed without copies
+TEST(WFC2DTest, CompactOutputTest) {
+    static_assert(sizeof(wfc2d::TileIndex) * 8 == WFC_TILE_INDEX_BITS, "Output cells use the configured width");
+
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+    wfc2d.parseRulesFromFile("test_tile_options.txt");
+    wfc2d.initialize(6, 9);
+    EXPECT_EQ(wfc2d.getRows(), 6);
+    EXPECT_EQ(wfc2d.getCols(), 9);
+
+    const wfc2d::Span<const wfc2d::TileIndex> output = wfc2d.getOutput();
+    ASSERT_EQ(output.size(), wfc2d.size());
+    EXPECT_TRUE(std::all_of(output.begin(), output.end(), [](wfc2d::TileIndex tile) { return tile == wfc2d::NO_TILE; }));
+
+    ASSERT_TRUE(wfc2d.run());
+    EXPECT_EQ(wfc2d.getOutput().data(), output.data());
+    for (size_t index = 0; index < wfc2d.size(); ++index) {
+        EXPECT_EQ(output[index], wfc2d[index]);
+        EXPECT_LT(output[index], wfc2d.getCompiledRuleset()->numTiles);
+    }
+
+    // One line per row, one value per cell
+    std::ostringstream printed;
+    wfc2d.print(printed);
+    std::istringstream lines(printed.str());
+    std::string line;
+    size_t rows = 0;
+    while (std::getline(lines, line)) {
+        std::istringstream values(line);
+        for (size_t col = 0; col < 9; ++col) {
+            size_t value = 0;
+            ASSERT_TRUE(values >> value);
+            EXPECT_EQ(value, wfc2d[rows * 9 + col]);
+        }
+        ++rows;
+    }
+    EXPECT_EQ(rows, 6);
+}
+
+// Test case to verify the raw export writes the cells as they are held
+TEST(WFC2DTest, WriteRawTest) {
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+    wfc2d.parseRulesFromFile("test_tile_options.txt");
+    wfc2d.initialize(16, 12);
+    ASSERT_TRUE(wfc2d.run());
+
+    const std::string filepath = "wfc2d_output.raw";
+    wfc2d::EStatus status = wfc2d::EStatus::InvalidFormat;
+    ASSERT_TRUE(wfc2d::writeRaw(filepath, wfc2d.getOutput(), &status));
+    EXPECT_EQ(status, wfc2d::EStatus::Ok);
+
+    std::ifstream input(filepath, std::ios::binary);
+    std::vector<wfc2d::TileIndex> read(wfc2d.size() + 1);
+    input.read(reinterpret_cast<char*>(read.data()), static_cast<std::streamsize>(read.size() * sizeof(wfc2d::TileIndex)));
+    ASSERT_EQ(static_cast<size_t>(input.gcount()), wfc2d.size() * sizeof(wfc2d::TileIndex));
+    read.pop_back();
+    EXPECT_TRUE(std::equal(read.begin(), read.end(), wfc2d.getOutput().begin()));
+    input.close();
+
+    EXPECT_FALSE(wfc2d::writeRaw("missing_directory/output.raw", wfc2d.getOutput(), &status));
+    EXPECT_EQ(status, wfc2d::EStatus::FileNotFound);
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify the PNG export blits the atlas picture of every cell
+TEST(WFC2DTest, WritePngTest) {
+    const auto bigEndian = [](const unsigned char* bytes) {
+        return (uint32_t{ bytes[0] } << 24) | (uint32_t{ bytes[1] } << 16) | (uint32_t{ bytes[2] } << 8) | uint32_t{ bytes[3] };
+    };
+
+    // 2x2 tiles, laid out two per row; pixel (x, y) of tile t is { t, x, y, 255 }
+    const size_t TILE = 2;
+    std::vector<uint8_t> atlasPixels(4 * TILE * 2 * TILE * 4);
+    for (size_t tile = 0; tile < 4; ++tile) {
+        for (size_t y = 0; y < TILE; ++y) {
+            for (size_t x = 0; x < TILE; ++x) {
+                uint8_t* pixel = &atlasPixels[(((tile / 2) * TILE + y) * 2 * TILE + (tile % 2) * TILE + x) * 4];
+                pixel[0] = static_cast<uint8_t>(tile);
+                pixel[1] = static_cast<uint8_t>(x);
+                pixel[2] = static_cast<uint8_t>(y);
+                pixel[3] = 255;
+            }
+        }
+    }
+
+    wfc2d::TileAtlas atlas;
+    atlas.pixels = atlasPixels;
+    atlas.width = 2 * TILE;
+    atlas.height = 2 * TILE;
+    atlas.tileWidth = TILE;
+    atlas.tileHeight = TILE;
+
+    // Large enough for the image data to span several stored blocks; the last cell is left open
+    const size_t ROWS = 90;
+    const size_t COLS = 100;
+    std::vector<wfc2d::TileIndex> tiles(ROWS * COLS);
+    for (size_t index = 0; index < tiles.size(); ++index) {
+        tiles[index] = static_cast<wfc2d::TileIndex>(index % 4);
+    }
+    tiles.back() = wfc2d::NO_TILE;
+
+    const std::string filepath = "wfc2d_output.png";
+    ASSERT_TRUE(wfc2d::writePng(filepath, tiles, COLS, atlas));
+
+    std::ifstream input(filepath, std::ios::binary);
+    const std::vector<unsigned char> file((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    input.close();
+    ASSERT_GT(file.size(), 8);
+    EXPECT_EQ(std::memcmp(file.data(), "\x89PNG\r\n\x1A\n", 8), 0);
+
+    // Walk the chunks and gather the zlib stream
+    std::vector<unsigned char> zlib;
+    size_t width = 0;
+    size_t height = 0;
+    bool ended = false;
+    for (size_t offset = 8; offset + 12 <= file.size() && !ended; ) {
+        const size_t length = bigEndian(&file[offset]);
+        const std::string type(reinterpret_cast<const char*>(&file[offset + 4]), 4);
+        ASSERT_LE(offset + 12 + length, file.size());
+        const unsigned char* data = &file[offset + 8];
+        if (type == "IHDR") {
+            width = bigEndian(data);
+            height = bigEndian(data + 4);
+        }
+        else if (type == "IDAT") {
+            zlib.insert(zlib.end(), data, data + length);
+        }
+        ended = type == "IEND";
+        offset += 12 + length;
+    }
+    ASSERT_TRUE(ended);
+    ASSERT_EQ(width, COLS * TILE);
+    ASSERT_EQ(height, ROWS * TILE);
+
+    // Undo the stored deflate blocks
+    std::vector<unsigned char> image;
+    size_t position = 2;
+    for (bool last = false; !last; ) {
+        ASSERT_LE(position + 5, zlib.size());
+        last = (zlib[position] & 1) != 0;
+        const size_t length = size_t{ zlib[position + 1] } | (size_t{ zlib[position + 2] } << 8);
+        image.insert(image.end(), zlib.begin() + position + 5, zlib.begin() + position + 5 + length);
+        position += 5 + length;
+    }
+    EXPECT_EQ(position + 4, zlib.size());
+    ASSERT_EQ(image.size(), height * (1 + width * 4));
+
+    for (size_t y = 0; y < height; ++y) {
+        const unsigned char* scanline = &image[y * (1 + width * 4)];
+        ASSERT_EQ(scanline[0], 0);
+        for (size_t x = 0; x < width; ++x) {
+            const unsigned char* pixel = scanline + 1 + x * 4;
+            const size_t index = (y / TILE) * COLS + x / TILE;
+            if (index + 1 == tiles.size()) {
+                EXPECT_EQ(pixel[3], 0);
+                continue;
+            }
+            ASSERT_EQ(pixel[0], tiles[index]);
+            ASSERT_EQ(pixel[1], x % TILE);
+            ASSERT_EQ(pixel[2], y % TILE);
+            ASSERT_EQ(pixel[3], 255);
+        }
+    }
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify the output iterators are contiguous, random access and usable on a const solver
+TEST(WFC2DTest, OutputIteratorTest) {
+    using Solver = wfc2d::WaveFunctionCollapse2D;
+    static_assert(std::is_same<std::iterator_traits<Solver::iterator>::iterator_category, std::random_access_iterator_tag>::value, "Random access iterator");
+    static_assert(std::is_same<std::iterator_traits<Solver::const_iterator>::reference, const wfc2d::TileIndex&>::value, "Read-only const_iterator");
+
+    Solver wfc2d;
+    wfc2d.parseRulesFromFile("test_tile_options.txt");
+    wfc2d.initialize(7, 5);
+    ASSERT_TRUE(wfc2d.run());
+
+    const Solver& solver = wfc2d;
+    ASSERT_EQ(static_cast<size_t>(solver.end() - solver.begin()), solver.size());
+    EXPECT_EQ(solver.begin(), wfc2d.getOutput().data());
+    EXPECT_EQ(solver.cbegin() + 12, &solver[12]);
+    EXPECT_EQ(solver.begin()[solver.size() - 1], solver[solver.size() - 1]);
+
+    std::vector<wfc2d::TileIndex> sorted(solver.begin(), solver.end());
+    std::sort(sorted.begin(), sorted.end());
+    EXPECT_TRUE(std::is_permutation(sorted.begin(), sorted.end(), solver.cbegin()));
+
+    // Rows are slices of the same storage
+    for (size_t row = 0; row < 7; ++row) {
+        const auto tiles = solver.getRow(row);
+        ASSERT_EQ(tiles.size(), 5);
+        EXPECT_EQ(tiles.data(), solver.begin() + row * 5);
+    }
+
+    const auto band = solver.getRowRange(2, 3);
+    ASSERT_EQ(band.size(), 15);
+    EXPECT_TRUE(std::equal(band.begin(), band.end(), solver.begin() + 10));
+    EXPECT_TRUE(solver.getRowRange(7, 0).empty());
+
+    // Bands of rows can be processed independently and add up to the whole grid
+    size_t counted = 0;
+    for (size_t first = 0; first < 7; first += 2) {
+        const auto rows = solver.getRowRange(first, std::min<size_t>(2, 7 - first));
+        counted += static_cast<size_t>(std::count_if(rows.begin(), rows.end(), [](wfc2d::TileIndex tile) { return tile != wfc2d::NO_TILE; }));
+    }
+    EXPECT_EQ(counted, solver.size());
+}
+
+// Test case to verify the overlapping model learns a checkerboard and reproduces it
+TEST(WFC2DTest, OverlappingCheckerboardTest) {
+    std::vector<uint32_t> sample(4 * 4);
+    for (size_t index = 0; index < sample.size(); ++index) {
+        sample[index] = ((index / 4 + index % 4) % 2) ? 0xFF0000FFu : 0xFFFFFFFFu;
+    }
+
+    wfc2d::OverlappingOptions options;
+    options.patternSize = 2;
+    options.symmetry = 8;
+    wfc2d::EStatus status = wfc2d::EStatus::InvalidFormat;
+    const auto model = wfc2d::OverlappingModel::extract(sample, 4, 4, options, &status);
+    ASSERT_NE(model, nullptr);
+    EXPECT_EQ(status, wfc2d::EStatus::Ok);
+
+    // Both phases of the board, each seen in half of the 16 * 8 windows
+    ASSERT_EQ(model->size(), 2);
+    EXPECT_EQ(model->getPatternSize(), 2);
+    EXPECT_DOUBLE_EQ((*model->ruleset())[0].weight, 64.0);
+    EXPECT_DOUBLE_EQ((*model->ruleset())[1].weight, 64.0);
+    for (size_t direction = 0; direction < 4; ++direction) {
+        EXPECT_FALSE((*model->ruleset())[0].options[direction].test(0));
+        EXPECT_TRUE((*model->ruleset())[0].options[direction].test(1));
+    }
+
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+    wfc2d.setRuleset(model->ruleset());
+    wfc2d.initialize(12, 12);
+    ASSERT_TRUE(wfc2d.run());
+
+    const std::vector<uint32_t> pixels = model->render(wfc2d.getOutput());
+    ASSERT_EQ(pixels.size(), 144);
+    for (size_t row = 0; row < 12; ++row) {
+        for (size_t col = 0; col + 1 < 12; ++col) {
+            EXPECT_NE(pixels[row * 12 + col], pixels[row * 12 + col + 1]);
+            EXPECT_EQ(pixels[row * 12 + col], pixels[((row + 1) % 12) * 12 + col + 1]);
+        }
+    }
+
+    // The palette renders one pixel per cell
+    const wfc2d::TileAtlas atlas = model->atlas();
+    EXPECT_EQ(atlas.numTiles(), 2);
+    EXPECT_EQ(atlas.pixels.size(), 8);
+}
+
+// Test case to verify extraction merges windows exactly and does not depend on the number of threads
+TEST(WFC2DTest, OverlappingExtractionTest) {
+    const size_t SIDE = 40;
+    std::vector<uint32_t> sample(SIDE * SIDE);
+    for (size_t y = 0; y < SIDE; ++y) {
+        for (size_t x = 0; x < SIDE; ++x) {
+            sample[y * SIDE + x] = static_cast<uint32_t>(((x / 3) * 7 + (y / 2) * 3 + ((x * y) % 5 == 0 ? 1 : 0)) % 4);
+        }
+    }
+
+    wfc2d::OverlappingOptions options;
+    options.patternSize = 3;
+    options.symmetry = 4;
+    options.numThreads = 1;
+    const auto sequential = wfc2d::OverlappingModel::extract(sample, SIDE, SIDE, options);
+    options.numThreads = 3;
+    const auto parallel = wfc2d::OverlappingModel::extract(sample, SIDE, SIDE, options);
+    ASSERT_NE(sequential, nullptr);
+    ASSERT_NE(parallel, nullptr);
+    ASSERT_GT(sequential->size(), 10);
+    ASSERT_EQ(sequential->size(), parallel->size());
+
+    // Same patterns in the same order, with the same masks
+    double totalWeight = 0.0;
+    for (size_t pattern = 0; pattern < sequential->size(); ++pattern) {
+        const auto a = sequential->getPattern(pattern);
+        const auto b = parallel->getPattern(pattern);
+        ASSERT_TRUE(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+        totalWeight += (*sequential->ruleset())[pattern].weight;
+    }
+    EXPECT_DOUBLE_EQ(totalWeight, static_cast<double>(SIDE * SIDE * 4));
+    EXPECT_TRUE(std::equal(sequential->compiled()->allowed.begin(), sequential->compiled()->allowed.end(),
+        parallel->compiled()->allowed.begin(), parallel->compiled()->allowed.end()));
+
+    // Patterns are distinct, and b may sit right of a exactly when their overlap agrees
+    const auto& tiles = sequential->ruleset()->tiles();
+    for (size_t a = 0; a < tiles.size(); ++a) {
+        for (size_t b = 0; b < tiles.size(); ++b) {
+            const auto pa = sequential->getPattern(a);
+            const auto pb = sequential->getPattern(b);
+            if (a != b) {
+                ASSERT_FALSE(std::equal(pa.begin(), pa.end(), pb.begin()));
+            }
+
+            bool overlaps = true;
+            for (size_t y = 0; y < 3; ++y) {
+                for (size_t x = 1; x < 3; ++x) {
+                    overlaps = overlaps && pa[y * 3 + x] == pb[y * 3 + x - 1];
+                }
+            }
+            ASSERT_EQ(tiles[a].options[3].test(b), overlaps) << a << " " << b;
+            ASSERT_EQ(tiles[b].options[2].test(a), overlaps) << a << " " << b;
+        }
+    }
+
+    // Without wrapping, only windows that fit in the sample count
+    options.periodicInput = false;
+    options.symmetry = 1;
+    const auto bounded = wfc2d::OverlappingModel::extract(sample, SIDE, SIDE, options);
+    ASSERT_NE(bounded, nullptr);
+    double boundedWeight = 0.0;
+    for (const auto& tile : *bounded->ruleset()) {
+        boundedWeight += tile.weight;
+    }
+    EXPECT_DOUBLE_EQ(boundedWeight, static_cast<double>((SIDE - 2) * (SIDE - 2)));
+}
+
+// Test case to verify extraction rejects settings that don't fit the sample
+TEST(WFC2DTest, OverlappingRejectsTest) {
+    const std::vector<uint32_t> sample(5 * 4, 7);
+    wfc2d::OverlappingOptions options;
+    wfc2d::EStatus status = wfc2d::EStatus::Ok;
+
+    options.patternSize = 5;
+    EXPECT_EQ(wfc2d::OverlappingModel::extract(sample, 5, 4, options, &status), nullptr);
+    EXPECT_EQ(status, wfc2d::EStatus::InvalidFormat);
+
+    options.patternSize = 2;
+    options.symmetry = 9;
+    EXPECT_EQ(wfc2d::OverlappingModel::extract(sample, 5, 4, options, &status), nullptr);
+    EXPECT_EQ(status, wfc2d::EStatus::InvalidFormat);
+
+    options.symmetry = 1;
+    EXPECT_EQ(wfc2d::OverlappingModel::extract(sample, 4, 4, options, &status), nullptr);
+
+    // A uniform sample has a single pattern, which fits next to itself
+    const auto uniform = wfc2d::OverlappingModel::extract(sample, 5, 4, options, &status);
+    ASSERT_NE(uniform, nullptr);
+    ASSERT_EQ(uniform->size(), 1);
+    EXPECT_EQ(uniform->getColor(0), 7u);
+    EXPECT_TRUE((*uniform->ruleset())[0].options[0].test(0));
+}
+
+// Test case to verify that the neighbours of a periodic grid wrap around both axes
+TEST(WFC2DTest, PeriodicNeighborsTest) {
+    const size_t shapes[][2] = { { 1, 1 }, { 1, 5 }, { 5, 1 }, { 2, 2 }, { 4, 7 } };
+
+    for (const auto& shape : shapes) {
+        const size_t rows = shape[0];
+        const size_t cols = shape[1];
+
+        wfc2d::WaveFunctionCollapse2D wfc2d;
+        wfc2d.initialize(rows, cols, wfc2d::WaveFunctionCollapse2D::EBoundary::Periodic);
+        EXPECT_EQ(wfc2d.getBoundary(), wfc2d::WaveFunctionCollapse2D::EBoundary::Periodic);
+
+        for (size_t index = 0; index < rows * cols; ++index) {
+            const size_t row = index / cols;
+            const size_t col = index % cols;
+            const std::vector<size_t> expected = {
+                (row + rows - 1) % rows * cols + col,
+                (row + 1) % rows * cols + col,
+                row * cols + (col + cols - 1) % cols,
+                row * cols + (col + 1) % cols,
+            };
+
+            EXPECT_EQ(wfc2d.getNeighboringIndices(index), expected) << rows << "x" << cols << " cell " << index;
+        }
+    }
+
+    // Initializing again without a boundary brings the edges back
+    wfc2d::WaveFunctionCollapse2D wfc2d;
+    wfc2d.initialize(3, 3, wfc2d::WaveFunctionCollapse2D::EBoundary::Periodic);
+    wfc2d.initialize(3, 3);
+    EXPECT_EQ(wfc2d.getBoundary(), wfc2d::WaveFunctionCollapse2D::EBoundary::Fixed);
+    EXPECT_EQ(wfc2d.getNeighboringIndices(0), (std::vector<size_t>{ 3, 1 }));
+}
+
+// Test case to verify that a periodic map also agrees with the rules across its edges
+TEST(WFC2DTest, PeriodicSolveTest) {
+    using Solver = wfc2d::WaveFunctionCollapse2D;
+
+    const std::string filepath = writeBandRuleset(8);
+    const size_t size = 24;
+
+    for (const auto propagation : { Solver::EPropagation::ArcConsistency, Solver::EPropagation::SupportCounting }) {
+        Solver wfc2d;
+        const auto& tiles = wfc2d.parseRulesFromFile(filepath);
+        wfc2d.setPropagation(propagation);
+        wfc2d.setSeed(5);
+        wfc2d.setMaxRestarts(100);
+        wfc2d.initialize(size, size, Solver::EBoundary::Periodic);
+        ASSERT_TRUE(wfc2d.run());
+        expectValidOutput(wfc2d, tiles, size, size);
+
+        for (size_t i = 0; i < size; ++i) {
+            const size_t left = wfc2d[i * size + size - 1];
+            const size_t right = wfc2d[i * size];
+            EXPECT_TRUE(tiles[left].options[3].test(right) && tiles[right].options[2].test(left)) << "Row " << i;
+
+            const size_t up = wfc2d[(size - 1) * size + i];
+            const size_t down = wfc2d[i];
+            EXPECT_TRUE(tiles[up].options[1].test(down) && tiles[down].options[0].test(up)) << "Column " << i;
+        }
+    }
+
+    // Neighbours must differ out of two tiles: a torus of odd width can't be coloured, one of even width can
+    std::vector<Solver::Tile> checkerboard(2);
+    for (size_t tile = 0; tile < 2; ++tile) {
+        for (auto& options : checkerboard[tile].options) {
+            options.set(1 - tile);
+        }
+    }
+
+    Solver wfc2d;
+    wfc2d.setRuleset(Solver::Ruleset::create(checkerboard));
+    wfc2d.setMaxRestarts(0);
+    wfc2d.initialize(4, 5);
+    EXPECT_TRUE(wfc2d.run());
+    wfc2d.initialize(4, 5, Solver::EBoundary::Periodic);
+    EXPECT_FALSE(wfc2d.run());
+    EXPECT_EQ(wfc2d.getStatus(), wfc2d::EStatus::Contradiction);
+    wfc2d.initialize(4, 6, Solver::EBoundary::Periodic);
+    EXPECT_TRUE(wfc2d.run());
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify that an edit next to the edge of a periodic map is redrawn across the wrap-around
+TEST(WFC2DTest, PeriodicResolveTest) {
+    using Solver = wfc2d::WaveFunctionCollapse2D;
+
+    const std::string filepath = writeBandRuleset(8);
+    const size_t size = 40;
+
+    Solver wfc2d;
+    const auto& tiles = wfc2d.parseRulesFromFile(filepath);
+    wfc2d.setSeed(12);
+    wfc2d.setMaxRestarts(100);
+    wfc2d.setBacktracking(true);
+    wfc2d.initialize(size, size, Solver::EBoundary::Periodic);
+    ASSERT_TRUE(wfc2d.run());
+
+    std::vector<size_t> before(wfc2d.begin(), wfc2d.end());
+
+    const size_t corner = 0;
+    const size_t option = (before[corner] + 4) % 8;
+    ASSERT_TRUE(wfc2d.pin(corner, option));
+    ASSERT_TRUE(wfc2d.resolve());
+    EXPECT_EQ(wfc2d[corner], option);
+    expectValidOutput(wfc2d, tiles, size, size);
+
+    const auto distance = [size](size_t a) { return std::min(a, size - a); };
+    size_t changedAcrossEdges = 0;
+    for (size_t row = 0; row < size; ++row) {
+        for (size_t col = 0; col < size; ++col) {
+            const size_t index = row * size + col;
+            if (std::max(distance(row), distance(col)) > 9) {
+                ASSERT_EQ(wfc2d[index], before[index]) << "Row " << row << ", column " << col;
+            }
+            else if ((row >= size / 2 || col >= size / 2) && wfc2d[index] != before[index]) {
+                ++changedAcrossEdges;
+            }
+        }
+    }
+    EXPECT_GT(changedAcrossEdges, 0u);
+
+    for (size_t i = 0; i < size; ++i) {
+        const size_t left = wfc2d[i * size + size - 1];
+        const size_t right = wfc2d[i * size];
+        EXPECT_TRUE(tiles[left].options[3].test(right)) << "Row " << i;
+
+        const size_t up = wfc2d[(size - 1) * size + i];
+        const size_t down = wfc2d[i];
+        EXPECT_TRUE(tiles[up].options[1].test(down)) << "Column " << i;
+    }
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify the neighbours of boxes and hex maps, with and without wrap-around
+TEST(WFC2DTest, TopologyNeighborsTest) {
+    // Every cell of a box links to the cells beside it on all three axes
+    const wfc2d::CubeTopology box(3, 4, 5);
+    EXPECT_EQ(box.size(), 60u);
+    EXPECT_EQ(countSymmetricLinks(box), 2 * (2 * 4 * 5 + 3 * 3 * 5 + 3 * 4 * 4));
+
+    std::vector<std::pair<size_t, size_t>> neighbors;
+    box.forEachNeighbor((1 * 4 + 2) * 5 + 3, [&](size_t direction, size_t neighbor) { neighbors.emplace_back(direction, neighbor); });
+    const std::vector<std::pair<size_t, size_t>> inside = { { 0, 28 }, { 1, 38 }, { 2, 32 }, { 3, 34 }, { 4, 13 }, { 5, 53 } };
+    EXPECT_EQ(neighbors, inside);
+
+    const wfc2d::CubeTopology torus(3, 4, 5, wfc2d::EBoundary::Periodic);
+    EXPECT_EQ(countSymmetricLinks(torus), 60u * 6);
+    neighbors.clear();
+    torus.forEachNeighbor(0, [&](size_t direction, size_t neighbor) { neighbors.emplace_back(direction, neighbor); });
+    const std::vector<std::pair<size_t, size_t>> corner = { { 0, 15 }, { 1, 5 }, { 2, 4 }, { 3, 1 }, { 4, 40 }, { 5, 20 } };
+    EXPECT_EQ(neighbors, corner);
+
+    // Odd rows are shifted half a cell to the right
+    const wfc2d::HexTopology hex(4, 5);
+    EXPECT_EQ(countSymmetricLinks(hex), 2 * (4 * 4 + 3 * (5 + 4)));
+
+    neighbors.clear();
+    hex.forEachNeighbor(1 * 5 + 2, [&](size_t direction, size_t neighbor) { neighbors.emplace_back(direction, neighbor); });
+    const std::vector<std::pair<size_t, size_t>> oddRow = { { 0, 2 }, { 1, 13 }, { 2, 6 }, { 3, 8 }, { 4, 3 }, { 5, 12 } };
+    EXPECT_EQ(neighbors, oddRow);
+
+    neighbors.clear();
+    hex.forEachNeighbor(2 * 5 + 2, [&](size_t direction, size_t neighbor) { neighbors.emplace_back(direction, neighbor); });
+    const std::vector<std::pair<size_t, size_t>> evenRow = { { 0, 6 }, { 1, 17 }, { 2, 11 }, { 3, 13 }, { 4, 7 }, { 5, 16 } };
+    EXPECT_EQ(neighbors, evenRow);
+
+    const wfc2d::HexTopology hexTorus(4, 5, wfc2d::EBoundary::Periodic);
+    EXPECT_EQ(countSymmetricLinks(hexTorus), 20u * 6);
+    neighbors.clear();
+    hexTorus.forEachNeighbor(0, [&](size_t direction, size_t neighbor) { neighbors.emplace_back(direction, neighbor); });
+    const std::vector<std::pair<size_t, size_t>> wrapped = { { 0, 19 }, { 1, 5 }, { 2, 4 }, { 3, 1 }, { 4, 15 }, { 5, 9 } };
+    EXPECT_EQ(neighbors, wrapped);
+}
+
+// Test case to verify solving a box with rules for the two extra directions read from a text file
+TEST(WFC2DTest, CubeSolveTest) {
+    using Solver = wfc2d::WaveFunctionCollapse3D;
+
+    const std::string filepath = "band_ruleset_3d.txt";
+    {
+        std::ofstream output(filepath);
+        for (size_t tile = 0; tile < 8; ++tile) {
+            output << "[TILE_" << tile << "]\n";
+            for (const char* direction : { "up", "down", "left", "right", "below", "above" }) {
+                output << direction << "=" << (tile + 7) % 8 << " " << tile << " " << (tile + 1) % 8 << "\n";
+            }
+            output << "\n";
+        }
+    }
+
+    for (const auto propagation : { Solver::EPropagation::ArcConsistency, Solver::EPropagation::SupportCounting }) {
+        for (const auto boundary : { wfc2d::EBoundary::Fixed, wfc2d::EBoundary::Periodic }) {
+            Solver wfc3d;
+            const auto& tiles = wfc3d.parseRulesFromFile(filepath);
+            ASSERT_EQ(tiles.size(), 8u);
+            EXPECT_EQ(tiles[0].options[4].count(), 3u);
+            EXPECT_EQ(tiles[0].options[5].count(), 3u);
+
+            wfc3d.setPropagation(propagation);
+            wfc3d.setSeed(3);
+            wfc3d.setMaxRestarts(100);
+            wfc3d.initialize(4, 6, 6, boundary);
+            EXPECT_EQ(wfc3d.size(), 4u * 6 * 6);
+            ASSERT_TRUE(wfc3d.run());
+            expectValidNeighbors(wfc3d, tiles);
+        }
+    }
+
+    // A box is 2-colourable unless it wraps around an odd side
+    Solver wfc3d;
+    wfc3d.setRuleset(Solver::Ruleset::create(makeColoringTiles<Solver>(2)));
+    wfc3d.setMaxRestarts(0);
+    wfc3d.initialize(3, 4, 4);
+    EXPECT_TRUE(wfc3d.run());
+    wfc3d.initialize(3, 4, 4, wfc2d::EBoundary::Periodic);
+    EXPECT_FALSE(wfc3d.run());
+    wfc3d.initialize(2, 4, 4, wfc2d::EBoundary::Periodic);
+    EXPECT_TRUE(wfc3d.run());
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify solving hex maps, whose triangles of neighbours need three colours
+TEST(WFC2DTest, HexSolveTest) {
+    using Solver = wfc2d::WaveFunctionCollapseHex;
+
+    Solver hex;
+    hex.setMaxRestarts(0);
+    hex.setRuleset(Solver::Ruleset::create(makeColoringTiles<Solver>(2)));
+    hex.initialize(2, 2);
+    EXPECT_FALSE(hex.run());
+    EXPECT_EQ(hex.getStatus(), wfc2d::EStatus::Contradiction);
+
+    // Three colours are enough for any hex map
+    const auto tiles = Solver::Ruleset::create(makeColoringTiles<Solver>(3));
+    for (const auto boundary : { wfc2d::EBoundary::Fixed, wfc2d::EBoundary::Periodic }) {
+        hex.setRuleset(tiles);
+        hex.setSeed(8);
+        hex.setMaxRestarts(100);
+        hex.setBacktracking(true);
+        hex.initialize(12, 12, boundary);
+        ASSERT_TRUE(hex.run());
+        expectValidNeighbors(hex, *tiles);
+    }
+}
+
+// Test case to verify solving on a graph given as an adjacency list
+TEST(WFC2DTest, GraphTopologyTest) {
+    using Solver = wfc2d::WaveFunctionCollapseGraph<2>;
+    using Graph = wfc2d::GraphTopology<2>;
+
+    // A cycle, where direction 0 leads to the next cell and direction 1 back to the previous one
+    const auto cycle = [](size_t cells) {
+        std::vector<uint32_t> offsets;
+        std::vector<Graph::Edge> edges;
+        for (size_t cell = 0; cell < cells; ++cell) {
+            offsets.push_back(static_cast<uint32_t>(edges.size()));
+            edges.push_back({ static_cast<uint32_t>((cell + 1) % cells), 0 });
+            edges.push_back({ static_cast<uint32_t>((cell + cells - 1) % cells), 1 });
+        }
+        offsets.push_back(static_cast<uint32_t>(edges.size()));
+        return Graph(std::move(offsets), std::move(edges));
+    };
+
+    EXPECT_EQ(countSymmetricLinks(cycle(7)), 14u);
+
+    Solver graph;
+    const auto tiles = Solver::Ruleset::create(makeColoringTiles<Solver>(2));
+    graph.setRuleset(tiles);
+    graph.setMaxRestarts(0);
+    graph.initialize(cycle(8));
+    ASSERT_TRUE(graph.run());
+    expectValidNeighbors(graph, *tiles);
+
+    graph.initialize(cycle(9));
+    EXPECT_FALSE(graph.run());
+    EXPECT_EQ(graph.getStatus(), wfc2d::EStatus::Contradiction);
+
+    // Rules name the directions of a graph by number
+    const std::string filepath = "graph_ruleset.txt";
+    {
+        std::ofstream output(filepath);
+        output << "[TILE_0]\n0=1\n1=1\n\n[TILE_1]\n0=0\n1=0\n";
+    }
+    const auto& loaded = graph.parseRulesFromFile(filepath);
+    ASSERT_EQ(loaded.size(), 2u);
+    EXPECT_TRUE(loaded[0].options[0].test(1) && !loaded[0].options[0].test(0));
+    graph.setSeed(1);
+    graph.initialize(cycle(10));
+    ASSERT_TRUE(graph.run());
+    expectValidNeighbors(graph, loaded);
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify that a batch gives the maps of single solvers with the same seeds, whatever the threads
+TEST(WFC2DTest, BatchSolveTest) {
+    using Solver = wfc2d::WaveFunctionCollapse2D;
+
+    const std::string filepath = writeBandRuleset(8);
+
+    std::vector<wfc2d::BatchRequest> requests;
+    for (size_t i = 0; i < 24; ++i) {
+        requests.push_back({ 8 + i % 5 * 4, 12 + i % 3 * 6, 100 + i, i % 4 == 0 ? wfc2d::EBoundary::Periodic : wfc2d::EBoundary::Fixed });
+    }
+
+    std::vector<wfc2d::BatchResult> expected;
+    for (const auto& request : requests) {
+        Solver wfc2d;
+        const auto& tiles = wfc2d.parseRulesFromFile(filepath);
+        wfc2d.setMaxRestarts(100);
+        wfc2d.setSeed(request.seed);
+        wfc2d.initialize(request.rows, request.cols, request.boundary);
+        ASSERT_TRUE(wfc2d.run());
+        expectValidOutput(wfc2d, tiles, request.rows, request.cols);
+        expected.push_back({ wfc2d.getStatus(), wfc2d.getAttempts(), std::vector<wfc2d::TileIndex>(wfc2d.begin(), wfc2d.end()) });
+    }
+
+    for (const size_t threads : { 1, 3 }) {
+        wfc2d::BatchSolver batch(threads);
+        EXPECT_EQ(batch.getThreadCount(), threads);
+        ASSERT_TRUE(batch.parseRulesFromFile(filepath));
+        batch.setMaxRestarts(100);
+
+        std::vector<wfc2d::BatchResult> results;
+        for (size_t round = 0; round < 2; ++round) {
+            ASSERT_EQ(batch.solveBatch(requests, results), requests.size());
+            EXPECT_EQ(batch.getStatus(), wfc2d::EStatus::Ok);
+            ASSERT_EQ(results.size(), requests.size());
+            for (size_t i = 0; i < requests.size(); ++i) {
+                EXPECT_EQ(results[i].status, wfc2d::EStatus::Ok) << "Map " << i;
+                EXPECT_EQ(results[i].attempts, expected[i].attempts) << "Map " << i;
+                EXPECT_EQ(results[i].tiles, expected[i].tiles) << "Map " << i;
+            }
+        }
+    }
+
+    // Failed maps are reported one by one, and the batch carries the first failure
+    std::vector<Solver::Tile> checkerboard(2);
+    for (size_t tile = 0; tile < 2; ++tile) {
+        for (auto& options : checkerboard[tile].options) {
+            options.set(1 - tile);
+        }
+    }
+
+    wfc2d::BatchSolver batch(2);
+    std::vector<wfc2d::BatchResult> results;
+    EXPECT_EQ(batch.solveBatch(requests, results), 0u);
+    EXPECT_EQ(batch.getStatus(), wfc2d::EStatus::NoRuleset);
+    EXPECT_EQ(results.size(), requests.size());
+
+    batch.setCompiledRuleset(Solver::Ruleset::create(checkerboard)->compiled());
+    batch.setMaxRestarts(0);
+    const std::vector<wfc2d::BatchRequest> odd = {
+        { 4, 6, 1, wfc2d::EBoundary::Periodic },
+        { 4, 5, 2, wfc2d::EBoundary::Periodic },
+        { 4, 5, 3, wfc2d::EBoundary::Fixed },
+    };
+    EXPECT_EQ(batch.solveBatch(odd, results), 2u);
+    EXPECT_EQ(batch.getStatus(), wfc2d::EStatus::Contradiction);
+    EXPECT_EQ(results[0].status, wfc2d::EStatus::Ok);
+    EXPECT_EQ(results[0].tiles.size(), 24u);
+    EXPECT_EQ(results[1].status, wfc2d::EStatus::Contradiction);
+    EXPECT_TRUE(results[1].tiles.empty());
+    EXPECT_EQ(results[2].status, wfc2d::EStatus::Ok);
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify that batches stop allocating once the solver contexts and the results have warmed up
+TEST(WFC2DTest, BatchAllocationTest) {
+    const std::string filepath = writeColoringRuleset();
+
+    for (const auto propagation : { wfc2d::BatchSolver::EPropagation::ArcConsistency, wfc2d::BatchSolver::EPropagation::SupportCounting }) {
+        wfc2d::BatchSolver batch(2);
+        ASSERT_TRUE(batch.parseRulesFromFile(filepath));
+        batch.setPropagation(propagation);
+        batch.setMaxRestarts(1000);
+
+        // The coloring rules contradict often, so the restart path is covered as well
+        std::vector<wfc2d::BatchRequest> requests;
+        for (size_t i = 0; i < 32; ++i) {
+            requests.push_back({ 12, 16, i, i % 2 == 0 ? wfc2d::EBoundary::Periodic : wfc2d::EBoundary::Fixed });
+        }
+
+        std::vector<wfc2d::BatchResult> results;
+        for (size_t round = 0; round < 2; ++round) {
+            batch.solveBatch(requests, results);
+        }
+
+        const size_t before = allocationCount();
+        const size_t solved = batch.solveBatch(requests, results);
+        EXPECT_EQ(allocationCount(), before);
+        EXPECT_EQ(solved, requests.size());
+
+        size_t attempts = 0;
+        for (const auto& result : results) {
+            attempts += result.attempts;
+        }
+        EXPECT_GT(attempts, requests.size());
+    }
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify that a solver restored from a checkpoint taken mid-run finishes with the same map
+TEST(WFC2DTest, SnapshotResumeTest) {
+    using Solver = wfc2d::WaveFunctionCollapse2D;
+
+    const std::string filepath = writeColoringRuleset();
+    const std::string snapshotPath = "snapshot_resume.wfcs";
+    const size_t rows = 24;
+    const size_t cols = 32;
+
+    for (const auto propagation : { Solver::EPropagation::ArcConsistency, Solver::EPropagation::SupportCounting }) {
+        for (const bool backtracking : { false, true }) {
+            Solver original;
+            const auto& tiles = original.parseRulesFromFile(filepath);
+            original.setPropagation(propagation);
+            original.setBacktracking(backtracking);
+            original.setSeed(21);
+            original.setMaxRestarts(1000);
+            original.initialize(rows, cols);
+            original.pin(5, 1);
+
+            // Checkpoint halfway through the run that ends up solving the map
+            std::vector<unsigned char> checkpoint;
+            size_t calls = 0;
+            original.setProgressCallback([&]() {
+                if (++calls % 8 == 0) {
+                    ASSERT_TRUE(original.snapshot(checkpoint));
+                    ASSERT_TRUE(original.saveSnapshot(snapshotPath));
+                }
+            }, 40);
+            ASSERT_TRUE(original.run());
+            ASSERT_FALSE(checkpoint.empty());
+            expectValidOutput(original, tiles, rows, cols);
+
+            for (const bool fromFile : { false, true }) {
+                Solver restored;
+                restored.parseRulesFromFile(filepath);
+                restored.setMaxRestarts(1000);
+                restored.initialize(rows, cols);
+                ASSERT_TRUE(fromFile ? restored.loadSnapshot(snapshotPath) : restored.restore(checkpoint));
+                EXPECT_EQ(restored.getStatus(), wfc2d::EStatus::Ok);
+                EXPECT_EQ(restored.getPropagation(), propagation);
+                EXPECT_EQ(restored.isBacktracking(), backtracking);
+
+                // Snapshots of equal states are equal byte for byte
+                std::vector<unsigned char> again;
+                ASSERT_TRUE(restored.snapshot(again));
+                EXPECT_EQ(again, checkpoint);
+
+                ASSERT_TRUE(restored.run());
+                EXPECT_TRUE(std::equal(restored.begin(), restored.end(), original.begin(), original.end()));
+                EXPECT_EQ(restored[5], 1u);
+            }
+        }
+    }
+
+    std::remove(snapshotPath.c_str());
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify forking a partially solved wave into variants that share its collapsed tiles
+TEST(WFC2DTest, SnapshotForkTest) {
+    using Solver = wfc2d::WaveFunctionCollapse2D;
+
+    const std::string filepath = writeBandRuleset(8);
+    const size_t size = 24;
+
+    Solver prefix;
+    const auto& tiles = prefix.parseRulesFromFile(filepath);
+    prefix.setSeed(4);
+    prefix.setMaxRestarts(100);
+    prefix.initialize(size, size);
+
+    // The first row is pinned, so it survives the restarts of the forks; a few more tiles are collapsed
+    for (size_t col = 0; col < size; ++col) {
+        ASSERT_TRUE(prefix.pin(col, col / 3 % 8));
+    }
+    for (size_t row = 2; row < size; row += 4) {
+        ASSERT_TRUE(prefix.collapse(row * size + row));
+        ASSERT_TRUE(prefix.propagate());
+    }
+
+    std::vector<unsigned char> shared;
+    ASSERT_TRUE(prefix.snapshot(shared));
+
+    std::vector<std::vector<wfc2d::TileIndex>> variants;
+    for (uint64_t variant = 0; variant < 4; ++variant) {
+        Solver fork;
+        fork.parseRulesFromFile(filepath);
+        fork.setMaxRestarts(100);
+        fork.initialize(size, size);
+        ASSERT_TRUE(fork.restore(shared));
+        if (variant > 0) {
+            fork.getRandom() = wfc2d::Random::forStream(4, variant);
+        }
+        ASSERT_TRUE(fork.run());
+        expectValidOutput(fork, tiles, size, size);
+        for (size_t col = 0; col < size; ++col) {
+            EXPECT_EQ(fork[col], prefix[col]) << "Variant " << variant << ", column " << col;
+        }
+        variants.emplace_back(fork.begin(), fork.end());
+    }
+
+    // Without reseeding, a fork finishes like the solver it was taken from
+    ASSERT_TRUE(prefix.run());
+    EXPECT_EQ(variants[0], std::vector<wfc2d::TileIndex>(prefix.begin(), prefix.end()));
+    EXPECT_NE(variants[1], variants[0]);
+    EXPECT_NE(variants[2], variants[1]);
+
+    std::remove(filepath.c_str());
+}
+
+// Test case to verify that snapshots are only restored into matching solvers, and never half restored
+TEST(WFC2DTest, SnapshotRejectsTest) {
+    using Solver = wfc2d::WaveFunctionCollapse2D;
+
+    const std::string filepath = writeBandRuleset(8);
+    const std::string otherFilepath = writeBandRuleset(6);
+
+    Solver solver;
+    solver.parseRulesFromFile(filepath);
+    solver.setSeed(2);
+    solver.setMaxRestarts(100);
+    solver.initialize(16, 16);
+    ASSERT_TRUE(solver.run());
+
+    std::vector<unsigned char> snapshot;
+    ASSERT_TRUE(solver.snapshot(snapshot));
+
+    Solver uninitialized;
+    uninitialized.parseRulesFromFile(filepath);
+    EXPECT_FALSE(uninitialized.restore(snapshot));
+    EXPECT_EQ(uninitialized.getStatus(), wfc2d::EStatus::NotInitialized);
+    wfc2d::EStatus status = wfc2d::EStatus::Ok;
+    EXPECT_FALSE(uninitialized.snapshot(snapshot, &status));
+    EXPECT_EQ(status, wfc2d::EStatus::NotInitialized);
+
+    Solver target;
+    target.parseRulesFromFile(filepath);
+    target.setSeed(3);
+    target.initialize(16, 12);
+    EXPECT_FALSE(target.restore(snapshot));
+    EXPECT_EQ(target.getStatus(), wfc2d::EStatus::InvalidFormat);
+
+    target.parseRulesFromFile(otherFilepath);
+    target.initialize(16, 16);
+    EXPECT_FALSE(target.restore(snapshot));
+    EXPECT_EQ(target.getStatus(), wfc2d::EStatus::InvalidFormat);
+
+    target.parseRulesFromFile(filepath);
+    const std::vector<wfc2d::TileIndex> before(target.begin(), target.end());
+
+    const std::vector<unsigned char> truncated(snapshot.begin(), snapshot.end() - 64);
+    EXPECT_FALSE(target.restore(truncated));
+    EXPECT_EQ(target.getStatus(), wfc2d::EStatus::InvalidFormat);
+
+    std::vector<unsigned char> garbage(snapshot);
+    garbage[0] = 'X';
+    EXPECT_FALSE(target.restore(garbage));
+    EXPECT_EQ(target.getStatus(), wfc2d::EStatus::InvalidFormat);
+
+    // A rejected snapshot leaves the solver as it was
+    EXPECT_EQ(std::vector<wfc2d::TileIndex>(target.begin(), target.end()), before);
+
+    EXPECT_FALSE(target.loadSnapshot("missing_snapshot.wfcs"));
+    EXPECT_EQ(target.getStatus(), wfc2d::EStatus::FileNotFound);
+
+    ASSERT_TRUE(target.restore(snapshot));
+    EXPECT_TRUE(std::equal(target.begin(), target.end(), solver.begin(), solver.end()));
+
+    std::remove(filepath.c_str());
+    std::remove(otherFilepath.c_str());
+}
+
+// Test case to verify snapshots whose cells disagree with their wave are rejected
+TEST(WFC2DTest, SnapshotTamperedTest) {
+    const std::string filepath = writeBandRuleset(8);
+
+    wfc2d::WaveFunctionCollapse2D solver;
+    solver.parseRulesFromFile(filepath);
+    solver.setSeed(4);
+    solver.setMaxRestarts(100);
+    solver.initialize(16, 16);
+    ASSERT_TRUE(solver.run());
+
+    std::vector<unsigned char> snapshot;
+    ASSERT_TRUE(solver.snapshot(snapshot));
+
+    // On a solved map every domain holds the output tile, so the sections can be found by their contents
+    std::vector<uint64_t> wave;
+    std::vector<float> sumWeights(solver.size(), 1.0f);
+    for (const wfc2d::TileIndex tile : solver) {
+        wave.push_back(uint64_t{ 1 } << tile);
+    }
+    const std::vector<wfc2d::TileIndex> output(solver.begin(), solver.end());
+
+    const auto find = [&snapshot](const auto& values) {
+        const auto* bytes = reinterpret_cast<const unsigned char*>(values.data());
+        const auto it = std::search(snapshot.begin(), snapshot.end(), bytes, bytes + values.size() * sizeof(values[0]));
+        return static_cast<size_t>(it - snapshot.begin());
+    };
+    const size_t waveOffset = find(wave);
+    const size_t sumWeightsOffset = find(sumWeights);
+    const size_t outputOffset = find(output);
+    ASSERT_LT(waveOffset, snapshot.size());
+    ASSERT_LT(sumWeightsOffset, snapshot.size());
+    ASSERT_LT(outputOffset, snapshot.size());
+
+    wfc2d::WaveFunctionCollapse2D target;
+    target.parseRulesFromFile(filepath);
+    target.initialize(16, 16);
+
+    const auto expectRejected = [&](size_t offset, const auto& value) {
+        std::vector<unsigned char> tampered(snapshot);
+        std::memcpy(tampered.data() + offset, &value, sizeof(value));
+        EXPECT_FALSE(target.restore(tampered));
+        EXPECT_EQ(target.getStatus(), wfc2d::EStatus::InvalidFormat);
+    };
+
+    // A bit past the last tile
+    expectRejected(waveOffset, wave[0] | (uint64_t{ 1 } << 8));
+    // An extra option the count of the cell does not know about
+    expectRejected(waveOffset, wave[0] | (uint64_t{ 1 } << (output[0] + 4) % 8));
+    // A domain that no longer holds the output tile
+    expectRejected(waveOffset, uint64_t{ 1 } << (output[0] + 4) % 8);
+    // A weight sum that does not match the domain
+    expectRejected(sumWeightsOffset, 5.0f);
+    expectRejected(sumWeightsOffset, std::numeric_limits<float>::quiet_NaN());
+    // An output past the last tile
+    expectRejected(outputOffset, static_cast<wfc2d::TileIndex>(8));
+
+    ASSERT_TRUE(target.restore(snapshot));
+    EXPECT_TRUE(std::equal(target.begin(), target.end(), solver.begin(), solver.end()));
+
+    std::remove(filepath.c_str());
+}